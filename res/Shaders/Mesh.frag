@@ -0,0 +1,28 @@
+#version 450
+
+// Specialized when the pipeline is created, the disabled branch is compiled out
+layout(constant_id = 0) const bool GRAYSCALE = false;
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+// Follows Mesh.vert's block, the light is in world space like the normals
+layout(push_constant) uniform Constants
+{
+    layout(offset = 96) vec4 lightDirection;
+} constants;
+
+void main() 
+{
+    vec2 checker = floor(fragTexCoord * vec2(16.0, 8.0));
+    vec3 albedo = mod(checker.x + checker.y, 2.0) < 1.0 ? vec3(0.9, 0.5, 0.2) : vec3(0.2, 0.5, 0.9);
+
+    vec3 color = albedo * fragColor * (0.15 + max(dot(normalize(fragNormal), constants.lightDirection.xyz), 0.0));
+    if (GRAYSCALE)
+        color = vec3(dot(color, vec3(0.2126, 0.7152, 0.0722)));
+
+    outColor = vec4(color, 1.0);
+}
\ No newline at end of file
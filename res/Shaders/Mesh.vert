@@ -0,0 +1,59 @@
+#version 450
+
+// Set from the vertex format, each attribute's encoding is independent of the other
+layout(constant_id = 1) const bool SNORM_POSITION = true;       // Positions relative to the mesh bounds
+layout(constant_id = 2) const bool OCTAHEDRAL_NORMAL = true;    // Normals folded into two components
+
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec4 inNormal;
+layout(location = 3) in vec2 inTexCoord;
+
+// Per instance
+layout(location = 4) in vec4 instancePositionScale;
+layout(location = 5) in vec4 instanceRotation;
+layout(location = 6) in vec4 instanceColor;
+
+layout(push_constant) uniform Constants
+{
+    mat4 clipFromWorld;     // Tilt and orthographic projection, the same matrix the culling tests against
+    vec4 boundsCenter;
+    vec4 boundsExtent;
+} constants;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragColor;
+
+vec3 OctahedralDecode(vec2 encoded)
+{
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-direction.z, 0.0);
+    direction.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(direction.xy, vec2(0.0)));
+    return normalize(direction);
+}
+
+vec3 Rotate(vec4 rotation, vec3 v)
+{
+    vec3 t = 2.0 * cross(rotation.xyz, v);
+    return v + rotation.w * t + cross(rotation.xyz, t);
+}
+
+void main() 
+{
+    vec3 position = inPosition.xyz;
+    vec3 normal = inNormal.xyz;
+
+    if (SNORM_POSITION)
+        position = constants.boundsCenter.xyz + position * constants.boundsExtent.xyz;
+    if (OCTAHEDRAL_NORMAL)
+        normal = OctahedralDecode(inNormal.xy);
+
+    // Instances place the mesh centered on their position, the view frames the [-1, 1] cube
+    position = Rotate(instanceRotation, position - constants.boundsCenter.xyz) * instancePositionScale.w + instancePositionScale.xyz;
+    normal = Rotate(instanceRotation, normal);
+
+    gl_Position = constants.clipFromWorld * vec4(position, 1.0);
+    fragNormal = normal;
+    fragTexCoord = inTexCoord;
+    fragColor = instanceColor.rgb;
+}
\ No newline at end of file
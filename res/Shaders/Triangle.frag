@@ -1,10 +1,17 @@
 #version 450
 
+// Specialized when the pipeline is created, the disabled branch is compiled out
+layout(constant_id = 0) const bool GRAYSCALE = false;
+
 layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
 void main() 
 {
-    outColor = vec4(fragColor, 1.0);
+    vec3 color = fragColor;
+    if (GRAYSCALE)
+        color = vec3(dot(color, vec3(0.2126, 0.7152, 0.0722)));
+
+    outColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -1,3 +0,0 @@
-@echo off
-for /r %%i in (*.frag, *.vert) do "%VULKAN_SDK%\Bin\glslangValidator.exe" -V "%%i" -o "%%i.spv"
-pause
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <format>
 #include <limits>
 #include <algorithm>
+#include <cstring>
 
 #define UINT8 uint8_t
 #define UINT16 uint16_t
@@ -69,6 +70,11 @@
 
 #pragma region Main Debugging
 
+#ifndef _MSC_VER
+#include <signal.h>
+#define __debugbreak() raise(SIGTRAP)
+#endif // _MSC_VER
+
 #ifndef NDEBUG
 
 
@@ -0,0 +1,319 @@
+#include "AssetLoader.h"
+
+VulkanEngine::AssetLoader::~AssetLoader()
+{
+	Shutdown();
+}
+
+bool VulkanEngine::AssetLoader::Init(JobSystem& jobs, UINT32 ioThreads, size_t queueDepth)
+{
+	_jobs = &jobs;
+
+	_ioQueue.Reset(queueDepth);
+	_decodeQueue.Reset(queueDepth);
+	_uploadQueue.Reset(queueDepth);
+	_uploadSlots = queueDepth;
+	_stopping = false;
+
+	// Requests would never leave the I/O queue without at least one thread
+	ioThreads = std::max(ioThreads, 1u);
+
+	for (UINT32 i = 0; i < ioThreads; i++)
+		_ioThreads.emplace_back(&AssetLoader::IOLoop, this);
+
+	fprintf(stdout, "Created Asset Loader with %d I/O threads\n", ioThreads);
+	return true;
+}
+
+void VulkanEngine::AssetLoader::Shutdown()
+{
+	if (_ioThreads.empty())
+		return;
+
+	_stopping = true;
+
+	// Closed together so no stage stays blocked pushing into the next one
+	_ioQueue.Close();
+	_decodeQueue.Close();
+	_uploadQueue.Close();
+
+	// Taken once so an I/O thread about to wait for a slot sees _stopping
+	{
+		std::lock_guard<std::mutex> lock(_uploadSlotMutex);
+	}
+	_uploadSlotFreed.notify_all();
+
+	for (std::thread& thread : _ioThreads)
+		thread.join();
+
+	// Decode jobs drain what is left of their queue, failing every task
+	_jobs->Wait(_decodeJobs);
+
+	_ioThreads.clear();
+
+	if (_stalledUpload != nullptr)
+		Complete(std::move(_stalledUpload), false);
+
+	UPTR<Task> task;
+	while (_uploadQueue.TryPop(task))
+		Complete(std::move(task), false);
+}
+
+std::future<VulkanEngine::AssetResult> VulkanEngine::AssetLoader::Load(AssetRequest request)
+{
+	UPTR<Task> task = MAKE_UPTR<Task>();
+	task->data.path = request.path;
+	task->request = std::move(request);
+	task->start = Clock::now();
+
+	std::future<AssetResult> result = task->promise.get_future();
+	_inFlight++;
+
+	if (_ioThreads.empty())
+	{
+		fprintf(stderr, "Asset Loader is not running, dropped '%s'\n", task->data.path.c_str());
+		Complete(std::move(task), false);
+		return result;
+	}
+
+	Forward(_ioQueue, task);
+	return result;
+}
+
+size_t VulkanEngine::AssetLoader::ProcessUploads(UploadManager& uploader, size_t byteBudget)
+{
+	size_t uploaded = 0;
+
+	while (uploaded < byteBudget)
+	{
+		UPTR<Task> task = std::move(_stalledUpload);
+		if (task == nullptr && !_uploadQueue.TryPop(task))
+			break;
+
+		Clock::time_point begin = Clock::now();
+		UploadStatus status = task->request.upload(uploader, task->data);
+
+		// Kept aside rather than requeued so uploads still finish in the order they were decoded
+		if (status == UploadStatus::RingFull)
+		{
+			_stalledUpload = std::move(task);
+			break;
+		}
+
+		bool success = status == UploadStatus::Uploaded;
+		Record(Upload, success, task->data.GetSize(), begin);
+
+		if (success)
+			uploaded += task->data.GetSize();
+		else
+			fprintf(stderr, "Failed to upload asset '%s'\n", task->data.path.c_str());
+
+		Complete(std::move(task), success);
+	}
+
+	return uploaded;
+}
+
+void VulkanEngine::AssetLoader::IOLoop()
+{
+	UPTR<Task> task;
+	while (_ioQueue.Pop(task))
+	{
+		if (_stopping)
+		{
+			Complete(std::move(task), false);
+			continue;
+		}
+
+		Clock::time_point begin = Clock::now();
+		MappedFile& file = task->data.file;
+		bool opened = file.Open(task->data.path, task->request.access);
+
+		// Touch every page so the disk wait is paid here and never inside a decode worker
+		if (opened && file.IsMapped())
+		{
+			char touched = 0;
+			for (size_t offset = 0; offset < file.GetSize(); offset += 4096)
+				touched ^= file.GetData()[offset];
+
+			volatile char sink = touched;
+			(void)sink;
+		}
+
+		Record(IO, opened, file.GetSize(), begin);
+
+		if (!opened)
+		{
+			fprintf(stderr, "Failed to read asset '%s'\n", task->data.path.c_str());
+			Complete(std::move(task), false);
+			continue;
+		}
+
+		// Waits here while uploads lag behind, the decode job then always finds room
+		if (task->request.upload)
+		{
+			if (!AcquireUploadSlot())
+			{
+				Complete(std::move(task), false);
+				continue;
+			}
+			task->holdsUploadSlot = true;
+		}
+
+		ForwardToDecode(task);
+	}
+}
+
+void VulkanEngine::AssetLoader::DecodeOne()
+{
+	UPTR<Task> task;
+	if (!_decodeQueue.TryPop(task))
+		return;
+
+	if (_stopping)
+	{
+		Complete(std::move(task), false);
+		return;
+	}
+
+	Clock::time_point begin = Clock::now();
+	bool decoded = !task->request.decode || task->request.decode(task->data);
+
+	Record(Decode, decoded, task->data.GetSize(), begin);
+
+	if (!decoded)
+	{
+		fprintf(stderr, "Failed to decode asset '%s'\n", task->data.path.c_str());
+		Complete(std::move(task), false);
+	}
+	else if (task->request.upload)
+	{
+		// The reserved slot guarantees room, so this only fails once the queue is closed
+		if (!_uploadQueue.TryPush(task))
+			Complete(std::move(task), false);
+	}
+	else
+		Complete(std::move(task), true);
+}
+
+void VulkanEngine::AssetLoader::Complete(UPTR<Task> task, bool success)
+{
+	AssetResult result;
+	result.path = task->data.path;
+	result.success = success;
+	result.fileBytes = task->data.file.GetSize();
+	result.decodedBytes = task->data.GetSize();
+	result.latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - task->start).count();
+
+	if (task->holdsUploadSlot)
+		ReleaseUploadSlot();
+
+	if (task->request.onComplete)
+		task->request.onComplete(result);
+
+	// Counted down first so a caller woken by the future never sees it still in flight
+	_inFlight--;
+	task->promise.set_value(std::move(result));
+}
+
+void VulkanEngine::AssetLoader::Forward(BoundedQueue<UPTR<Task>>& queue, UPTR<Task>& task)
+{
+	// Push only fails once the loader shuts down
+	if (!queue.Push(task))
+		Complete(std::move(task), false);
+}
+
+void VulkanEngine::AssetLoader::ForwardToDecode(UPTR<Task>& task)
+{
+	if (!_decodeQueue.Push(task))
+	{
+		Complete(std::move(task), false);
+		return;
+	}
+
+	// Jobs and queued tasks are paired one to one, whichever job runs first takes the oldest task
+	_jobs->Run([this] { DecodeOne(); }, &_decodeJobs);
+}
+
+bool VulkanEngine::AssetLoader::AcquireUploadSlot()
+{
+	std::unique_lock<std::mutex> lock(_uploadSlotMutex);
+	_uploadSlotFreed.wait(lock, [this] { return _stopping || _uploadSlots > 0; });
+
+	if (_stopping)
+		return false;
+
+	_uploadSlots--;
+	return true;
+}
+
+void VulkanEngine::AssetLoader::ReleaseUploadSlot()
+{
+	{
+		std::lock_guard<std::mutex> lock(_uploadSlotMutex);
+		_uploadSlots++;
+	}
+	_uploadSlotFreed.notify_one();
+}
+
+void VulkanEngine::AssetLoader::Record(Stage stage, bool success, size_t bytes, Clock::time_point begin)
+{
+	StageCounters& counters = _counters[stage];
+
+	counters.busyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+
+	if (success)
+	{
+		counters.completed++;
+		counters.bytes += bytes;
+	}
+	else
+		counters.failed++;
+}
+
+VulkanEngine::AssetLoader::StageStats VulkanEngine::AssetLoader::GetStats(Stage stage)
+{
+	const StageCounters& counters = _counters[stage];
+	BoundedQueue<UPTR<Task>>& queue = stage == IO ? _ioQueue : stage == Decode ? _decodeQueue : _uploadQueue;
+
+	StageStats stats;
+	stats.completed = counters.completed;
+	stats.failed = counters.failed;
+	stats.bytes = counters.bytes;
+	stats.busySeconds = counters.busyNanoseconds * 1e-9;
+	stats.queueDepth = queue.GetSize();
+	stats.peakDepth = queue.GetPeak();
+	stats.capacity = queue.GetCapacity();
+	return stats;
+}
+
+void VulkanEngine::AssetLoader::PrintStats()
+{
+	for (UINT32 stage = 0; stage < STAGE_COUNT; stage++)
+	{
+		StageStats stats = GetStats(static_cast<Stage>(stage));
+
+		fprintf(stdout, "Asset Loader %-6s : %llu done, %llu failed, %.2f MiB at %.1f MiB/s, queue %zu/%zu (peak %zu)\n",
+			GetStageName(static_cast<Stage>(stage)),
+			static_cast<unsigned long long>(stats.completed),
+			static_cast<unsigned long long>(stats.failed),
+			stats.bytes / (1024.0 * 1024.0),
+			stats.GetBytesPerSecond() / (1024.0 * 1024.0),
+			stats.queueDepth, stats.capacity, stats.peakDepth);
+	}
+}
+
+const char* VulkanEngine::AssetLoader::GetStageName(Stage stage)
+{
+	switch (stage)
+	{
+	case IO:
+		return "I/O";
+	case Decode:
+		return "Decode";
+	case Upload:
+		return "Upload";
+	default:
+		return "Unknown";
+	}
+}
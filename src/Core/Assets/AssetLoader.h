@@ -0,0 +1,190 @@
+#pragma once
+
+#include <Common.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+#include <Assets/BoundedQueue.h>
+#include <Jobs/JobSystem.h>
+#include <Memory/UploadManager.h>
+
+namespace VulkanEngine
+{
+	// Everything a request carries from one stage to the next
+	struct AssetData
+	{
+		std::string path;
+
+		// Raw file contents, mapped by the I/O stage
+		MappedFile file;
+
+		// Output of the decode stage, left empty when the raw file is used as is
+		std::vector<char> decoded;
+
+		inline const char* GetBytes() const { return decoded.empty() ? file.GetData() : decoded.data(); }
+		inline size_t GetSize() const { return decoded.empty() ? file.GetSize() : decoded.size(); }
+	};
+
+	struct AssetResult
+	{
+		std::string path;
+		bool success = false;
+
+		// Bytes read from disk and bytes handed to the upload stage
+		size_t fileBytes = 0;
+		size_t decodedBytes = 0;
+
+		// From Load until completion
+		double latencyMs = 0.0;
+	};
+
+	enum class UploadStatus
+	{
+		Uploaded,
+		RingFull,	// Staging ring has no room this frame, the upload is retried next frame
+		Failed
+	};
+
+	struct AssetRequest
+	{
+		using DecodeFunction = std::function<bool(AssetData& data)>;
+		using UploadFunction = std::function<UploadStatus(UploadManager& uploader, const AssetData& data)>;
+		using CompletionFunction = std::function<void(const AssetResult& result)>;
+
+		std::string path;
+		FileAccess access = FileAccess::Sequential;
+
+		// Runs as a task, may be empty to pass the file through untouched
+		DecodeFunction decode;
+
+		// Runs on the render thread inside ProcessUploads, may be empty for CPU only assets
+		UploadFunction upload;
+
+		// Runs on whichever thread finished the last stage, before the future is ready
+		CompletionFunction onComplete;
+	};
+
+	// Three stage asynchronous loader. A small pool of I/O threads maps and pages in
+	// files, decoding runs as jobs on the shared task system and the render thread
+	// drains finished assets into the UploadManager once per frame. Each stage is fed
+	// by a bounded queue, so a slow stage blocks the one before it instead of
+	// buffering the disk. I/O keeps its own threads since they spend their time
+	// blocked on the disk, which would stall a task thread. Decode jobs never block:
+	// an I/O thread reserves a slot in the upload queue before scheduling one, so a
+	// full upload queue holds back the I/O threads rather than a job the render
+	// thread might be running while it waits.
+	class AssetLoader
+	{
+	public:
+		enum Stage
+		{
+			IO,
+			Decode,
+			Upload,
+			STAGE_COUNT
+		};
+
+		struct StageStats
+		{
+			UINT64 completed = 0;
+			UINT64 failed = 0;
+			UINT64 bytes = 0;
+			double busySeconds = 0.0;
+
+			// Queue feeding the stage
+			size_t queueDepth = 0;
+			size_t peakDepth = 0;
+			size_t capacity = 0;
+
+			// Throughput while the stage was actually working, summed over its threads
+			inline double GetBytesPerSecond() const { return busySeconds > 0.0 ? bytes / busySeconds : 0.0; }
+		};
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Task
+		{
+			AssetRequest request;
+			AssetData data;
+			std::promise<AssetResult> promise;
+			Clock::time_point start;
+			bool holdsUploadSlot = false;	// Given back when the task completes
+		};
+
+		struct StageCounters
+		{
+			std::atomic<UINT64> completed = 0;
+			std::atomic<UINT64> failed = 0;
+			std::atomic<UINT64> bytes = 0;
+			std::atomic<UINT64> busyNanoseconds = 0;
+		};
+
+		BoundedQueue<UPTR<Task>> _ioQueue;
+		BoundedQueue<UPTR<Task>> _decodeQueue;
+		BoundedQueue<UPTR<Task>> _uploadQueue;
+
+		std::vector<std::thread> _ioThreads;
+
+		JobSystem* _jobs = nullptr;
+
+		// Decode jobs queued or running, each one pops a single task from _decodeQueue
+		JobCounter _decodeJobs;
+
+		// Only touched by the render thread, holds the upload that did not fit last frame
+		UPTR<Task> _stalledUpload;
+
+		// Upload queue entries not yet reserved by a task between I/O and upload
+		std::mutex _uploadSlotMutex;
+		std::condition_variable _uploadSlotFreed;
+		size_t _uploadSlots = 0;
+
+		StageCounters _counters[STAGE_COUNT];
+		std::atomic<UINT64> _inFlight = 0;
+		std::atomic<bool> _stopping = false;
+
+		void IOLoop();
+		void DecodeOne();
+
+		void Complete(UPTR<Task> task, bool success);
+		void Forward(BoundedQueue<UPTR<Task>>& queue, UPTR<Task>& task);
+		void ForwardToDecode(UPTR<Task>& task);
+
+		// Blocks while every upload slot is taken, false once the loader stops
+		bool AcquireUploadSlot();
+		void ReleaseUploadSlot();
+		void Record(Stage stage, bool success, size_t bytes, Clock::time_point begin);
+
+	public:
+		static constexpr size_t DEFAULT_QUEUE_DEPTH = 64;
+
+		AssetLoader() = default;
+		~AssetLoader();
+
+		bool Init(JobSystem& jobs, UINT32 ioThreads, size_t queueDepth = DEFAULT_QUEUE_DEPTH);
+
+		// Requests still queued complete with success = false
+		void Shutdown();
+
+		// Blocks only while the I/O queue is full
+		std::future<AssetResult> Load(AssetRequest request);
+
+		// Render thread, once per frame before UploadManager::Submit. Stops early
+		// once byteBudget is spent or the staging ring is full, returns the bytes uploaded.
+		size_t ProcessUploads(UploadManager& uploader, size_t byteBudget = SIZE_MAX);
+
+		// Requests loaded but not completed yet
+		inline UINT64 GetInFlightCount() const { return _inFlight.load(std::memory_order_relaxed); }
+
+		StageStats GetStats(Stage stage);
+		void PrintStats();
+
+		static const char* GetStageName(Stage stage);
+
+	public:
+		AssetLoader(const AssetLoader&) = delete;
+		AssetLoader& operator=(const AssetLoader&) = delete;
+	};
+}
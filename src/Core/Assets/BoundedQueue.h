@@ -0,0 +1,133 @@
+#pragma once
+
+#include <Common.h>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace VulkanEngine
+{
+	// Multi producer, multi consumer FIFO with a fixed capacity. Producers block
+	// while it is full, which is what pushes back on earlier pipeline stages.
+	// Once closed pushes fail and pops drain what is left, then fail too.
+	template <typename T>
+	class BoundedQueue
+	{
+	private:
+		std::mutex _mutex;
+		std::condition_variable _notEmpty;
+		std::condition_variable _notFull;
+		std::deque<T> _items;
+
+		size_t _capacity = 0;
+		size_t _peak = 0;
+		bool _closed = false;
+
+	public:
+		explicit BoundedQueue(size_t capacity = 64) : _capacity(std::max<size_t>(capacity, 1)) {}
+
+		// Blocks while full, returns false and leaves item untouched once closed
+		bool Push(T& item)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_notFull.wait(lock, [this] { return _closed || _items.size() < _capacity; });
+
+			if (_closed)
+				return false;
+
+			_items.push_back(std::move(item));
+			_peak = std::max(_peak, _items.size());
+
+			lock.unlock();
+			_notEmpty.notify_one();
+			return true;
+		}
+
+		// Never blocks, returns false and leaves item untouched when full or closed
+		bool TryPush(T& item)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			if (_closed || _items.size() >= _capacity)
+				return false;
+
+			_items.push_back(std::move(item));
+			_peak = std::max(_peak, _items.size());
+
+			lock.unlock();
+			_notEmpty.notify_one();
+			return true;
+		}
+
+		// Blocks while empty, returns false once closed and drained
+		bool Pop(T& item)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_notEmpty.wait(lock, [this] { return _closed || !_items.empty(); });
+
+			if (_items.empty())
+				return false;
+
+			item = std::move(_items.front());
+			_items.pop_front();
+
+			lock.unlock();
+			_notFull.notify_one();
+			return true;
+		}
+
+		bool TryPop(T& item)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			if (_items.empty())
+				return false;
+
+			item = std::move(_items.front());
+			_items.pop_front();
+
+			lock.unlock();
+			_notFull.notify_one();
+			return true;
+		}
+
+		void Close()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_closed = true;
+			}
+			_notEmpty.notify_all();
+			_notFull.notify_all();
+		}
+
+		// Only meant for setup, items already queued are kept even above the new capacity
+		void Reset(size_t capacity)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_capacity = std::max<size_t>(capacity, 1);
+			_peak = _items.size();
+			_closed = false;
+		}
+
+		size_t GetSize()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _items.size();
+		}
+
+		size_t GetPeak()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _peak;
+		}
+
+		size_t GetCapacity()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _capacity;
+		}
+
+	public:
+		BoundedQueue(const BoundedQueue&) = delete;
+		BoundedQueue& operator=(const BoundedQueue&) = delete;
+	};
+}
@@ -0,0 +1,177 @@
+#include "ComputeScheduler.h"
+
+bool VulkanEngine::ComputeScheduler::Init(VkDevice device, FrameProfiler& profiler, VkQueue computeQueue, UINT32 computeFamily, UINT32 graphicsFamily,
+	UINT32 framesInFlight, bool useTimeline, bool asyncCompute)
+{
+	_device = device;
+	_profiler = &profiler;
+	_computeQueue = computeQueue;
+	_computeFamily = computeFamily;
+	_graphicsFamily = graphicsFamily;
+	_async = asyncCompute && useTimeline && computeFamily != graphicsFamily;
+
+	if (!_async)
+	{
+		const char* reason = !asyncCompute ? "disabled" : computeFamily == graphicsFamily ? "no separate compute family" : "needs timeline semaphores";
+		fprintf(stdout, "Created Compute Scheduler (inline, %s)\n", reason);
+		return true;
+	}
+
+	if (!_timeline.Create(_device))
+		return false;
+
+	if (!_profiler->InitComputeTimings(_computeFamily, framesInFlight))
+		return false;
+
+	_commandPools.resize(framesInFlight, VK_NULL_HANDLE);
+	_commandBuffers.resize(framesInFlight, VK_NULL_HANDLE);
+	_slotValues.resize(framesInFlight, 0);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = _computeFamily;
+
+	for (UINT32 i = 0; i < framesInFlight; i++)
+	{
+		if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPools[i]) != VK_SUCCESS)
+		{
+			fprintf(stderr, "Failed to create Compute Command Pool\n");
+			return false;
+		}
+
+		VkCommandBufferAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = _commandPools[i];
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(_device, &allocateInfo, &_commandBuffers[i]) != VK_SUCCESS)
+		{
+			fprintf(stderr, "Failed to create Compute Command Buffer\n");
+			return false;
+		}
+	}
+
+	fprintf(stdout, "Created Compute Scheduler (async, compute family %u)\n", _computeFamily);
+	return true;
+}
+
+void VulkanEngine::ComputeScheduler::Shutdown()
+{
+	for (UINT64 value : _slotValues)
+		_timeline.Wait(value);
+
+	for (VkCommandPool commandPool : _commandPools)
+	{
+		if (commandPool != VK_NULL_HANDLE)
+			vkDestroyCommandPool(_device, commandPool, nullptr);
+	}
+
+	_commandPools.clear();
+	_commandBuffers.clear();
+	_slotValues.clear();
+	_passes.clear();
+	_timeline.Destroy();
+}
+
+void VulkanEngine::ComputeScheduler::AddPass(const std::string& name, VkPipelineStageFlags consumerStage, RecordFunction record)
+{
+	_passes.push_back({ name, consumerStage, std::move(record) });
+}
+
+VkPipelineStageFlags VulkanEngine::ComputeScheduler::RecordPasses(VkCommandBuffer commandBuffer, UINT32 frame)
+{
+	VkPipelineStageFlags consumerStages = 0;
+
+	for (const Pass& pass : _passes)
+	{
+		if (!pass.record(commandBuffer, frame))
+			continue;
+
+		consumerStages |= pass.consumerStage;
+		_stats.passesRecorded++;
+	}
+
+	return consumerStages;
+}
+
+VulkanEngine::ComputeSubmission VulkanEngine::ComputeScheduler::Submit(UINT32 frame, UINT64 frameValue, const UploadSubmission& upload)
+{
+	if (!_async || _passes.empty())
+		return {};
+
+	// The graphics work of this slot waited on the previous batch, so this only blocks when nothing did
+	_timeline.Wait(_slotValues[frame]);
+	vkResetCommandPool(_device, _commandPools[frame], 0);
+
+	VkCommandBuffer commandBuffer = _commandBuffers[frame];
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	// A failed batch signals nothing, the frame goes on without waiting for it
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to begin compute Command Buffer\n");
+		return {};
+	}
+
+	_profiler->WriteBeginTimestamp(commandBuffer, frame, GpuQueue::Compute);
+	VkPipelineStageFlags consumerStages = RecordPasses(commandBuffer, frame);
+	_profiler->WriteEndTimestamp(commandBuffer, frame, GpuQueue::Compute);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to record compute Command Buffer\n");
+		return {};
+	}
+
+	// Passes may read what this frame uploaded, the timeline lets graphics wait on the same value
+	SemaphoreSubmit semaphores;
+	semaphores.Wait(upload.semaphore, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, upload.value);
+	semaphores.Signal(_timeline.GetHandle(), frameValue);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	semaphores.Fill(submitInfo, true);
+
+	if (vkQueueSubmit(_computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to submit compute passes to compute queue\n");
+		return {};
+	}
+
+	_slotValues[frame] = frameValue;
+	_stats.asyncSubmissions++;
+
+	// Submitted even when empty so the timestamps resolve, graphics only waits when a pass recorded
+	if (consumerStages == 0)
+		return {};
+
+	ComputeSubmission submission;
+	submission.semaphore = _timeline.GetHandle();
+	submission.value = frameValue;
+	submission.waitStage = consumerStages;
+	return submission;
+}
+
+void VulkanEngine::ComputeScheduler::RecordInline(VkCommandBuffer commandBuffer, UINT32 frame)
+{
+	if (_async || _passes.empty())
+		return;
+
+	if (RecordPasses(commandBuffer, frame) != 0)
+		_stats.inlineRecords++;
+}
+
+void VulkanEngine::ComputeScheduler::PrintStats() const
+{
+	fprintf(stdout, "Compute Scheduler : %llu async submissions, %llu inline records, %llu passes recorded\n",
+		static_cast<unsigned long long>(_stats.asyncSubmissions),
+		static_cast<unsigned long long>(_stats.inlineRecords),
+		static_cast<unsigned long long>(_stats.passesRecorded));
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <Common.h>
+#include <functional>
+#include <Memory/UploadManager.h>
+#include <Profiler/FrameProfiler.h>
+#include <Sync/TimelineSemaphore.h>
+
+namespace VulkanEngine
+{
+	// What a graphics submission has to wait on for this frame's compute passes,
+	// a null semaphore when they were recorded inline or nothing was recorded
+	struct ComputeSubmission
+	{
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		UINT64 value = 0;
+		VkPipelineStageFlags waitStage = 0;		// Earliest graphics stage reading the results
+	};
+
+	// Runs the frame's compute passes (culling, particles, post processing) on a
+	// compute queue of its own. The passes of a frame are recorded into one command
+	// buffer and submitted ahead of the graphics work, they overlap the graphics
+	// frames still in flight and the graphics submission only waits at the first
+	// stage consuming their results. Frames are tracked on a timeline semaphore
+	// carrying the frame value, so async compute needs the timeline backend. On
+	// devices without a separate compute family, or with the fence backend, the
+	// passes are recorded inline at the start of the graphics command buffer.
+	class ComputeScheduler
+	{
+	public:
+		// Returns false when the pass had nothing to do this frame
+		using RecordFunction = std::function<bool(VkCommandBuffer commandBuffer, UINT32 frame)>;
+
+		struct Stats
+		{
+			UINT64 asyncSubmissions = 0;
+			UINT64 inlineRecords = 0;
+			UINT64 passesRecorded = 0;
+		};
+
+	private:
+		struct Pass
+		{
+			std::string name;
+			VkPipelineStageFlags consumerStage = 0;
+			RecordFunction record;
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+		FrameProfiler* _profiler = nullptr;
+
+		VkQueue _computeQueue = VK_NULL_HANDLE;
+		UINT32 _computeFamily = 0;
+		UINT32 _graphicsFamily = 0;
+		bool _async = false;
+
+		TimelineSemaphore _timeline;
+
+		// Indexed by frame in flight
+		std::vector<VkCommandPool> _commandPools;
+		std::vector<VkCommandBuffer> _commandBuffers;
+		std::vector<UINT64> _slotValues;
+
+		std::vector<Pass> _passes;
+		Stats _stats;
+
+		// Records every pass in order, returns the union of the consumer stages of those that recorded
+		VkPipelineStageFlags RecordPasses(VkCommandBuffer commandBuffer, UINT32 frame);
+
+	public:
+		ComputeScheduler() = default;
+
+		// asyncCompute asks for the dedicated queue, it is only used when the families
+		// differ and useTimeline is set. The compute queue is timed through profiler.
+		bool Init(VkDevice device, FrameProfiler& profiler, VkQueue computeQueue, UINT32 computeFamily, UINT32 graphicsFamily,
+			UINT32 framesInFlight, bool useTimeline, bool asyncCompute);
+		void Shutdown();
+
+		// Passes run in the order they were added, every frame. consumerStage is the graphics
+		// stage that first reads what the pass wrote.
+		void AddPass(const std::string& name, VkPipelineStageFlags consumerStage, RecordFunction record);
+
+		// Async only: records and submits this frame's passes. They wait on the frame's uploads,
+		// frameValue is signaled on completion and must grow with every call. Call once the frame
+		// is certain to be submitted. A batch failing to record or submit is logged and returns an empty submission.
+		ComputeSubmission Submit(UINT32 frame, UINT64 frameValue, const UploadSubmission& upload);
+
+		// Inline only: records the passes into the graphics command buffer, outside a render pass
+		void RecordInline(VkCommandBuffer commandBuffer, UINT32 frame);
+
+		inline bool IsAsync() const { return _async; }
+		inline UINT32 GetComputeFamily() const { return _async ? _computeFamily : _graphicsFamily; }
+
+		inline const Stats& GetStats() const { return _stats; }
+		void PrintStats() const;
+
+	public:
+		ComputeScheduler(const ComputeScheduler&) = delete;
+		ComputeScheduler& operator=(const ComputeScheduler&) = delete;
+	};
+}
@@ -0,0 +1,158 @@
+#include "ParallelRecorder.h"
+
+VulkanEngine::ParallelRecorder::~ParallelRecorder()
+{
+	Shutdown();
+}
+
+bool VulkanEngine::ParallelRecorder::Init(VkDevice device, UINT32 queueFamily, UINT32 framesInFlight, JobSystem& jobs, UINT32 sliceCount)
+{
+	_device = device;
+	_jobs = &jobs;
+	_sliceCount = sliceCount;
+
+	VkCommandPoolCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	createInfo.queueFamilyIndex = queueFamily;
+
+	// Any job thread may pick up a slice, so each of them needs its own pools
+	for (UINT32 i = 0; i < jobs.GetThreadCount(); i++)
+	{
+		UPTR<ThreadPools> thread = MAKE_UPTR<ThreadPools>();
+		thread->pools.resize(framesInFlight, VK_NULL_HANDLE);
+		thread->buffers.resize(framesInFlight);
+		thread->usedBuffers.resize(framesInFlight, 0);
+
+		for (UINT32 frame = 0; frame < framesInFlight; frame++)
+		{
+			if (vkCreateCommandPool(_device, &createInfo, nullptr, &thread->pools[frame]) != VK_SUCCESS)
+			{
+				fprintf(stderr, "Failed to create Recording Command Pool\n");
+				_threads.push_back(std::move(thread));
+				return false;
+			}
+		}
+
+		_threads.push_back(std::move(thread));
+	}
+
+	_recorded.resize(sliceCount, VK_NULL_HANDLE);
+
+	fprintf(stdout, "Created Parallel Recorder with %d slices over %d job threads\n", sliceCount, jobs.GetThreadCount());
+	return true;
+}
+
+void VulkanEngine::ParallelRecorder::Shutdown()
+{
+	for (auto& thread : _threads)
+	{
+		// Destroying a pool frees every buffer allocated from it
+		for (VkCommandPool pool : thread->pools)
+			if (pool != VK_NULL_HANDLE)
+				vkDestroyCommandPool(_device, pool, nullptr);
+	}
+
+	_threads.clear();
+}
+
+void VulkanEngine::ParallelRecorder::BeginFrame(UINT32 frame)
+{
+	for (auto& thread : _threads)
+	{
+		vkResetCommandPool(_device, thread->pools[frame], 0);
+		thread->usedBuffers[frame] = 0;
+	}
+}
+
+bool VulkanEngine::ParallelRecorder::Record(UINT32 frame, const VkCommandBufferInheritanceInfo& inheritance, size_t count, const RecordFunction& record)
+{
+	_frame = frame;
+	_count = count;
+	_inheritance = &inheritance;
+	_record = &record;
+	_failed.store(false, std::memory_order_relaxed);
+
+	// One slice per job so idle threads can steal whole slices
+	_jobs->ParallelFor(_sliceCount, 1,
+		[this](size_t begin, size_t end)
+		{
+			for (size_t slice = begin; slice < end; slice++)
+				if (!RecordSlice(static_cast<UINT32>(slice)))
+					_failed.store(true, std::memory_order_relaxed);
+		});
+
+	_executable.clear();
+	for (VkCommandBuffer commandBuffer : _recorded)
+		if (commandBuffer != VK_NULL_HANDLE)
+			_executable.push_back(commandBuffer);
+
+	// ParallelFor waited for every slice, which orders their stores before this load
+	return !_failed.load(std::memory_order_relaxed);
+}
+
+bool VulkanEngine::ParallelRecorder::RecordSlice(UINT32 slice)
+{
+	size_t begin = _count * slice / _sliceCount;
+	size_t end = _count * (slice + 1) / _sliceCount;
+
+	_recorded[slice] = VK_NULL_HANDLE;
+	if (begin == end)
+		return true;
+
+	UINT32 threadIndex = JobSystem::GetThreadIndex();
+	assert(threadIndex < _threads.size());
+
+	VkCommandBuffer commandBuffer = AcquireBuffer(*_threads[threadIndex]);
+	if (commandBuffer == VK_NULL_HANDLE)
+		return false;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = _inheritance;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to begin Secondary Command Buffer of slice %u\n", slice);
+		return false;
+	}
+
+	(*_record)(commandBuffer, begin, end);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to record Secondary Command Buffer of slice %u\n", slice);
+		return false;
+	}
+
+	_recorded[slice] = commandBuffer;
+	return true;
+}
+
+VkCommandBuffer VulkanEngine::ParallelRecorder::AcquireBuffer(ThreadPools& thread)
+{
+	std::vector<VkCommandBuffer>& buffers = thread.buffers[_frame];
+	UINT32& used = thread.usedBuffers[_frame];
+
+	// Buffers survive pool resets, so they are allocated once and reused every frame
+	if (used == buffers.size())
+	{
+		VkCommandBufferAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = thread.pools[_frame];
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocateInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(_device, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+		{
+			fprintf(stderr, "Failed to allocate Secondary Command Buffer\n");
+			return VK_NULL_HANDLE;
+		}
+
+		buffers.push_back(commandBuffer);
+	}
+
+	return buffers[used++];
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Common.h>
+#include <atomic>
+#include <functional>
+#include <Jobs/JobSystem.h>
+
+namespace VulkanEngine
+{
+	// Splits recording of a draw list into slices run on the job system. Every job
+	// thread owns one command pool per frame in flight and records a secondary
+	// command buffer per slice it picks up, the caller stitches the results with
+	// vkCmdExecuteCommands.
+	class ParallelRecorder
+	{
+	public:
+		// Records draws [begin, end) into a secondary buffer that already began with render pass continuation
+		using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, size_t begin, size_t end)>;
+
+	private:
+		// Indexed by job system thread, only ever touched by that thread
+		struct ThreadPools
+		{
+			// Indexed by frame in flight
+			std::vector<VkCommandPool> pools;
+			std::vector<std::vector<VkCommandBuffer>> buffers;
+			std::vector<UINT32> usedBuffers;
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+		JobSystem* _jobs = nullptr;
+		std::vector<UPTR<ThreadPools>> _threads;
+		UINT32 _sliceCount = 0;
+
+		// Current task, only valid during Record
+		UINT32 _frame = 0;
+		size_t _count = 0;
+		const VkCommandBufferInheritanceInfo* _inheritance = nullptr;
+		const RecordFunction* _record = nullptr;
+		std::vector<VkCommandBuffer> _recorded;
+		std::vector<VkCommandBuffer> _executable;
+		std::atomic<bool> _failed = false;
+
+		// Leaves the slice's buffer in _recorded, VK_NULL_HANDLE when the slice is empty or failed
+		bool RecordSlice(UINT32 slice);
+		VkCommandBuffer AcquireBuffer(ThreadPools& thread);
+
+	public:
+		ParallelRecorder() = default;
+		~ParallelRecorder();
+
+		bool Init(VkDevice device, UINT32 queueFamily, UINT32 framesInFlight, JobSystem& jobs, UINT32 sliceCount);
+		void Shutdown();
+
+		// Resets every thread's pool of this frame slot with a single vkResetCommandPool each,
+		// the slot's fence must have been waited on
+		void BeginFrame(UINT32 frame);
+
+		// Blocks until all slices of [0, count) are recorded. Returns false when any slice failed, the
+		// frame would miss its draws then. Must be called from the thread that initialized the job system.
+		bool Record(UINT32 frame, const VkCommandBufferInheritanceInfo& inheritance, size_t count, const RecordFunction& record);
+
+		// The non empty secondary buffers of the last Record in draw order
+		inline const std::vector<VkCommandBuffer>& GetCommandBuffers() const { return _executable; }
+
+		inline UINT32 GetSliceCount() const { return _sliceCount; }
+
+	public:
+		ParallelRecorder(const ParallelRecorder&) = delete;
+		ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+	};
+}
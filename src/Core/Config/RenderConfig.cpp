@@ -0,0 +1,239 @@
+#include "RenderConfig.h"
+
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	// The whole value has to be a number, "2x" is rejected rather than read as 2. Base 0 accepts a 0x prefix.
+	// The result is only written on success so a bad value keeps the previous setting
+	template<typename T>
+	bool ParseNumber(const std::string& text, T& result, int base = 10)
+	{
+		const char* first = text.data();
+		const char* last = first + text.size();
+
+		T value{};
+		std::from_chars_result parsed;
+		if constexpr (std::is_floating_point_v<T>)
+			parsed = std::from_chars(first, last, value);
+		else
+		{
+			if (base == 0)
+			{
+				bool hex = text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+				first += hex ? 2 : 0;
+				base = hex ? 16 : 10;
+			}
+			parsed = std::from_chars(first, last, value, base);
+		}
+
+		if (parsed.ec != std::errc() || parsed.ptr != last)
+			return false;
+
+		result = value;
+		return true;
+	}
+}
+
+VulkanEngine::RenderConfig VulkanEngine::RenderConfig::ParseCommandLine(int argc, char** argv)
+{
+	RenderConfig config;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		std::string value;
+
+		size_t separator = arg.find('=');
+		if (separator != std::string::npos)
+		{
+			value = arg.substr(separator + 1);
+			arg = arg.substr(0, separator);
+		}
+
+		if (arg.rfind("--", 0) != 0)
+			fprintf(stderr, "Ignoring unknown argument '%s'\n", argv[i]);
+		else if (arg == "--config" && !value.empty())
+		{
+			// Flags after --config override the file, flags before it are overridden
+			config.configPath = value;
+			LoadFile(value, config);
+		}
+		else if (!config.ApplyOption(arg.substr(2), value))
+			fprintf(stderr, "Ignoring unknown or malformed argument '%s'\n", argv[i]);
+	}
+
+	config.Validate();
+
+	return config;
+}
+
+bool VulkanEngine::RenderConfig::LoadFile(const std::string& path, RenderConfig& config)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		fprintf(stderr, "Failed to open config file '%s'\n", path.c_str());
+		return false;
+	}
+
+	auto trim = [](const std::string& text)
+	{
+		size_t first = text.find_first_not_of(" \t\r");
+		size_t last = text.find_last_not_of(" \t\r");
+		return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+	};
+
+	std::string line;
+	UINT32 lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line = line.substr(0, comment);
+
+		line = trim(line);
+		if (line.empty())
+			continue;
+
+		std::string key = line;
+		std::string value;
+
+		size_t separator = line.find('=');
+		if (separator != std::string::npos)
+		{
+			key = trim(line.substr(0, separator));
+			value = trim(line.substr(separator + 1));
+		}
+
+		if (!config.ApplyOption(key, value))
+			fprintf(stderr, "%s:%u : Ignoring unknown or malformed setting '%s'\n", path.c_str(), lineNumber, line.c_str());
+	}
+
+	config.Validate();
+
+	return true;
+}
+
+const char* VulkanEngine::RenderConfig::GetPresentPolicyName(PresentPolicy policy)
+{
+	switch (policy)
+	{
+	case PresentPolicy::LowestLatency:		return "lowest-latency";
+	case PresentPolicy::HighestThroughput:	return "highest-throughput";
+	case PresentPolicy::PowerSaving:		return "power-saving";
+	}
+
+	return "unknown";
+}
+
+bool VulkanEngine::RenderConfig::ApplyOption(const std::string& key, const std::string& value)
+{
+	if (key == "headless")
+		headless = value.empty() || value == "true" || value == "1";
+	else if (key == "width")
+		return ParseNumber(value, width);
+	else if (key == "height")
+		return ParseNumber(value, height);
+	else if (key == "frames")
+		return ParseNumber(value, frameCount);
+	else if (key == "capture" && !value.empty())
+		capturePath = value;
+	else if (key == "profile" && !value.empty())
+		profilePath = value;
+	else if (key == "pipeline-cache")
+		pipelineCachePath = value;
+	else if (key == "shader-cache")
+		shaderCachePath = value;
+	else if (key == "job-threads")
+		return ParseNumber(value, jobThreads);
+	else if (key == "record-threads")
+		return ParseNumber(value, recordThreads);
+	else if (key == "hot-reload")
+		shaderHotReload = value.empty() || value == "true" || value == "1";
+	else if (key == "features")
+		return ParseNumber(value, shaderFeatures, 0);
+	else if (key == "prewarm")
+	{
+		std::vector<UINT32> variants;
+
+		std::stringstream list(value);
+		std::string variant;
+		while (std::getline(list, variant, ','))
+		{
+			UINT32 features = 0;
+			if (variant.empty())
+				continue;
+			if (!ParseNumber(variant, features, 0))
+				return false;
+			variants.push_back(features);
+		}
+
+		prewarmVariants = std::move(variants);
+	}
+	else if (key == "io-threads")
+		return ParseNumber(value, ioThreads);
+	else if (key == "draws")
+		return ParseNumber(value, drawCount);
+	else if (key == "mesh")
+		return ParseNumber(value, meshDetail);
+	else if (key == "quantize")
+		quantizeVertices = value.empty() || value == "true" || value == "1";
+	else if (key == "instances")
+		return ParseNumber(value, instanceCount);
+	else if (key == "instance-benchmark")
+		instanceBenchmark = value.empty() || value == "true" || value == "1";
+	else if (key == "gpu-culling")
+		gpuCulling = value.empty() || value == "true" || value == "1";
+	else if (key == "async-compute")
+		asyncCompute = value.empty() || value == "true" || value == "1";
+	else if (key == "cpu-culling")
+		cpuCulling = value.empty() || value == "true" || value == "1";
+	else if (key == "cull-benchmark")
+		cullBenchmark = value.empty() || value == "true" || value == "1";
+	else if (key == "zoom")
+		return ParseNumber(value, viewZoom);
+	else if (key == "sync" && (value == "fence" || value == "timeline"))
+		syncBackend = value == "fence" ? SyncBackend::Fence : SyncBackend::Timeline;
+	else if (key == "frames-in-flight")
+		return ParseNumber(value, framesInFlight);
+	else if (key == "swapchain-images")
+		return ParseNumber(value, swapchainImages);
+	else if (key == "present" && value == GetPresentPolicyName(PresentPolicy::LowestLatency))
+		presentPolicy = PresentPolicy::LowestLatency;
+	else if (key == "present" && value == GetPresentPolicyName(PresentPolicy::HighestThroughput))
+		presentPolicy = PresentPolicy::HighestThroughput;
+	else if (key == "present" && value == GetPresentPolicyName(PresentPolicy::PowerSaving))
+		presentPolicy = PresentPolicy::PowerSaving;
+	else
+		return false;
+
+	return true;
+}
+
+void VulkanEngine::RenderConfig::Validate()
+{
+	if (framesInFlight < 1 || framesInFlight > MAX_FRAMES_IN_FLIGHT)
+	{
+		UINT32 clamped = std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+		fprintf(stderr, "Frames in flight %d is out of range, using %d\n", framesInFlight, clamped);
+		framesInFlight = clamped;
+	}
+
+	if (headless && frameCount == 0)
+		frameCount = DEFAULT_HEADLESS_FRAMES;
+
+	// Instances are copies of the mesh, the triangle can't be instanced
+	if ((instanceBenchmark || instanceCount > 1 || gpuCulling || cpuCulling) && meshDetail == 0)
+		meshDetail = DEFAULT_MESH_DETAIL;
+
+	if (viewZoom <= 0.0f)
+	{
+		fprintf(stderr, "Zoom %.2f is not positive, using 1\n", viewZoom);
+		viewZoom = 1.0f;
+	}
+}
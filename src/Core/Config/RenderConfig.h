@@ -0,0 +1,126 @@
+#pragma once
+
+#include <Common.h>
+
+namespace VulkanEngine
+{
+	enum class SyncBackend
+	{
+		Fence,		// One fence and binary semaphores per frame slot
+		Timeline	// One timeline semaphore counting frames, needs Vulkan 1.2
+	};
+
+	enum class PresentPolicy
+	{
+		LowestLatency,		// MAILBOX, then IMMEDIATE, frames never queue behind vblank
+		HighestThroughput,	// IMMEDIATE, then MAILBOX, tearing is accepted
+		PowerSaving			// FIFO, paced by the display refresh
+	};
+
+	struct RenderConfig
+	{
+		// Renders into device owned color images instead of a window swap chain,
+		// no GLFW window or presentation engine is created in this mode
+		bool headless = false;
+
+		UINT32 width = 800;
+		UINT32 height = 600;
+
+		// Number of frames to render before Run returns, 0 means until the window is closed
+		// Headless mode has no window to close so it falls back to DEFAULT_HEADLESS_FRAMES
+		UINT64 frameCount = 0;
+
+		// When set, the last rendered frame is read back and written as a binary PPM
+		std::string capturePath;
+
+		// When set, frame timings are written to <profilePath>.csv and <profilePath>.json on shutdown
+		std::string profilePath;
+
+		// Driver pipeline cache persisted across runs, empty disables persistence
+		std::string pipelineCachePath = "cache/pipeline.cache";
+
+		// Optimized SPIR-V keyed by source, defines and compiler version, empty recompiles every run
+		std::string shaderCachePath = "cache/shaders";
+
+		// Job system worker threads besides the main thread, -1 picks one less than the core count
+		INT32 jobThreads = -1;
+
+		// Slices the draw list is recorded in on the job system, -1 picks one per job thread, 0 records inline only
+		INT32 recordThreads = -1;
+
+		// Asset loader threads, they mostly wait on the disk so they are kept off the job system
+		UINT32 ioThreads = 2;
+
+		// Recompiles GLSL in res/Shaders when saved and rebuilds the pipelines using it while running
+		bool shaderHotReload = false;
+
+		// Shader feature bits the pipelines are specialized with, can change while running
+		UINT32 shaderFeatures = 0;
+
+		// Feature bit combinations compiled at startup next to the active one, comma separated
+		std::vector<UINT32> prewarmVariants;
+
+		// Number of draws in the stand in draw list
+		UINT32 drawCount = 1;
+
+		// Segments of the sphere mesh drawn instead of the triangle, 0 keeps the triangle
+		UINT32 meshDetail = 0;
+
+		// Stores mesh vertices in 16 bit snorm, half and octahedral encodings instead of floats
+		bool quantizeVertices = true;
+
+		// Copies of the mesh drawn with one instanced draw, laid out on a grid
+		UINT32 instanceCount = 1;
+
+		// Renders frameCount frames at every instance count from 1k to 1M and prints the frame times
+		bool instanceBenchmark = false;
+
+		// Culls the instances in a compute pass and draws the survivors with indirect draws, picking a lod per instance
+		bool gpuCulling = false;
+
+		// Submits compute passes such as GPU culling to a separate compute queue when the device has one,
+		// needs the timeline backend. Otherwise they are recorded at the start of the graphics work
+		bool asyncCompute = true;
+
+		// Frustum culls the instances on the CPU before they are batched, when GPU culling is off
+		bool cpuCulling = false;
+
+		// Times the scalar and SIMD frustum culling kernels over 500k spheres and 500k boxes, then exits
+		bool cullBenchmark = false;
+
+		// Magnifies the instance grid, above 1 part of it leaves the view and gets culled
+		float viewZoom = 1.0f;
+
+		// Falls back to Fence when the device has no timeline semaphore support
+		SyncBackend syncBackend = SyncBackend::Timeline;
+
+		// Settings below can change while running, they are applied by recreating the swap chain
+
+		// Frames the CPU may record ahead of the GPU, clamped to [1, MAX_FRAMES_IN_FLIGHT]
+		UINT32 framesInFlight = 2;
+
+		// Requested swap chain images, 0 picks minImageCount + 1, clamped to the surface limits
+		UINT32 swapchainImages = 0;
+
+		PresentPolicy presentPolicy = PresentPolicy::LowestLatency;
+
+		// File the settings were loaded from, watched for changes while running
+		std::string configPath;
+
+		static constexpr UINT32 MAX_FRAMES_IN_FLIGHT = 4;
+		static constexpr UINT64 DEFAULT_HEADLESS_FRAMES = 1000;
+		static constexpr UINT32 DEFAULT_MESH_DETAIL = 16;
+
+		static RenderConfig ParseCommandLine(int argc, char** argv);
+
+		// Reads key=value lines using the command line names without dashes, # starts a comment
+		static bool LoadFile(const std::string& path, RenderConfig& config);
+
+		static const char* GetPresentPolicyName(PresentPolicy policy);
+
+	private:
+		// False for an unknown key or a value that doesn't parse, the setting keeps its previous value
+		bool ApplyOption(const std::string& key, const std::string& value);
+		void Validate();
+	};
+}
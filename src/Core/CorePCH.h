@@ -3,5 +3,52 @@
 #include <FileIO.h>
 
 // Window
+#include <Shader/ShaderReflection.h>
+#include <Shader/Specialization.h>
 #include <Shader/Shader.h>
-#include <Window/Window.h>
\ No newline at end of file
+#include <Shader/ShaderServer.h>
+#include <Shader/ShaderCompiler.h>
+#include <Shader/ShaderWatcher.h>
+#include <Window/Window.h>
+
+// Config
+#include <Config/RenderConfig.h>
+
+// Profiler
+#include <Profiler/FrameProfiler.h>
+
+// Pipeline
+#include <Pipeline/PipelineCache.h>
+#include <Pipeline/PipelineCompiler.h>
+#include <Pipeline/LayoutCache.h>
+#include <Pipeline/PipelineDesc.h>
+#include <Pipeline/PipelineLibrary.h>
+
+// Jobs
+#include <Jobs/JobSystem.h>
+
+// Commands
+#include <Commands/ParallelRecorder.h>
+#include <Commands/ComputeScheduler.h>
+
+// Memory
+#include <Memory/MemoryAllocator.h>
+#include <Memory/UploadManager.h>
+#include <Memory/DeletionQueue.h>
+
+// Assets
+#include <Assets/BoundedQueue.h>
+#include <Assets/AssetLoader.h>
+
+// Mesh
+#include <Mesh/Quantize.h>
+#include <Mesh/VertexFormat.h>
+#include <Mesh/Mesh.h>
+#include <Mesh/InstanceBatcher.h>
+
+// Culling
+#include <Culling/GpuCuller.h>
+#include <Culling/FrustumCuller.h>
+
+// Sync
+#include <Sync/TimelineSemaphore.h>
\ No newline at end of file
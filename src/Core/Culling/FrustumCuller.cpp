@@ -0,0 +1,430 @@
+#include "FrustumCuller.h"
+#include <bit>
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_CULLER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CULL_AVX_TARGET
+#else
+#define CULL_AVX_TARGET __attribute__((target("avx")))
+#endif
+#endif
+
+namespace
+{
+	using VulkanEngine::Frustum;
+	using VulkanEngine::FrustumCuller;
+
+	constexpr size_t BLOCK_SIZE = FrustumCuller::BLOCK_SIZE;
+
+	// Component arrays of the set being culled, the extents are only read for boxes
+	struct CullInput
+	{
+		const float* x = nullptr;
+		const float* y = nullptr;
+		const float* z = nullptr;
+		const float* radius = nullptr;
+		const float* extentX = nullptr;
+		const float* extentY = nullptr;
+		const float* extentZ = nullptr;
+	};
+
+	// Writes the visibility words of blocks [firstBlock, lastBlock), count bounds the last block
+	using KernelFunction = void(*)(const CullInput& input, const Frustum& frustum, size_t firstBlock, size_t lastBlock, size_t count, UINT64* words);
+
+	// The SIMD kernels evaluate the same expressions in the same order, so their
+	// results match this bit for bit. A box is projected onto each plane normal,
+	// its radius along it being dot(abs(normal), extent).
+	template<bool BOXES>
+	bool IsVisible(const CullInput& input, const Frustum& frustum, size_t i)
+	{
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			float distance = plane.x * input.x[i] + plane.y * input.y[i] + plane.z * input.z[i] + plane.w;
+			float radius;
+			if constexpr (BOXES)
+				radius = std::abs(plane.x) * input.extentX[i] + std::abs(plane.y) * input.extentY[i] + std::abs(plane.z) * input.extentZ[i];
+			else
+				radius = input.radius[i];
+
+			if (!(distance + radius >= 0.0f))
+				return false;
+		}
+		return true;
+	}
+
+	template<bool BOXES>
+	void CullScalar(const CullInput& input, const Frustum& frustum, size_t firstBlock, size_t lastBlock, size_t count, UINT64* words)
+	{
+		for (size_t block = firstBlock; block < lastBlock; block++)
+		{
+			size_t begin = block * BLOCK_SIZE;
+			size_t end = std::min(count, begin + BLOCK_SIZE);
+
+			UINT64 word = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				if (IsVisible<BOXES>(input, frustum, i))
+					word |= 1ull << (i - begin);
+			}
+			words[block] = word;
+		}
+	}
+
+#ifdef FRUSTUM_CULLER_X86
+	template<bool BOXES>
+	void CullSse(const CullInput& input, const Frustum& frustum, size_t firstBlock, size_t lastBlock, size_t count, UINT64* words)
+	{
+		__m128 nx[Frustum::PlaneCount], ny[Frustum::PlaneCount], nz[Frustum::PlaneCount], nw[Frustum::PlaneCount];
+		__m128 ax[Frustum::PlaneCount], ay[Frustum::PlaneCount], az[Frustum::PlaneCount];
+		for (UINT32 p = 0; p < Frustum::PlaneCount; p++)
+		{
+			const glm::vec4& plane = frustum.planes[p];
+			nx[p] = _mm_set1_ps(plane.x);
+			ny[p] = _mm_set1_ps(plane.y);
+			nz[p] = _mm_set1_ps(plane.z);
+			nw[p] = _mm_set1_ps(plane.w);
+			ax[p] = _mm_set1_ps(std::abs(plane.x));
+			ay[p] = _mm_set1_ps(std::abs(plane.y));
+			az[p] = _mm_set1_ps(std::abs(plane.z));
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 allVisible = _mm_cmpeq_ps(zero, zero);
+
+		for (size_t block = firstBlock; block < lastBlock; block++)
+		{
+			size_t begin = block * BLOCK_SIZE;
+			size_t end = std::min(count, begin + BLOCK_SIZE);
+
+			UINT64 word = 0;
+			size_t i = begin;
+			for (; i + 4 <= end; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(input.x + i);
+				__m128 y = _mm_loadu_ps(input.y + i);
+				__m128 z = _mm_loadu_ps(input.z + i);
+
+				__m128 radius, ex, ey, ez;
+				if constexpr (BOXES)
+				{
+					ex = _mm_loadu_ps(input.extentX + i);
+					ey = _mm_loadu_ps(input.extentY + i);
+					ez = _mm_loadu_ps(input.extentZ + i);
+				}
+				else
+					radius = _mm_loadu_ps(input.radius + i);
+
+				__m128 visible = allVisible;
+				for (UINT32 p = 0; p < Frustum::PlaneCount; p++)
+				{
+					__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)), _mm_mul_ps(nz[p], z)), nw[p]);
+					if constexpr (BOXES)
+						radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+
+					visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+				}
+				word |= static_cast<UINT64>(_mm_movemask_ps(visible)) << (i - begin);
+			}
+
+			for (; i < end; i++)
+			{
+				if (IsVisible<BOXES>(input, frustum, i))
+					word |= 1ull << (i - begin);
+			}
+			words[block] = word;
+		}
+	}
+
+	template<bool BOXES>
+	CULL_AVX_TARGET void CullAvx(const CullInput& input, const Frustum& frustum, size_t firstBlock, size_t lastBlock, size_t count, UINT64* words)
+	{
+		__m256 nx[Frustum::PlaneCount], ny[Frustum::PlaneCount], nz[Frustum::PlaneCount], nw[Frustum::PlaneCount];
+		__m256 ax[Frustum::PlaneCount], ay[Frustum::PlaneCount], az[Frustum::PlaneCount];
+		for (UINT32 p = 0; p < Frustum::PlaneCount; p++)
+		{
+			const glm::vec4& plane = frustum.planes[p];
+			nx[p] = _mm256_set1_ps(plane.x);
+			ny[p] = _mm256_set1_ps(plane.y);
+			nz[p] = _mm256_set1_ps(plane.z);
+			nw[p] = _mm256_set1_ps(plane.w);
+			ax[p] = _mm256_set1_ps(std::abs(plane.x));
+			ay[p] = _mm256_set1_ps(std::abs(plane.y));
+			az[p] = _mm256_set1_ps(std::abs(plane.z));
+		}
+
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 allVisible = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+
+		for (size_t block = firstBlock; block < lastBlock; block++)
+		{
+			size_t begin = block * BLOCK_SIZE;
+			size_t end = std::min(count, begin + BLOCK_SIZE);
+
+			UINT64 word = 0;
+			size_t i = begin;
+			for (; i + 8 <= end; i += 8)
+			{
+				__m256 x = _mm256_loadu_ps(input.x + i);
+				__m256 y = _mm256_loadu_ps(input.y + i);
+				__m256 z = _mm256_loadu_ps(input.z + i);
+
+				__m256 radius, ex, ey, ez;
+				if constexpr (BOXES)
+				{
+					ex = _mm256_loadu_ps(input.extentX + i);
+					ey = _mm256_loadu_ps(input.extentY + i);
+					ez = _mm256_loadu_ps(input.extentZ + i);
+				}
+				else
+					radius = _mm256_loadu_ps(input.radius + i);
+
+				// No FMA, fused rounding would make objects on a plane disagree with the scalar reference
+				__m256 visible = allVisible;
+				for (UINT32 p = 0; p < Frustum::PlaneCount; p++)
+				{
+					__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)), _mm256_mul_ps(nz[p], z)), nw[p]);
+					if constexpr (BOXES)
+						radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+
+					visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+				}
+				word |= static_cast<UINT64>(_mm256_movemask_ps(visible)) << (i - begin);
+			}
+
+			for (; i < end; i++)
+			{
+				if (IsVisible<BOXES>(input, frustum, i))
+					word |= 1ull << (i - begin);
+			}
+			words[block] = word;
+		}
+	}
+
+	bool CpuSupportsAvx()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		bool osSaves = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+
+		// The OS also has to preserve the upper halves of the YMM registers across context switches
+		return osSaves && avx && (_xgetbv(0) & 0x6) == 0x6;
+#else
+		return __builtin_cpu_supports("avx");
+#endif
+	}
+#endif
+
+	template<bool BOXES>
+	KernelFunction GetKernelFunction(VulkanEngine::CullKernel kernel)
+	{
+		switch (kernel)
+		{
+#ifdef FRUSTUM_CULLER_X86
+		case VulkanEngine::CullKernel::SSE:
+			return CullSse<BOXES>;
+		case VulkanEngine::CullKernel::AVX:
+			return CullAvx<BOXES>;
+#endif
+		default:
+			return CullScalar<BOXES>;
+		}
+	}
+
+	UINT32 CullSet(const CullInput& input, size_t count, const Frustum& frustum, KernelFunction kernel,
+		VulkanEngine::JobSystem* jobs, bool parallel, std::vector<UINT64>& visibility)
+	{
+		size_t blockCount = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		visibility.resize(blockCount);
+		UINT64* words = visibility.data();
+
+		if (parallel && jobs != nullptr && count >= FrustumCuller::PARALLEL_THRESHOLD)
+		{
+			jobs->ParallelFor(blockCount, FrustumCuller::PARALLEL_GRAIN / BLOCK_SIZE, [&](size_t begin, size_t end)
+			{
+				kernel(input, frustum, begin, end, count, words);
+			});
+		}
+		else
+			kernel(input, frustum, 0, blockCount, count, words);
+
+		UINT32 visible = 0;
+		for (UINT64 word : visibility)
+			visible += static_cast<UINT32>(std::popcount(word));
+		return visible;
+	}
+}
+
+VulkanEngine::Frustum VulkanEngine::Frustum::FromMatrix(const glm::mat4& clipFromWorld)
+{
+	auto row = [&clipFromWorld](int i)
+	{
+		return glm::vec4(clipFromWorld[0][i], clipFromWorld[1][i], clipFromWorld[2][i], clipFromWorld[3][i]);
+	};
+
+	// Gribb and Hartmann, -w <= x, y <= w and 0 <= z <= w in clip space
+	Frustum frustum;
+	frustum.planes[Left] = row(3) + row(0);
+	frustum.planes[Right] = row(3) - row(0);
+	frustum.planes[Bottom] = row(3) + row(1);
+	frustum.planes[Top] = row(3) - row(1);
+	frustum.planes[Near] = row(2);
+	frustum.planes[Far] = row(3) - row(2);
+
+	// Normalized so a plane's w is the distance in world units and sphere radii compare against it
+	for (glm::vec4& plane : frustum.planes)
+	{
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f)
+			plane /= length;
+	}
+
+	return frustum;
+}
+
+bool VulkanEngine::FrustumCuller::Init(JobSystem& jobs)
+{
+	_jobs = &jobs;
+
+	_kernel = CullKernel::Scalar;
+	for (CullKernel kernel : { CullKernel::SSE, CullKernel::AVX })
+	{
+		if (IsKernelSupported(kernel))
+			_kernel = kernel;
+	}
+
+	fprintf(stdout, "Created Frustum Culler (%s kernel)\n", GetKernelName(_kernel));
+	return true;
+}
+
+void VulkanEngine::FrustumCuller::SetKernel(CullKernel kernel)
+{
+	if (!IsKernelSupported(kernel))
+	{
+		fprintf(stderr, "%s culling is not supported on this CPU, keeping %s\n", GetKernelName(kernel), GetKernelName(_kernel));
+		return;
+	}
+
+	_kernel = kernel;
+}
+
+bool VulkanEngine::FrustumCuller::IsKernelSupported(CullKernel kernel)
+{
+	switch (kernel)
+	{
+	case CullKernel::Scalar:
+		return true;
+#ifdef FRUSTUM_CULLER_X86
+	case CullKernel::SSE:
+		return true;	// Part of every x64 CPU and the Win32 target's baseline
+	case CullKernel::AVX:
+	{
+		static const bool supported = CpuSupportsAvx();
+		return supported;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+const char* VulkanEngine::FrustumCuller::GetKernelName(CullKernel kernel)
+{
+	switch (kernel)
+	{
+	case CullKernel::Scalar:
+		return "Scalar";
+	case CullKernel::SSE:
+		return "SSE";
+	case CullKernel::AVX:
+		return "AVX";
+	default:
+		return "Unknown";
+	}
+}
+
+UINT32 VulkanEngine::FrustumCuller::AddSphere(const glm::vec3& center, float radius)
+{
+	UINT32 index = static_cast<UINT32>(_spheres.x.size());
+	_spheres.x.push_back(center.x);
+	_spheres.y.push_back(center.y);
+	_spheres.z.push_back(center.z);
+	_spheres.radius.push_back(radius);
+	return index;
+}
+
+UINT32 VulkanEngine::FrustumCuller::AddBox(const glm::vec3& center, const glm::vec3& extent)
+{
+	UINT32 index = static_cast<UINT32>(_boxes.x.size());
+	_boxes.x.push_back(center.x);
+	_boxes.y.push_back(center.y);
+	_boxes.z.push_back(center.z);
+	_boxes.extentX.push_back(extent.x);
+	_boxes.extentY.push_back(extent.y);
+	_boxes.extentZ.push_back(extent.z);
+	return index;
+}
+
+void VulkanEngine::FrustumCuller::Reserve(size_t sphereCount, size_t boxCount)
+{
+	for (std::vector<float>* component : { &_spheres.x, &_spheres.y, &_spheres.z, &_spheres.radius })
+		component->reserve(sphereCount);
+
+	for (std::vector<float>* component : { &_boxes.x, &_boxes.y, &_boxes.z, &_boxes.extentX, &_boxes.extentY, &_boxes.extentZ })
+		component->reserve(boxCount);
+}
+
+void VulkanEngine::FrustumCuller::Clear()
+{
+	_spheres = {};
+	_boxes = {};
+	_sphereVisibility.clear();
+	_boxVisibility.clear();
+	_stats = {};
+}
+
+UINT32 VulkanEngine::FrustumCuller::Cull(const Frustum& frustum)
+{
+	return Cull(frustum, _kernel, true);
+}
+
+UINT32 VulkanEngine::FrustumCuller::Cull(const Frustum& frustum, CullKernel kernel, bool parallel)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (!IsKernelSupported(kernel))
+		kernel = CullKernel::Scalar;
+
+	CullInput spheres;
+	spheres.x = _spheres.x.data();
+	spheres.y = _spheres.y.data();
+	spheres.z = _spheres.z.data();
+	spheres.radius = _spheres.radius.data();
+
+	CullInput boxes;
+	boxes.x = _boxes.x.data();
+	boxes.y = _boxes.y.data();
+	boxes.z = _boxes.z.data();
+	boxes.extentX = _boxes.extentX.data();
+	boxes.extentY = _boxes.extentY.data();
+	boxes.extentZ = _boxes.extentZ.data();
+
+	_stats.spheres = static_cast<UINT32>(GetSphereCount());
+	_stats.boxes = static_cast<UINT32>(GetBoxCount());
+	_stats.visibleSpheres = CullSet(spheres, GetSphereCount(), frustum, GetKernelFunction<false>(kernel), _jobs, parallel, _sphereVisibility);
+	_stats.visibleBoxes = CullSet(boxes, GetBoxCount(), frustum, GetKernelFunction<true>(kernel), _jobs, parallel, _boxVisibility);
+
+	_stats.cullTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return _stats.visibleSpheres + _stats.visibleBoxes;
+}
+
+void VulkanEngine::FrustumCuller::PrintStats() const
+{
+	fprintf(stdout, "Frustum Culler : %u of %u spheres and %u of %u boxes visible in %.3f ms (%s kernel)\n",
+		_stats.visibleSpheres, _stats.spheres, _stats.visibleBoxes, _stats.boxes, _stats.cullTime, GetKernelName(_kernel));
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Common.h>
+#include <glm/glm.hpp>
+#include <Jobs/JobSystem.h>
+
+namespace VulkanEngine
+{
+	// Six inward facing planes, a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+	struct Frustum
+	{
+		enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+		glm::vec4 planes[PlaneCount];
+
+		// Extracts the planes of a clip from world matrix with Vulkan's [0, 1] depth range
+		static Frustum FromMatrix(const glm::mat4& clipFromWorld);
+	};
+
+	enum class CullKernel
+	{
+		Scalar,		// Reference, one object at a time
+		SSE,		// Four objects per instruction
+		AVX,		// Eight objects per instruction, picked at runtime when the CPU and OS support it
+		Count
+	};
+
+	// CPU frustum culling of bounding spheres and axis aligned boxes. Bounds are
+	// stored as a structure of arrays so the SIMD kernels load four or eight objects
+	// of one component at a time, and each object's visibility is one bit of a mask.
+	// Ranges of whole 64 object blocks are spread across the job system, so no two
+	// workers ever write the same mask word.
+	class FrustumCuller
+	{
+	public:
+		static constexpr size_t BLOCK_SIZE = 64;	// Objects per visibility word
+
+		// Below this many objects a cull runs inline, above it is split across the job system
+		static constexpr size_t PARALLEL_THRESHOLD = 32 * 1024;
+		static constexpr size_t PARALLEL_GRAIN = 8 * 1024;
+
+		struct Stats
+		{
+			UINT32 spheres = 0;
+			UINT32 boxes = 0;
+			UINT32 visibleSpheres = 0;
+			UINT32 visibleBoxes = 0;
+			double cullTime = 0;	// Milliseconds of the last cull
+		};
+
+		// Structure of arrays, entry i of every vector belongs to object i
+		struct SphereSet
+		{
+			std::vector<float> x, y, z, radius;
+		};
+
+		struct BoxSet
+		{
+			std::vector<float> x, y, z;						// Center
+			std::vector<float> extentX, extentY, extentZ;	// Half size
+		};
+
+	private:
+		JobSystem* _jobs = nullptr;
+		CullKernel _kernel = CullKernel::Scalar;
+
+		SphereSet _spheres;
+		BoxSet _boxes;
+
+		std::vector<UINT64> _sphereVisibility;
+		std::vector<UINT64> _boxVisibility;
+
+		Stats _stats;
+
+	public:
+		FrustumCuller() = default;
+
+		// Picks the widest kernel the CPU supports
+		bool Init(JobSystem& jobs);
+
+		void SetKernel(CullKernel kernel);
+		inline CullKernel GetKernel() const { return _kernel; }
+
+		static bool IsKernelSupported(CullKernel kernel);
+		static const char* GetKernelName(CullKernel kernel);
+
+		// Returns the object index
+		UINT32 AddSphere(const glm::vec3& center, float radius);
+		UINT32 AddBox(const glm::vec3& center, const glm::vec3& extent);
+		void Reserve(size_t sphereCount, size_t boxCount);
+		void Clear();
+
+		// Tests every object against the frustum, returns how many are visible
+		UINT32 Cull(const Frustum& frustum);
+		UINT32 Cull(const Frustum& frustum, CullKernel kernel, bool parallel);
+
+		inline size_t GetSphereCount() const { return _spheres.x.size(); }
+		inline size_t GetBoxCount() const { return _boxes.x.size(); }
+
+		// Of the last Cull
+		inline bool IsSphereVisible(UINT32 index) const { return (_sphereVisibility[index / BLOCK_SIZE] >> (index % BLOCK_SIZE)) & 1; }
+		inline bool IsBoxVisible(UINT32 index) const { return (_boxVisibility[index / BLOCK_SIZE] >> (index % BLOCK_SIZE)) & 1; }
+		inline const std::vector<UINT64>& GetSphereVisibility() const { return _sphereVisibility; }
+		inline const std::vector<UINT64>& GetBoxVisibility() const { return _boxVisibility; }
+
+		inline const Stats& GetStats() const { return _stats; }
+		void PrintStats() const;
+
+	public:
+		FrustumCuller(const FrustumCuller&) = delete;
+		FrustumCuller& operator=(const FrustumCuller&) = delete;
+	};
+}
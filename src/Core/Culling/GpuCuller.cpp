@@ -0,0 +1,496 @@
+#include "GpuCuller.h"
+
+VulkanEngine::IndirectDrawSupport VulkanEngine::GpuCuller::QuerySupport(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	IndirectDrawSupport support;
+
+	// The draw count variant only exists as a core feature from Vulkan 1.2 on
+	if (deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+	{
+		VkPhysicalDeviceVulkan12Features features12{};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &features12;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+		support.firstInstance = features.features.drawIndirectFirstInstance == VK_TRUE;
+		support.multiDraw = features.features.multiDrawIndirect == VK_TRUE;
+		support.drawCount = features12.drawIndirectCount == VK_TRUE;
+	}
+	else
+	{
+		VkPhysicalDeviceFeatures features{};
+		vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+
+		support.firstInstance = features.drawIndirectFirstInstance == VK_TRUE;
+		support.multiDraw = features.multiDrawIndirect == VK_TRUE;
+	}
+
+	support.maxDrawCount = support.multiDraw ? std::max(deviceProperties.limits.maxDrawIndirectCount, 1u) : 1;
+	return support;
+}
+
+bool VulkanEngine::GpuCuller::Init(VkDevice device, MemoryAllocator& allocator, LayoutCache& layoutCache, PipelineCompiler& compiler,
+	const SPTR<Shader>& cullShader, const IndirectDrawSupport& support, std::span<const UINT32> queueFamilies,
+	bool graphicsQueue, UINT32 framesInFlight)
+{
+	_device = device;
+	_allocator = &allocator;
+	_support = support;
+	_graphicsQueue = graphicsQueue;
+
+	_queueFamilies.clear();
+	for (UINT32 family : queueFamilies)
+	{
+		if (std::find(_queueFamilies.begin(), _queueFamilies.end(), family) == _queueFamilies.end())
+			_queueFamilies.push_back(family);
+	}
+
+	if (!_support.firstInstance)
+	{
+		fprintf(stderr, "GPU culling needs drawIndirectFirstInstance\n");
+		return false;
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	VkPipelineLayout layout = layoutCache.GetPipelineLayout({ cullShader });
+	if (layout == VK_NULL_HANDLE || !layoutCache.GetSetLayouts({ cullShader }, setLayouts) || setLayouts.size() != 1)
+	{
+		fprintf(stderr, "Failed to create Cull Pipeline Layout\n");
+		return false;
+	}
+
+	_setLayout = setLayouts[0];
+
+	// Compaction needs the draw count, without it every lod keeps its own draw slot
+	SpecializationConstants specialization;
+	specialization.SetBool(0, UsesDrawCount());
+	VkSpecializationInfo specializationInfo = specialization.GetInfo();
+
+	VkComputePipelineCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	createInfo.stage = cullShader->GetStageInfo();
+	createInfo.stage.pSpecializationInfo = &specializationInfo;
+	createInfo.layout = layout;
+
+	_pipeline = compiler.CompileCompute(createInfo, "Cull");
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 6 * framesInFlight;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = framesInFlight;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptorPool) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create Cull Descriptor Pool\n");
+		return false;
+	}
+
+	_frames.resize(framesInFlight);
+	for (FrameResources& frame : _frames)
+	{
+		VkDescriptorSetAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = _descriptorPool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &_setLayout;
+
+		if (vkAllocateDescriptorSets(_device, &allocateInfo, &frame.descriptorSet) != VK_SUCCESS)
+		{
+			fprintf(stderr, "Failed to allocate Cull Descriptor Set\n");
+			return false;
+		}
+	}
+
+	const char* drawPath = UsesDrawCount() ? "compacted, indirect count" : _support.multiDraw ? "multi draw indirect" : "one indirect draw per lod";
+	fprintf(stdout, "Created GPU Culler (%s, %s buffers)\n", drawPath, IsConcurrent() ? "concurrent" : "exclusive");
+	return true;
+}
+
+void VulkanEngine::GpuCuller::Shutdown()
+{
+	for (FrameResources& frame : _frames)
+		DestroyFrameResources(frame);
+	_frames.clear();
+
+	if (_sceneBuffer != VK_NULL_HANDLE)
+		_allocator->DestroyBuffer(_sceneBuffer, _sceneAllocation);
+	_sceneBuffer = VK_NULL_HANDLE;
+	_sceneData.clear();
+	_sceneResident = false;
+
+	// Sets are freed with their pool, the layouts belong to the layout cache
+	if (_descriptorPool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+	_descriptorPool = VK_NULL_HANDLE;
+
+	_pipeline = nullptr;
+	_mesh = nullptr;
+}
+
+#pragma region Resources
+
+void VulkanEngine::GpuCuller::SetSharing(VkBufferCreateInfo& bufferInfo) const
+{
+	// Written on one queue and read on another every frame, concurrent saves an ownership transfer each way
+	bufferInfo.sharingMode = IsConcurrent() ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+	bufferInfo.queueFamilyIndexCount = IsConcurrent() ? static_cast<UINT32>(_queueFamilies.size()) : 0;
+	bufferInfo.pQueueFamilyIndices = IsConcurrent() ? _queueFamilies.data() : nullptr;
+}
+
+bool VulkanEngine::GpuCuller::CreateFrameResources(FrameResources& frame, UINT32 capacity)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	SetSharing(bufferInfo);
+
+	bufferInfo.size = MAX_LODS * sizeof(VkDrawIndexedIndirectCommand);
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	if (!_allocator->CreateBuffer(bufferInfo, MemoryUsage::GpuOnly, frame.drawBuffer, frame.drawAllocation))
+		return false;
+
+	bufferInfo.size = static_cast<VkDeviceSize>(capacity) * sizeof(InstanceData);
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	if (!_allocator->CreateBuffer(bufferInfo, MemoryUsage::GpuOnly, frame.visibleBuffer, frame.visibleAllocation))
+		return false;
+
+	bufferInfo.size = COUNTER_COUNT * sizeof(UINT32);
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+		| VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	if (!_allocator->CreateBuffer(bufferInfo, MemoryUsage::GpuOnly, frame.countBuffer, frame.countAllocation))
+		return false;
+
+	// The placements, the group offsets and the readback never leave the culling queue
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	bufferInfo.queueFamilyIndexCount = 0;
+	bufferInfo.pQueueFamilyIndices = nullptr;
+
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	if (!_allocator->CreateBuffer(bufferInfo, MemoryUsage::GpuToCpu, frame.readbackBuffer, frame.readbackAllocation))
+		return false;
+
+	bufferInfo.size = static_cast<VkDeviceSize>(capacity) * sizeof(UINT32);
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	if (!_allocator->CreateBuffer(bufferInfo, MemoryUsage::GpuOnly, frame.placementBuffer, frame.placementAllocation))
+		return false;
+
+	bufferInfo.size = static_cast<VkDeviceSize>((capacity + GROUP_SIZE - 1) / GROUP_SIZE) * sizeof(glm::uvec4);
+	if (!_allocator->CreateBuffer(bufferInfo, MemoryUsage::GpuOnly, frame.groupBuffer, frame.groupAllocation))
+		return false;
+
+	frame.capacity = capacity;
+	frame.sceneVersion = 0;
+	return true;
+}
+
+void VulkanEngine::GpuCuller::DestroyFrameResources(FrameResources& frame)
+{
+	if (frame.drawBuffer != VK_NULL_HANDLE)
+		_allocator->DestroyBuffer(frame.drawBuffer, frame.drawAllocation);
+	if (frame.countBuffer != VK_NULL_HANDLE)
+		_allocator->DestroyBuffer(frame.countBuffer, frame.countAllocation);
+	if (frame.placementBuffer != VK_NULL_HANDLE)
+		_allocator->DestroyBuffer(frame.placementBuffer, frame.placementAllocation);
+	if (frame.visibleBuffer != VK_NULL_HANDLE)
+		_allocator->DestroyBuffer(frame.visibleBuffer, frame.visibleAllocation);
+	if (frame.groupBuffer != VK_NULL_HANDLE)
+		_allocator->DestroyBuffer(frame.groupBuffer, frame.groupAllocation);
+	if (frame.readbackBuffer != VK_NULL_HANDLE)
+		_allocator->DestroyBuffer(frame.readbackBuffer, frame.readbackAllocation);
+
+	frame.drawBuffer = VK_NULL_HANDLE;
+	frame.countBuffer = VK_NULL_HANDLE;
+	frame.placementBuffer = VK_NULL_HANDLE;
+	frame.visibleBuffer = VK_NULL_HANDLE;
+	frame.groupBuffer = VK_NULL_HANDLE;
+	frame.readbackBuffer = VK_NULL_HANDLE;
+	frame.capacity = 0;
+	frame.recorded = false;
+}
+
+void VulkanEngine::GpuCuller::UpdateDescriptorSet(FrameResources& frame)
+{
+	VkDescriptorBufferInfo bufferInfos[] =
+	{
+		{ _sceneBuffer, 0, VK_WHOLE_SIZE },
+		{ frame.drawBuffer, 0, VK_WHOLE_SIZE },
+		{ frame.countBuffer, 0, VK_WHOLE_SIZE },
+		{ frame.placementBuffer, 0, VK_WHOLE_SIZE },
+		{ frame.visibleBuffer, 0, VK_WHOLE_SIZE },
+		{ frame.groupBuffer, 0, VK_WHOLE_SIZE }
+	};
+
+	VkWriteDescriptorSet writes[ARRAYSIZE(bufferInfos)]{};
+	for (UINT32 i = 0; i < ARRAYSIZE(bufferInfos); i++)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = frame.descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(_device, ARRAYSIZE(writes), writes, 0, nullptr);
+	frame.sceneVersion = _sceneVersion;
+}
+
+#pragma endregion
+
+bool VulkanEngine::GpuCuller::SetScene(const Mesh& mesh, std::span<const InstanceData> instances, std::span<const float> lodSizes,
+	DeletionQueue& deletionQueue, UINT64 frameValue)
+{
+	if (mesh.GetLods().size() > MAX_LODS)
+	{
+		fprintf(stderr, "GPU culling supports up to %u lods\n", MAX_LODS);
+		return false;
+	}
+
+	// Descriptor sets of frames in flight still point at the old buffer, they are only rewritten once their slot is free
+	if (_sceneBuffer != VK_NULL_HANDLE)
+	{
+		MemoryAllocator* allocator = _allocator;
+		deletionQueue.Push(frameValue, [allocator, buffer = _sceneBuffer, allocation = _sceneAllocation]() mutable
+			{
+				allocator->DestroyBuffer(buffer, allocation);
+			});
+	}
+
+	_sceneBuffer = VK_NULL_HANDLE;
+	_sceneResident = false;
+	_sceneUploaded = 0;
+	_sceneVersion++;
+
+	_mesh = &mesh;
+	_lodSizes.assign(lodSizes.begin(), lodSizes.end());
+	_sceneData.assign(instances.begin(), instances.end());
+	_objectCount = static_cast<UINT32>(instances.size());
+	_stats = Stats{};
+
+	if (_objectCount == 0)
+		return true;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = _sceneData.size() * sizeof(InstanceData);
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	SetSharing(bufferInfo);
+
+	if (!_allocator->CreateBuffer(bufferInfo, MemoryUsage::GpuOnly, _sceneBuffer, _sceneAllocation))
+	{
+		fprintf(stderr, "Failed to create Scene Buffer\n");
+		return false;
+	}
+
+	return true;
+}
+
+VulkanEngine::UploadStatus VulkanEngine::GpuCuller::Upload(UploadManager& uploader)
+{
+	if (_sceneResident || _objectCount == 0)
+		return UploadStatus::Uploaded;
+	if (_sceneBuffer == VK_NULL_HANDLE)
+		return UploadStatus::Failed;
+
+	if (!uploader.UploadBufferResumable(_sceneBuffer, _sceneData.data(), _sceneData.size() * sizeof(InstanceData), _sceneUploaded, IsConcurrent()))
+		return UploadStatus::RingFull;
+
+	_sceneData = std::vector<InstanceData>();
+	_sceneResident = true;
+	return UploadStatus::Uploaded;
+}
+
+bool VulkanEngine::GpuCuller::Record(VkCommandBuffer commandBuffer, UINT32 frame, const CullView& view)
+{
+	FrameResources& resources = _frames[frame];
+	resources.recorded = false;
+
+	if (!_sceneResident || _objectCount == 0 || !_mesh->IsResident())
+		return false;
+
+	VkPipeline pipeline = _pipeline->Resolve();
+	if (pipeline == VK_NULL_HANDLE)
+		return false;
+
+	// The slot's previous frame completed, so its buffers can be replaced and its set rewritten
+	if (resources.capacity < _objectCount)
+	{
+		DestroyFrameResources(resources);
+		if (!CreateFrameResources(resources, _objectCount))
+		{
+			fprintf(stderr, "Failed to create Cull Buffers for %u objects\n", _objectCount);
+			DestroyFrameResources(resources);
+			return false;
+		}
+	}
+
+	if (resources.sceneVersion != _sceneVersion)
+		UpdateDescriptorSet(resources);
+
+	const std::vector<MeshLod>& lods = _mesh->GetLods();
+	const MeshBounds& bounds = _mesh->GetBounds();
+	const UINT32 lodCount = static_cast<UINT32>(lods.size());
+
+	// The index range of every lod, the scatter pass fills in the instances
+	VkDrawIndexedIndirectCommand lodDraws[MAX_LODS]{};
+	for (UINT32 i = 0; i < lodCount; i++)
+	{
+		lodDraws[i].indexCount = lods[i].indexCount;
+		lodDraws[i].firstIndex = lods[i].firstIndex;
+		lodDraws[i].vertexOffset = lods[i].vertexOffset;
+	}
+
+	vkCmdFillBuffer(commandBuffer, resources.countBuffer, 0, VK_WHOLE_SIZE, 0);
+	vkCmdUpdateBuffer(commandBuffer, resources.drawBuffer, 0, lodCount * sizeof(VkDrawIndexedIndirectCommand), lodDraws);
+
+	VkBufferMemoryBarrier resetBarriers[2]{};
+	for (VkBufferMemoryBarrier& barrier : resetBarriers)
+	{
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+	}
+	resetBarriers[0].buffer = resources.countBuffer;
+	resetBarriers[1].buffer = resources.drawBuffer;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		0, nullptr, ARRAYSIZE(resetBarriers), resetBarriers, 0, nullptr);
+
+	CullConstants constants{};
+	constants.clipFromWorld = view.clipFromWorld;
+	constants.view = glm::vec4(view.viewportHeight, glm::length(bounds.extent), 0.0f, 0.0f);
+	constants.counts = glm::uvec4(_objectCount, lodCount, CLASSIFY_PASS, 0);
+
+	for (UINT32 i = 0; i < lodCount; i++)
+		constants.lodSizes[static_cast<int>(i)] = i < _lodSizes.size() ? _lodSizes[i] : 0.0f;
+
+	const UINT32 groupCount = (_objectCount + GROUP_SIZE - 1) / GROUP_SIZE;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetLayout(), 0, 1, &resources.descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, _pipeline->GetLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+
+	// The scan needs every group's counts, the scatter every offset the scan wrote
+	VkMemoryBarrier passBarrier{};
+	passBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	passBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	passBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	const UINT32 passes[] = { SCAN_PASS, SCATTER_PASS };
+	for (UINT32 pass : passes)
+	{
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &passBarrier, 0, nullptr, 0, nullptr);
+
+		constants.counts.z = pass;
+		vkCmdPushConstants(commandBuffer, _pipeline->GetLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(commandBuffer, pass == SCAN_PASS ? 1 : groupCount, 1, 1);
+	}
+
+	VkBufferMemoryBarrier cullBarriers[3]{};
+	for (VkBufferMemoryBarrier& barrier : cullBarriers)
+	{
+		barrier = resetBarriers[0];
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	}
+	cullBarriers[0].buffer = resources.drawBuffer;
+	cullBarriers[1].buffer = resources.countBuffer;
+	cullBarriers[2].buffer = resources.visibleBuffer;
+	cullBarriers[2].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+	// On the compute queue the graphics submission's wait covers the instances
+	VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	UINT32 cullBarrierCount = ARRAYSIZE(cullBarriers) - 1;
+	if (_graphicsQueue)
+	{
+		dstStages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		cullBarrierCount++;
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStages, 0,
+		0, nullptr, cullBarrierCount, cullBarriers, 0, nullptr);
+
+	// Read back once the slot comes around again, never waited on
+	VkBufferCopy copy{};
+	copy.size = COUNTER_COUNT * sizeof(UINT32);
+	vkCmdCopyBuffer(commandBuffer, resources.countBuffer, resources.readbackBuffer, 1, &copy);
+
+	VkBufferMemoryBarrier readbackBarrier = resetBarriers[0];
+	readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	readbackBarrier.buffer = resources.readbackBuffer;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		0, nullptr, 1, &readbackBarrier, 0, nullptr);
+
+	resources.recorded = true;
+	return true;
+}
+
+void VulkanEngine::GpuCuller::Draw(VkCommandBuffer commandBuffer, UINT32 frame) const
+{
+	const FrameResources& resources = _frames[frame];
+	if (!resources.recorded)
+		return;
+
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, InstanceBatcher::INSTANCE_BINDING, 1, &resources.visibleBuffer, &offset);
+	_mesh->Bind(commandBuffer);
+
+	const UINT32 stride = sizeof(VkDrawIndexedIndirectCommand);
+	const UINT32 lodCount = static_cast<UINT32>(_mesh->GetLods().size());
+
+	if (UsesDrawCount())
+	{
+		vkCmdDrawIndexedIndirectCount(commandBuffer, resources.drawBuffer, 0, resources.countBuffer, 0,
+			std::min(lodCount, _support.maxDrawCount), stride);
+		return;
+	}
+
+	// Empty lods keep their slot with zero instances, the draws are split at the device limit
+	for (UINT32 first = 0; first < lodCount; first += _support.maxDrawCount)
+	{
+		UINT32 count = std::min(_support.maxDrawCount, lodCount - first);
+		vkCmdDrawIndexedIndirect(commandBuffer, resources.drawBuffer, static_cast<VkDeviceSize>(first) * stride, count, stride);
+	}
+}
+
+void VulkanEngine::GpuCuller::CollectStats(UINT32 frame)
+{
+	FrameResources& resources = _frames[frame];
+	if (!resources.recorded)
+		return;
+
+	_allocator->Invalidate(resources.readbackAllocation);
+
+	const UINT32* counters = static_cast<const UINT32*>(resources.readbackAllocation.mapped);
+	_stats.objects = _objectCount;
+	_stats.visible = 0;
+
+	for (UINT32 i = 0; i < MAX_LODS; i++)
+	{
+		_stats.lodCounts[i] = counters[1 + i];
+		_stats.visible += counters[1 + i];
+	}
+}
+
+void VulkanEngine::GpuCuller::PrintStats() const
+{
+	fprintf(stdout, "GPU Culler : %u of %u objects visible, per lod %u / %u / %u / %u\n",
+		_stats.visible, _stats.objects, _stats.lodCounts[0], _stats.lodCounts[1], _stats.lodCounts[2], _stats.lodCounts[3]);
+}
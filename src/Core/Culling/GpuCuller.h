@@ -0,0 +1,175 @@
+#pragma once
+
+#include <Common.h>
+#include <span>
+#include <glm/glm.hpp>
+#include <Memory/DeletionQueue.h>
+#include <Memory/MemoryAllocator.h>
+#include <Memory/UploadManager.h>
+#include <Mesh/InstanceBatcher.h>
+#include <Mesh/Mesh.h>
+#include <Pipeline/LayoutCache.h>
+#include <Pipeline/PipelineCompiler.h>
+#include <Shader/Shader.h>
+
+namespace VulkanEngine
+{
+	// Device features indirect drawing depends on, enabled at device creation when present
+	struct IndirectDrawSupport
+	{
+		bool firstInstance = false;		// Required, every lod's draw selects its bucket through firstInstance
+		bool multiDraw = false;			// More than one draw per vkCmdDrawIndexedIndirect
+		bool drawCount = false;			// vkCmdDrawIndexedIndirectCount, Vulkan 1.2
+		UINT32 maxDrawCount = 1;
+	};
+
+	// View the cull pass tests against, clipFromWorld is the orthographic matrix the mesh is drawn with
+	struct CullView
+	{
+		glm::mat4 clipFromWorld = glm::mat4(1.0f);
+		float viewportHeight = 1.0f;
+	};
+
+	// GPU driven drawing of one mesh over a persistent scene of instances. The scene
+	// lives in device local memory and is uploaded once, every frame a compute pass
+	// frustum culls each instance, picks its level of detail from its size on screen
+	// and ranks it among the survivors of that lod. A prefix sum over the groups
+	// places every survivor in its lod's bucket in scene order, which the CPU sorted
+	// back to front, and one instanced indexed indirect draw per lod is written, so a
+	// million objects are still at most MAX_LODS draws. Empty lods are compacted away where vkCmdDrawIndexedIndirectCount exists,
+	// elsewhere they draw zero instances. The CPU records the same few commands
+	// whatever the object count.
+	class GpuCuller
+	{
+	public:
+		static constexpr UINT32 MAX_LODS = 4;
+		static constexpr UINT32 GROUP_SIZE = 64;
+
+
+		struct Stats
+		{
+			UINT32 objects = 0;
+			UINT32 visible = 0;
+			UINT32 lodCounts[MAX_LODS]{};
+		};
+
+	private:
+		// Layout of Cull.comp's push constant block
+		struct CullConstants
+		{
+			glm::mat4 clipFromWorld;
+			glm::vec4 view;				// x: viewport height, y: mesh bounding radius
+			glm::uvec4 counts;			// x: object count, y: lod count, z: pass
+			glm::vec4 lodSizes;			// Smallest on screen diameter in pixels each lod is drawn at
+		};
+
+		// Cull.comp is dispatched three times, buckets are placed once every group's counts are known
+		static constexpr UINT32 CLASSIFY_PASS = 0;
+		static constexpr UINT32 SCAN_PASS = 1;		// A single group
+		static constexpr UINT32 SCATTER_PASS = 2;
+
+		// Cull.comp's counter block, the draw count followed by the visible objects per lod
+		static constexpr UINT32 COUNTER_COUNT = 1 + MAX_LODS;
+
+		struct FrameResources
+		{
+			VkBuffer drawBuffer = VK_NULL_HANDLE;		// One draw per lod
+			Allocation drawAllocation;
+			VkBuffer countBuffer = VK_NULL_HANDLE;
+			Allocation countAllocation;
+			VkBuffer placementBuffer = VK_NULL_HANDLE;	// Every object's lod and rank within its group, or culled
+			Allocation placementAllocation;
+			VkBuffer groupBuffer = VK_NULL_HANDLE;		// Survivors per lod of each group, then their offsets
+			Allocation groupAllocation;
+			VkBuffer visibleBuffer = VK_NULL_HANDLE;	// Survivors grouped by lod, the draws' instances
+			Allocation visibleAllocation;
+			VkBuffer readbackBuffer = VK_NULL_HANDLE;
+			Allocation readbackAllocation;
+
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			UINT32 capacity = 0;
+			UINT64 sceneVersion = 0;	// Scene the descriptor set points at
+			bool recorded = false;		// Draw and visible buffers hold this slot's latest cull output
+		};
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		MemoryAllocator* _allocator = nullptr;
+		IndirectDrawSupport _support;
+		bool _graphicsQueue = false;
+
+		// Queue families sharing the scene and the draws, more than one makes them concurrent
+		std::vector<UINT32> _queueFamilies;
+
+		PipelineHandle _pipeline;
+		VkDescriptorSetLayout _setLayout = VK_NULL_HANDLE;
+		VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+
+		const Mesh* _mesh = nullptr;
+		std::vector<float> _lodSizes;
+
+		VkBuffer _sceneBuffer = VK_NULL_HANDLE;
+		Allocation _sceneAllocation;
+		std::vector<InstanceData> _sceneData;	// Released once uploaded
+		VkDeviceSize _sceneUploaded = 0;
+		UINT32 _objectCount = 0;
+		UINT64 _sceneVersion = 0;
+		bool _sceneResident = false;
+
+		// Indexed by frame in flight
+		std::vector<FrameResources> _frames;
+
+		Stats _stats;
+
+		bool CreateFrameResources(FrameResources& frame, UINT32 capacity);
+		void DestroyFrameResources(FrameResources& frame);
+		void UpdateDescriptorSet(FrameResources& frame);
+		void SetSharing(VkBufferCreateInfo& bufferInfo) const;
+
+		inline bool IsConcurrent() const { return _queueFamilies.size() > 1; }
+
+		// A draw count above one needs multiDrawIndirect as well, maxDrawCount is 1 without it
+		inline bool UsesDrawCount() const { return _support.drawCount && _support.multiDraw; }
+
+	public:
+		GpuCuller() = default;
+
+		static IndirectDrawSupport QuerySupport(VkPhysicalDevice physicalDevice);
+
+		// Compiles Cull.comp on the pipeline compiler, Record skips frames until it is ready.
+		// queueFamilies lists every family touching the scene or the draws, the transfer queue
+		// uploading the scene, the queue culling and the one drawing. graphicsQueue tells whether
+		// Record runs on the drawing queue, only then can its barrier reach the vertex input stage.
+		bool Init(VkDevice device, MemoryAllocator& allocator, LayoutCache& layoutCache, PipelineCompiler& compiler,
+			const SPTR<Shader>& cullShader, const IndirectDrawSupport& support, std::span<const UINT32> queueFamilies,
+			bool graphicsQueue, UINT32 framesInFlight);
+		void Shutdown();
+
+		// Replaces the scene, lodSizes holds the smallest diameter in pixels of every lod but the last.
+		// The previous scene buffer is destroyed once frames up to frameValue completed.
+		bool SetScene(const Mesh& mesh, std::span<const InstanceData> instances, std::span<const float> lodSizes,
+			DeletionQueue& deletionQueue, UINT64 frameValue);
+
+		// Streams the scene in, RingFull until everything is queued
+		UploadStatus Upload(UploadManager& uploader);
+
+		// Outside a render pass, once the frame slot is free: resets the counters, dispatches
+		// both cull passes and makes the draws and their instances visible to the draw stages.
+		// Works on a graphics or a compute command buffer, returns false when nothing was recorded.
+		bool Record(VkCommandBuffer commandBuffer, UINT32 frame, const CullView& view);
+
+		// Inside the render pass with a pipeline bound that reads instances at INSTANCE_BINDING
+		void Draw(VkCommandBuffer commandBuffer, UINT32 frame) const;
+
+		// Reads the counts the slot's previous frame wrote, call after it completed
+		void CollectStats(UINT32 frame);
+
+		inline bool IsResident() const { return _sceneResident; }
+		inline const Stats& GetStats() const { return _stats; }
+		void PrintStats() const;
+
+	public:
+		GpuCuller(const GpuCuller&) = delete;
+		GpuCuller& operator=(const GpuCuller&) = delete;
+	};
+}
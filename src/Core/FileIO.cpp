@@ -0,0 +1,283 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include "FileIO.h"
+#include <atomic>
+#include <filesystem>
+#include <utility>
+
+VulkanEngine::MappedFile::~MappedFile()
+{
+	Close();
+}
+
+VulkanEngine::MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+VulkanEngine::MappedFile& VulkanEngine::MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	Close();
+
+	_data = std::exchange(other._data, nullptr);
+	_size = std::exchange(other._size, 0);
+	_isMapped = std::exchange(other._isMapped, false);
+	_buffer = std::move(other._buffer);
+
+#ifdef _WIN32
+	_file = std::exchange(other._file, nullptr);
+	_mapping = std::exchange(other._mapping, nullptr);
+#else
+	_file = std::exchange(other._file, -1);
+#endif // _WIN32
+
+	return *this;
+}
+
+bool VulkanEngine::MappedFile::Open(const std::string& path, FileAccess access)
+{
+	Close();
+
+	if (Map(path, access))
+		return true;
+
+	Close();
+
+	size_t size = GetFileSize(path);
+	if (size > MAX_MAPPED_SIZE)
+	{
+		fprintf(stderr, "File '%s' is too large to load whole, stream it instead\n", path.c_str());
+		return false;
+	}
+
+	return ReadIntoBuffer(path);
+}
+
+void VulkanEngine::MappedFile::Close()
+{
+#ifdef _WIN32
+	if (_isMapped && _data != nullptr)
+		UnmapViewOfFile(_data);
+	if (_mapping != nullptr)
+		CloseHandle(_mapping);
+	if (_file != nullptr)
+		CloseHandle(_file);
+
+	_mapping = nullptr;
+	_file = nullptr;
+#else
+	if (_isMapped && _data != nullptr)
+		munmap(const_cast<char*>(_data), _size);
+	if (_file >= 0)
+		close(_file);
+
+	_file = -1;
+#endif // _WIN32
+
+	_buffer.reset();
+	_data = nullptr;
+	_size = 0;
+	_isMapped = false;
+}
+
+bool VulkanEngine::MappedFile::Map(const std::string& path, FileAccess access)
+{
+#ifdef _WIN32
+	DWORD flags = access == FileAccess::Random ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN;
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || static_cast<UINT64>(size.QuadPart) > MAX_MAPPED_SIZE)
+		return false;
+
+	_size = static_cast<size_t>(size.QuadPart);
+	_isMapped = true;
+
+	// Empty files can't be mapped, but they are valid and simply have no data
+	if (_size == 0)
+		return true;
+
+	_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping == nullptr)
+		return false;
+
+	_data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (_data == nullptr)
+		return false;
+
+	if (access == FileAccess::WillNeed)
+	{
+		WIN32_MEMORY_RANGE_ENTRY range{ const_cast<char*>(_data), _size };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	_file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (_file < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(_file, &status) != 0 || !S_ISREG(status.st_mode) || static_cast<UINT64>(status.st_size) > MAX_MAPPED_SIZE)
+		return false;
+
+	_size = static_cast<size_t>(status.st_size);
+	_isMapped = true;
+
+	// Empty files can't be mapped, but they are valid and simply have no data
+	if (_size == 0)
+		return true;
+
+	void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+	if (data == MAP_FAILED)
+		return false;
+	_data = static_cast<const char*>(data);
+
+	int advice = access == FileAccess::Random ? MADV_RANDOM
+		: access == FileAccess::WillNeed ? MADV_WILLNEED
+		: MADV_SEQUENTIAL;
+	madvise(data, _size, advice);
+
+	// The mapping keeps the file referenced, the descriptor is no longer needed
+	close(_file);
+	_file = -1;
+#endif // _WIN32
+
+	return true;
+}
+
+bool VulkanEngine::MappedFile::ReadIntoBuffer(const std::string& path)
+{
+	size_t size = GetFileSize(path);
+
+	// Over allocate by a page so the data can start page aligned like a mapping would
+	const size_t alignment = 4096;
+	_buffer = MAKE_UPTR<char[]>(size + alignment);
+
+	char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(_buffer.get()) + alignment - 1) & ~(alignment - 1));
+	size_t offset = 0;
+
+	bool read = ReadFileChunked(path,
+		[aligned, size, &offset](const char* data, size_t chunkSize)
+		{
+			if (offset + chunkSize > size)
+				return false;
+
+			memcpy(aligned + offset, data, chunkSize);
+			offset += chunkSize;
+			return true;
+		});
+
+	if (!read || offset != size)
+	{
+		fprintf(stderr, "Failed to read file '%s'\n", path.c_str());
+		_buffer.reset();
+		return false;
+	}
+
+	_data = aligned;
+	_size = size;
+	return true;
+}
+
+bool VulkanEngine::ReadFileChunked(const std::string& path, const ChunkConsumer& consume, size_t chunkSize)
+{
+	std::vector<char> chunk(chunkSize);
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	bool completed = true;
+	for (;;)
+	{
+		DWORD bytesRead = 0;
+		if (!::ReadFile(file, chunk.data(), static_cast<DWORD>(std::min<size_t>(chunkSize, MAXDWORD)), &bytesRead, nullptr))
+		{
+			completed = false;
+			break;
+		}
+
+		if (bytesRead == 0)
+			break;
+
+		if (!consume(chunk.data(), bytesRead))
+		{
+			completed = false;
+			break;
+		}
+	}
+
+	CloseHandle(file);
+	return completed;
+#else
+	int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0)
+		return false;
+
+	// Whole file is read front to back once, let the kernel read ahead and drop pages behind us
+	posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	bool completed = true;
+	off_t consumed = 0;
+	for (;;)
+	{
+		ssize_t bytesRead = read(file, chunk.data(), chunkSize);
+		if (bytesRead < 0)
+		{
+			completed = false;
+			break;
+		}
+
+		if (bytesRead == 0)
+			break;
+
+		if (!consume(chunk.data(), static_cast<size_t>(bytesRead)))
+		{
+			completed = false;
+			break;
+		}
+
+		posix_fadvise(file, consumed, bytesRead, POSIX_FADV_DONTNEED);
+		consumed += bytesRead;
+	}
+
+	close(file);
+	return completed;
+#endif // _WIN32
+}
+
+size_t VulkanEngine::GetFileSize(const std::string& path)
+{
+	std::error_code error;
+	UINT64 size = std::filesystem::file_size(path, error);
+	return error ? 0 : static_cast<size_t>(size);
+}
+
+std::string VulkanEngine::GetTemporaryPath(const std::string& path)
+{
+	static std::atomic<UINT64> counter = 0;
+
+#ifdef _WIN32
+	unsigned long process = GetCurrentProcessId();
+#else
+	unsigned long process = static_cast<unsigned long>(getpid());
+#endif // _WIN32
+
+	return path + "." + std::to_string(process) + "." + std::to_string(counter.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+}
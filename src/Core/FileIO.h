@@ -1,22 +1,76 @@
 #pragma once
 
 #include <Common.h>
-#include <fstream>
+#include <functional>
 
-static std::vector<char> ReadFile(const std::string& filename)
+namespace VulkanEngine
 {
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	// How a mapped file is going to be read, forwarded to the OS as a paging hint
+	enum class FileAccess
+	{
+		Sequential,		// Read front to back once, aggressive readahead
+		Random,			// Scattered reads, readahead would only waste memory
+		WillNeed		// Whole file is needed soon, start paging it in right away
+	};
 
-	if (!file.is_open())
-		throw std::runtime_error("failed to open file!");
+	// Read only view of a whole file. The file is memory mapped when possible so
+	// the data is never copied, otherwise it is streamed into one owned buffer.
+	// Either way the data is page aligned and stays valid until Close.
+	class MappedFile
+	{
+	private:
+		const char* _data = nullptr;
+		size_t _size = 0;
+		bool _isMapped = false;
 
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
+		// Fallback storage when mapping is not possible
+		UPTR<char[]> _buffer;
 
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
+#ifdef _WIN32
+		void* _file = nullptr;
+		void* _mapping = nullptr;
+#else
+		int _file = -1;
+#endif // _WIN32
 
-	file.close();
+		bool Map(const std::string& path, FileAccess access);
+		bool ReadIntoBuffer(const std::string& path);
 
-	return buffer;
-}
\ No newline at end of file
+	public:
+		// Larger files should be consumed with ReadFileChunked instead of being mapped whole
+		static constexpr size_t MAX_MAPPED_SIZE = sizeof(void*) >= 8 ? (size_t(1) << 36) : (size_t(256) << 20);
+
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		bool Open(const std::string& path, FileAccess access = FileAccess::Sequential);
+		void Close();
+
+		inline bool IsOpen() const { return _isMapped || _buffer != nullptr; }
+		inline bool IsMapped() const { return _isMapped; }
+
+		inline const char* GetData() const { return _data; }
+		inline size_t GetSize() const { return _size; }
+
+		// Data is page aligned, so any type with a smaller alignment can be viewed in place
+		template <typename T>
+		inline const T* As() const { return reinterpret_cast<const T*>(_data); }
+
+	public:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+	};
+
+	// Streams a file through one reused buffer, consume returns false to stop early
+	using ChunkConsumer = std::function<bool(const char* data, size_t size)>;
+
+	bool ReadFileChunked(const std::string& path, const ChunkConsumer& consume, size_t chunkSize = 1 << 20);
+
+	size_t GetFileSize(const std::string& path);
+
+	// Name next to path that no other writer in any process uses, for a file written whole and then renamed over path
+	std::string GetTemporaryPath(const std::string& path);
+}
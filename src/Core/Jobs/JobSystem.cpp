@@ -0,0 +1,251 @@
+#include "JobSystem.h"
+
+namespace
+{
+	thread_local UINT32 t_threadIndex = VulkanEngine::JobSystem::INVALID_THREAD;
+}
+
+VulkanEngine::JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+bool VulkanEngine::JobSystem::Init(UINT32 workerThreads)
+{
+	_stop = false;
+
+	for (UINT32 i = 0; i <= workerThreads; i++)
+		_workers.push_back(MAKE_UPTR<Worker>());
+
+	// Deques exist before any thread starts so a worker can steal from all of them
+	t_threadIndex = 0;
+	for (UINT32 i = 1; i <= workerThreads; i++)
+		_workers[i]->thread = std::thread(&JobSystem::WorkerLoop, this, i);
+
+	fprintf(stdout, "Created Job System with %d worker threads\n", workerThreads);
+	return true;
+}
+
+void VulkanEngine::JobSystem::Shutdown()
+{
+	if (_workers.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+
+	for (auto& worker : _workers)
+		if (worker->thread.joinable())
+			worker->thread.join();
+
+	// Without workers nothing else would pick up what is left
+	while (RunOne());
+
+	_workers.clear();
+	t_threadIndex = INVALID_THREAD;
+}
+
+void VulkanEngine::JobSystem::Run(std::function<void()> function, JobCounter* counter)
+{
+	if (counter != nullptr)
+		counter->_pending.fetch_add(1, std::memory_order_relaxed);
+
+	Push(Job{ std::move(function), counter });
+}
+
+void VulkanEngine::JobSystem::RunAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter)
+{
+	if (counter != nullptr)
+		counter->_pending.fetch_add(1, std::memory_order_relaxed);
+
+	Job job{ std::move(function), counter };
+
+	{
+		// Checked under the lock Finish takes before releasing continuations, so the job is either queued here or there
+		std::lock_guard<std::mutex> lock(dependency._mutex);
+		if (!dependency.IsDone())
+		{
+			dependency._continuations.push_back(std::move(job));
+			return;
+		}
+	}
+
+	Push(std::move(job));
+}
+
+void VulkanEngine::JobSystem::Wait(JobCounter& counter)
+{
+	while (!counter.IsDone())
+		if (!RunOne())
+			std::this_thread::yield();
+
+	// The last job may still be inside Finish, it lets go of the lock before the counter can be destroyed
+	std::lock_guard<std::mutex> lock(counter._mutex);
+}
+
+bool VulkanEngine::JobSystem::RunOne()
+{
+	Job job;
+	if (!TryPop(job))
+		return false;
+
+	Execute(job);
+	return true;
+}
+
+void VulkanEngine::JobSystem::ParallelFor(size_t count, size_t grainSize, const RangeFunction& function)
+{
+	if (count == 0)
+		return;
+
+	// Nobody to share with, which includes a system that was never initialized
+	if (_workers.size() <= 1)
+	{
+		function(0, count);
+		return;
+	}
+
+	if (grainSize == 0)
+		grainSize = std::max<size_t>(1, count / (GetThreadCount() * 4));
+
+	size_t rangeCount = (count + grainSize - 1) / grainSize;
+	if (rangeCount == 1)
+	{
+		function(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (size_t range = 1; range < rangeCount; range++)
+	{
+		size_t begin = range * grainSize;
+		size_t end = std::min(count, begin + grainSize);
+		Run([&function, begin, end] { function(begin, end); }, &counter);
+	}
+
+	// The first range runs here while the others are being stolen
+	function(0, std::min(count, grainSize));
+	Wait(counter);
+}
+
+UINT32 VulkanEngine::JobSystem::GetThreadIndex()
+{
+	return t_threadIndex;
+}
+
+VulkanEngine::JobSystem::Stats VulkanEngine::JobSystem::GetStats() const
+{
+	Stats stats;
+	stats.executed = _executed.load(std::memory_order_relaxed);
+	stats.stolen = _stolen.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void VulkanEngine::JobSystem::WorkerLoop(UINT32 index)
+{
+	t_threadIndex = index;
+
+	while (true)
+	{
+		if (RunOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		_wake.wait(lock, [this] { return _stop || _queued.load(std::memory_order_acquire) > 0; });
+
+		if (_stop && _queued.load(std::memory_order_acquire) == 0)
+			return;
+	}
+}
+
+void VulkanEngine::JobSystem::Push(Job job)
+{
+	assert(!_workers.empty());
+
+	// Threads the system does not own spread their jobs round robin
+	UINT32 index = t_threadIndex < _workers.size()
+		? t_threadIndex
+		: _nextWorker.fetch_add(1, std::memory_order_relaxed) % static_cast<UINT32>(_workers.size());
+
+	Worker& worker = *_workers[index];
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.jobs.push_back(std::move(job));
+	}
+
+	_queued.fetch_add(1, std::memory_order_release);
+
+	// Taking the lock orders the notify after a sleeper's predicate check, so the wake up can't be lost
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+	}
+	_wake.notify_one();
+}
+
+bool VulkanEngine::JobSystem::TryPop(Job& job)
+{
+	UINT32 workerCount = static_cast<UINT32>(_workers.size());
+	if (workerCount == 0 || _queued.load(std::memory_order_acquire) == 0)
+		return false;
+
+	UINT32 self = t_threadIndex < workerCount ? t_threadIndex : 0;
+
+	// Newest own job first, it is the one most likely still in cache
+	if (t_threadIndex < workerCount)
+	{
+		Worker& worker = *_workers[self];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.jobs.empty())
+		{
+			job = std::move(worker.jobs.back());
+			worker.jobs.pop_back();
+			_queued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	// Oldest job of someone else, usually the biggest remaining piece of work
+	for (UINT32 i = 1; i <= workerCount; i++)
+	{
+		Worker& victim = *_workers[(self + i) % workerCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			_queued.fetch_sub(1, std::memory_order_relaxed);
+			_stolen.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void VulkanEngine::JobSystem::Execute(Job& job)
+{
+	job.function();
+	_executed.fetch_add(1, std::memory_order_relaxed);
+
+	if (job.counter != nullptr)
+		Finish(*job.counter);
+}
+
+void VulkanEngine::JobSystem::Finish(JobCounter& counter)
+{
+	std::vector<Job> continuations;
+	{
+		// Held across the decrement so Wait can't return and destroy the counter before this lets go
+		std::lock_guard<std::mutex> lock(counter._mutex);
+		if (counter._pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+
+		continuations.swap(counter._continuations);
+	}
+
+	for (Job& continuation : continuations)
+		Push(std::move(continuation));
+}
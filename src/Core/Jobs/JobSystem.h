@@ -0,0 +1,130 @@
+#pragma once
+
+#include <Common.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace VulkanEngine
+{
+	class JobCounter;
+
+	struct Job
+	{
+		std::function<void()> function;
+
+		// Counted down once function returns, may be null
+		JobCounter* counter = nullptr;
+	};
+
+	// Number of jobs still outstanding in a group. Jobs queued with RunAfter are
+	// released once it drops to zero. Must outlive every job that references it,
+	// so only destroy it after JobSystem::Wait returned.
+	class JobCounter
+	{
+		friend class JobSystem;
+
+	private:
+		std::atomic<UINT32> _pending = 0;
+
+		std::mutex _mutex;
+		std::vector<Job> _continuations;
+
+	public:
+		JobCounter() = default;
+
+		inline bool IsDone() const { return _pending.load(std::memory_order_acquire) == 0; }
+		inline UINT32 GetPending() const { return _pending.load(std::memory_order_relaxed); }
+
+	public:
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+	};
+
+	// Shared task scheduler. Every thread owns a deque, it pushes and pops its own
+	// jobs from the back while idle threads steal the oldest jobs from the front of
+	// the others. The thread that called Init is thread 0 and only runs jobs while
+	// it waits, so it is never parked behind work it could do itself.
+	class JobSystem
+	{
+	public:
+		using RangeFunction = std::function<void(size_t begin, size_t end)>;
+
+		struct Stats
+		{
+			UINT64 executed = 0;
+			UINT64 stolen = 0;
+		};
+
+	private:
+		struct alignas(64) Worker
+		{
+			std::thread thread;
+
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		// Index 0 belongs to the thread that called Init
+		std::vector<UPTR<Worker>> _workers;
+
+		std::atomic<UINT32> _queued = 0;
+		std::atomic<UINT32> _nextWorker = 0;
+
+		std::mutex _sleepMutex;
+		std::condition_variable _wake;
+		bool _stop = false;
+
+		std::atomic<UINT64> _executed = 0;
+		std::atomic<UINT64> _stolen = 0;
+
+		void WorkerLoop(UINT32 index);
+
+		void Push(Job job);
+		bool TryPop(Job& job);
+		void Execute(Job& job);
+		void Finish(JobCounter& counter);
+
+	public:
+		static constexpr UINT32 INVALID_THREAD = UINT32_MAX;
+
+		JobSystem() = default;
+		~JobSystem();
+
+		// workerThreads excludes the calling thread, 0 makes every job run while someone waits
+		bool Init(UINT32 workerThreads);
+
+		// Runs every job still queued before the workers are joined
+		void Shutdown();
+
+		void Run(std::function<void()> function, JobCounter* counter = nullptr);
+
+		// Queues function once dependency reaches zero, right away if it already has
+		void RunAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter = nullptr);
+
+		// Runs queued jobs on the calling thread until counter reaches zero
+		void Wait(JobCounter& counter);
+
+		// Runs one queued job on the calling thread, returns false when there was none
+		bool RunOne();
+
+		// Splits [0, count) into ranges of at least grainSize and blocks until all of them ran,
+		// the calling thread takes part. A grainSize of 0 picks a few ranges per thread.
+		void ParallelFor(size_t count, size_t grainSize, const RangeFunction& function);
+
+		// Including the thread that called Init
+		inline UINT32 GetThreadCount() const { return static_cast<UINT32>(_workers.size()); }
+
+		// Index of the calling thread in [0, GetThreadCount()), INVALID_THREAD for threads the system does not own
+		static UINT32 GetThreadIndex();
+
+		Stats GetStats() const;
+
+	public:
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+	};
+}
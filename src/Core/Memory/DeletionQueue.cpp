@@ -0,0 +1,39 @@
+#include "DeletionQueue.h"
+
+VulkanEngine::DeletionQueue::~DeletionQueue()
+{
+	if (!_entries.empty())
+		fprintf(stderr, "Deletion Queue destroyed with %zu pending entries\n", _entries.size());
+}
+
+void VulkanEngine::DeletionQueue::Push(UINT64 frameValue, DestroyFunction destroy)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_entries.push_back({ frameValue, std::move(destroy) });
+}
+
+size_t VulkanEngine::DeletionQueue::Flush(UINT64 completedFrameValue)
+{
+	// Destroy functions run outside the lock so they may push follow up entries
+	std::vector<DestroyFunction> ready;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		while (!_entries.empty() && _entries.front().frameValue <= completedFrameValue)
+		{
+			ready.push_back(std::move(_entries.front().destroy));
+			_entries.pop_front();
+		}
+	}
+
+	for (DestroyFunction& destroy : ready)
+		destroy();
+
+	return ready.size();
+}
+
+size_t VulkanEngine::DeletionQueue::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _entries.size();
+}
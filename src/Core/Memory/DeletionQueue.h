@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Common.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace VulkanEngine
+{
+	// Defers destruction of GPU resources until the frame that last used them has
+	// retired. Entries are tagged with a frame value, the same 64 bit counter the
+	// timeline semaphore signals, and run from Flush once the GPU passed it.
+	class DeletionQueue
+	{
+	public:
+		using DestroyFunction = std::function<void()>;
+
+	private:
+		struct Entry
+		{
+			UINT64 frameValue;
+			DestroyFunction destroy;
+		};
+
+		// Kept in push order, an entry tagged older than the one before it only runs late
+		std::deque<Entry> _entries;
+		std::mutex _mutex;
+
+	public:
+		DeletionQueue() = default;
+		~DeletionQueue();
+
+		// frameValue is the last frame that may still use the resource, usually the one being recorded
+		void Push(UINT64 frameValue, DestroyFunction destroy);
+
+		// Runs every entry tagged at or below completedFrameValue, returns how many ran
+		size_t Flush(UINT64 completedFrameValue);
+
+		// Only valid once the device is idle
+		inline size_t FlushAll() { return Flush(UINT64_MAX); }
+
+		size_t GetPendingCount();
+
+	public:
+		DeletionQueue(const DeletionQueue&) = delete;
+		DeletionQueue& operator=(const DeletionQueue&) = delete;
+	};
+}
@@ -0,0 +1,512 @@
+#include "MemoryAllocator.h"
+
+namespace
+{
+	constexpr VkDeviceSize MIN_NODE_SIZE = 256;
+	constexpr VkDeviceSize SMALL_HEAP_SIZE = 1024ull * 1024 * 1024;
+
+	inline VkDeviceSize FloorPowerOfTwo(VkDeviceSize value)
+	{
+		VkDeviceSize result = 1;
+		while (result <= value / 2)
+			result <<= 1;
+		return result;
+	}
+
+	inline VkDeviceSize AlignDown(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return value / alignment * alignment;
+	}
+
+	inline VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+#pragma region Memory Block
+
+VulkanEngine::MemoryBlock::MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, VkDeviceSize minNodeSize, UINT32 memoryType, void* mapped) :
+	_memory(memory),
+	_size(size),
+	_minNodeSize(minNodeSize),
+	_memoryType(memoryType),
+	_mapped(static_cast<UINT8*>(mapped))
+{
+	UINT32 levels = 1;
+	while ((_size >> levels) >= _minNodeSize)
+		levels++;
+
+	_freeLists.resize(levels);
+	_freeLists[0].insert(0);
+}
+
+std::optional<VkDeviceSize> VulkanEngine::MemoryBlock::Allocate(VkDeviceSize size)
+{
+	if (size > _size)
+		return std::nullopt;
+
+	// Deepest level whose nodes still fit the request
+	UINT32 targetLevel = static_cast<UINT32>(_freeLists.size()) - 1;
+	while (GetNodeSize(targetLevel) < size)
+		targetLevel--;
+
+	// Closest level above it with a free node
+	UINT32 level = targetLevel;
+	while (_freeLists[level].empty())
+	{
+		if (level == 0)
+			return std::nullopt;
+		level--;
+	}
+
+	VkDeviceSize offset = *_freeLists[level].begin();
+	_freeLists[level].erase(_freeLists[level].begin());
+
+	// Split down, the upper halves become free buddies
+	while (level < targetLevel)
+	{
+		level++;
+		_freeLists[level].insert(offset + GetNodeSize(level));
+	}
+
+	_allocatedLevels[offset] = targetLevel;
+	_allocatedBytes += GetNodeSize(targetLevel);
+
+	return offset;
+}
+
+void VulkanEngine::MemoryBlock::Free(VkDeviceSize offset)
+{
+	auto it = _allocatedLevels.find(offset);
+	if (it == _allocatedLevels.end())
+	{
+		fprintf(stderr, "Freeing unknown offset %llu from Memory Block\n", static_cast<unsigned long long>(offset));
+		return;
+	}
+
+	UINT32 level = it->second;
+	_allocatedLevels.erase(it);
+	_allocatedBytes -= GetNodeSize(level);
+
+	// Merge with the buddy for as long as it is free as well
+	while (level > 0)
+	{
+		VkDeviceSize buddy = offset ^ GetNodeSize(level);
+		if (_freeLists[level].erase(buddy) == 0)
+			break;
+
+		offset = std::min(offset, buddy);
+		level--;
+	}
+
+	_freeLists[level].insert(offset);
+}
+
+VkDeviceSize VulkanEngine::MemoryBlock::GetNodeSizeAt(VkDeviceSize offset) const
+{
+	auto it = _allocatedLevels.find(offset);
+	return it == _allocatedLevels.end() ? 0 : GetNodeSize(it->second);
+}
+
+VkDeviceSize VulkanEngine::MemoryBlock::GetLargestFreeRange() const
+{
+	for (UINT32 level = 0; level < _freeLists.size(); level++)
+		if (!_freeLists[level].empty())
+			return GetNodeSize(level);
+
+	return 0;
+}
+
+#pragma endregion
+
+#pragma region Memory Allocator
+
+bool VulkanEngine::MemoryAllocator::Init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+{
+	_device = device;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+
+	_preferredBlockSize = FloorPowerOfTwo(blockSize);
+	_bufferImageGranularity = std::max<VkDeviceSize>(1, deviceProperties.limits.bufferImageGranularity);
+	_nonCoherentAtomSize = std::max<VkDeviceSize>(1, deviceProperties.limits.nonCoherentAtomSize);
+	_maxAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+
+	_blocks.resize(_memoryProperties.memoryTypeCount);
+
+	fprintf(stdout, "Created Memory Allocator (block %llu KiB, granularity %llu, atom %llu)\n",
+		static_cast<unsigned long long>(_preferredBlockSize / 1024),
+		static_cast<unsigned long long>(_bufferImageGranularity),
+		static_cast<unsigned long long>(_nonCoherentAtomSize));
+	return true;
+}
+
+void VulkanEngine::MemoryAllocator::Shutdown()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_allocationCount > 0)
+		fprintf(stderr, "Memory Allocator shut down with %d live allocations\n", _allocationCount);
+
+	// Freeing memory also unmaps it
+	for (auto& blocks : _blocks)
+	{
+		for (auto& block : blocks)
+			vkFreeMemory(_device, block->GetMemory(), nullptr);
+		blocks.clear();
+	}
+
+	_deviceAllocationCount = 0;
+}
+
+std::optional<UINT32> VulkanEngine::MemoryAllocator::FindMemoryType(UINT32 typeFilter, MemoryUsage usage) const
+{
+	VkMemoryPropertyFlags required = 0;
+	VkMemoryPropertyFlags preferred = 0;
+
+	switch (usage)
+	{
+	case MemoryUsage::GpuOnly:
+		preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		break;
+	case MemoryUsage::CpuToGpu:
+		required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		break;
+	case MemoryUsage::GpuToCpu:
+		required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		break;
+	}
+
+	// First pass insists on the preferred flags, second settles for the required ones
+	for (VkMemoryPropertyFlags flags : { required | preferred, required })
+	{
+		for (UINT32 i = 0; i < _memoryProperties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i))
+				&&
+				(_memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)
+				return i;
+		}
+	}
+
+	return std::nullopt;
+}
+
+VkDeviceSize VulkanEngine::MemoryAllocator::GetBlockSize(UINT32 memoryType) const
+{
+	UINT32 heapIndex = _memoryProperties.memoryTypes[memoryType].heapIndex;
+	VkDeviceSize heapSize = _memoryProperties.memoryHeaps[heapIndex].size;
+
+	// Small heaps, like the 256 MiB host visible device local one, would be exhausted by a handful of blocks
+	VkDeviceSize blockSize = _preferredBlockSize;
+	if (heapSize <= SMALL_HEAP_SIZE)
+		blockSize = std::min(blockSize, FloorPowerOfTwo(heapSize / 8));
+
+	return std::max(blockSize, GetMinNodeSize(memoryType));
+}
+
+VkDeviceSize VulkanEngine::MemoryAllocator::GetMinNodeSize(UINT32 memoryType) const
+{
+	// Keeping non coherent nodes atom sized means flushing or invalidating
+	// one allocation can never touch bytes belonging to its neighbour
+	if (IsHostVisible(memoryType) && !IsCoherent(memoryType))
+		return std::max(MIN_NODE_SIZE, _nonCoherentAtomSize);
+
+	return MIN_NODE_SIZE;
+}
+
+bool VulkanEngine::MemoryAllocator::IsCoherent(UINT32 memoryType) const
+{
+	return _memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+bool VulkanEngine::MemoryAllocator::IsHostVisible(UINT32 memoryType) const
+{
+	return _memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+bool VulkanEngine::MemoryAllocator::AllocateDeviceMemory(VkDeviceSize size, UINT32 memoryType, VkDeviceMemory& memory, void** mapped)
+{
+	if (_maxAllocationCount > 0 && _deviceAllocationCount >= _maxAllocationCount)
+	{
+		fprintf(stderr, "maxMemoryAllocationCount (%d) reached\n", _maxAllocationCount);
+		return false;
+	}
+
+	VkMemoryAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = size;
+	allocateInfo.memoryTypeIndex = memoryType;
+
+	if (vkAllocateMemory(_device, &allocateInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to allocate %llu bytes of Device Memory\n", static_cast<unsigned long long>(size));
+		return false;
+	}
+
+	*mapped = nullptr;
+	if (IsHostVisible(memoryType)
+		&& vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS)
+	{
+		vkFreeMemory(_device, memory, nullptr);
+		fprintf(stderr, "Failed to map Device Memory\n");
+		return false;
+	}
+
+	_deviceAllocationCount++;
+	return true;
+}
+
+bool VulkanEngine::MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, bool isOptimalImage, Allocation& allocation)
+{
+	std::optional<UINT32> memoryType = FindMemoryType(requirements.memoryTypeBits, usage);
+	if (!memoryType.has_value())
+	{
+		fprintf(stderr, "No suitable memory type for allocation\n");
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// Buddy nodes are aligned to their size, so asking for at least alignment bytes is enough.
+	// Optimal images are padded to whole bufferImageGranularity pages which their node then
+	// owns exclusively, so no linear resource can ever share a page with them.
+	VkDeviceSize nodeSize = std::max(requirements.size, requirements.alignment);
+	if (isOptimalImage)
+		nodeSize = std::max(nodeSize, _bufferImageGranularity);
+
+	VkDeviceSize blockSize = GetBlockSize(memoryType.value());
+
+	allocation = Allocation{};
+	allocation.memoryType = memoryType.value();
+	allocation.size = requirements.size;
+
+	// Large resources would waste most of a block, they get memory of their own
+	if (nodeSize > blockSize / 2)
+	{
+		if (!AllocateDeviceMemory(requirements.size, memoryType.value(), allocation.memory, &allocation.mapped))
+			return false;
+
+		_dedicatedCount++;
+		_dedicatedBytes += requirements.size;
+	}
+	else
+	{
+		std::vector<UPTR<MemoryBlock>>& blocks = _blocks[memoryType.value()];
+
+		std::optional<VkDeviceSize> offset;
+		for (auto& block : blocks)
+		{
+			offset = block->Allocate(nodeSize);
+			if (offset.has_value())
+			{
+				allocation.block = block.get();
+				break;
+			}
+		}
+
+		if (!offset.has_value())
+		{
+			VkDeviceMemory memory;
+			void* mapped;
+			if (!AllocateDeviceMemory(blockSize, memoryType.value(), memory, &mapped))
+				return false;
+
+			blocks.push_back(MAKE_UPTR<MemoryBlock>(memory, blockSize, GetMinNodeSize(memoryType.value()), memoryType.value(), mapped));
+			allocation.block = blocks.back().get();
+			offset = allocation.block->Allocate(nodeSize);
+		}
+
+		allocation.memory = allocation.block->GetMemory();
+		allocation.offset = offset.value();
+		if (allocation.block->GetMapped() != nullptr)
+			allocation.mapped = allocation.block->GetMapped() + allocation.offset;
+	}
+
+	_allocationCount++;
+	_usedBytes += requirements.size;
+	return true;
+}
+
+void VulkanEngine::MemoryAllocator::Free(Allocation& allocation)
+{
+	if (!allocation.IsValid())
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (allocation.block == nullptr)
+	{
+		vkFreeMemory(_device, allocation.memory, nullptr);
+		_deviceAllocationCount--;
+		_dedicatedCount--;
+		_dedicatedBytes -= allocation.size;
+	}
+	else
+	{
+		MemoryBlock* block = allocation.block;
+		block->Free(allocation.offset);
+
+		// One empty block per type is kept around to absorb allocation churn
+		std::vector<UPTR<MemoryBlock>>& blocks = _blocks[allocation.memoryType];
+		if (block->IsEmpty() && blocks.size() > 1)
+		{
+			vkFreeMemory(_device, block->GetMemory(), nullptr);
+			_deviceAllocationCount--;
+
+			blocks.erase(std::find_if(blocks.begin(), blocks.end(),
+				[block](const UPTR<MemoryBlock>& candidate) { return candidate.get() == block; }));
+		}
+	}
+
+	_allocationCount--;
+	_usedBytes -= allocation.size;
+	allocation = Allocation{};
+}
+
+bool VulkanEngine::MemoryAllocator::CreateBuffer(const VkBufferCreateInfo& createInfo, MemoryUsage usage, VkBuffer& buffer, Allocation& allocation)
+{
+	if (vkCreateBuffer(_device, &createInfo, nullptr, &buffer) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create Buffer\n");
+		return false;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(_device, buffer, &requirements);
+
+	if (!Allocate(requirements, usage, false, allocation)
+		|| vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to bind Buffer memory\n");
+		DestroyBuffer(buffer, allocation);
+		return false;
+	}
+
+	return true;
+}
+
+bool VulkanEngine::MemoryAllocator::CreateImage(const VkImageCreateInfo& createInfo, MemoryUsage usage, VkImage& image, Allocation& allocation)
+{
+	if (vkCreateImage(_device, &createInfo, nullptr, &image) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create Image\n");
+		return false;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(_device, image, &requirements);
+
+	if (!Allocate(requirements, usage, createInfo.tiling == VK_IMAGE_TILING_OPTIMAL, allocation)
+		|| vkBindImageMemory(_device, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to bind Image memory\n");
+		DestroyImage(image, allocation);
+		return false;
+	}
+
+	return true;
+}
+
+void VulkanEngine::MemoryAllocator::DestroyBuffer(VkBuffer buffer, Allocation& allocation)
+{
+	vkDestroyBuffer(_device, buffer, nullptr);
+	Free(allocation);
+}
+
+void VulkanEngine::MemoryAllocator::DestroyImage(VkImage image, Allocation& allocation)
+{
+	vkDestroyImage(_device, image, nullptr);
+	Free(allocation);
+}
+
+VkMappedMemoryRange VulkanEngine::MemoryAllocator::GetAlignedRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+{
+	VkDeviceSize start = allocation.offset + offset;
+	VkDeviceSize end = size == VK_WHOLE_SIZE
+		? allocation.offset + allocation.size
+		: start + size;
+
+	VkDeviceSize memorySize = allocation.block != nullptr ? allocation.block->GetSize() : allocation.size;
+
+	VkMappedMemoryRange range{};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = allocation.memory;
+	range.offset = AlignDown(start, _nonCoherentAtomSize);
+
+	// Rounding up may run past the end of the memory, which only VK_WHOLE_SIZE may express
+	VkDeviceSize alignedEnd = AlignUp(end, _nonCoherentAtomSize);
+	range.size = alignedEnd >= memorySize ? VK_WHOLE_SIZE : alignedEnd - range.offset;
+
+	return range;
+}
+
+void VulkanEngine::MemoryAllocator::Flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+	if (!allocation.IsValid() || IsCoherent(allocation.memoryType))
+		return;
+
+	VkMappedMemoryRange range = GetAlignedRange(allocation, offset, size);
+	vkFlushMappedMemoryRanges(_device, 1, &range);
+}
+
+void VulkanEngine::MemoryAllocator::Invalidate(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+	if (!allocation.IsValid() || IsCoherent(allocation.memoryType))
+		return;
+
+	VkMappedMemoryRange range = GetAlignedRange(allocation, offset, size);
+	vkInvalidateMappedMemoryRanges(_device, 1, &range);
+}
+
+VulkanEngine::MemoryStats VulkanEngine::MemoryAllocator::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	MemoryStats stats;
+	stats.dedicatedCount = _dedicatedCount;
+	stats.allocationCount = _allocationCount;
+	stats.bytesUsed = _usedBytes;
+	stats.bytesReserved = _dedicatedBytes;
+	stats.bytesAllocated = _dedicatedBytes;
+
+	VkDeviceSize freeBytes = 0;
+	for (const auto& blocks : _blocks)
+	{
+		for (const auto& block : blocks)
+		{
+			stats.blockCount++;
+			stats.bytesReserved += block->GetSize();
+			stats.bytesAllocated += block->GetAllocatedBytes();
+			stats.largestFreeRange = std::max(stats.largestFreeRange, block->GetLargestFreeRange());
+			freeBytes += block->GetSize() - block->GetAllocatedBytes();
+		}
+	}
+
+	stats.fragmentation = freeBytes > 0
+		? 1.0 - static_cast<double>(stats.largestFreeRange) / freeBytes
+		: 0;
+
+	return stats;
+}
+
+void VulkanEngine::MemoryAllocator::PrintStats() const
+{
+	MemoryStats stats = GetStats();
+
+	fprintf(stdout, "Device memory : %d allocations in %d blocks + %d dedicated\n"
+		"\tused %llu KiB | allocated %llu KiB | reserved %llu KiB | largest free %llu KiB | fragmentation %.2f\n",
+		stats.allocationCount, stats.blockCount, stats.dedicatedCount,
+		static_cast<unsigned long long>(stats.bytesUsed / 1024),
+		static_cast<unsigned long long>(stats.bytesAllocated / 1024),
+		static_cast<unsigned long long>(stats.bytesReserved / 1024),
+		static_cast<unsigned long long>(stats.largestFreeRange / 1024),
+		stats.fragmentation);
+}
+
+#pragma endregion
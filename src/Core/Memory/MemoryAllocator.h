@@ -0,0 +1,150 @@
+#pragma once
+
+#include <Common.h>
+#include <mutex>
+#include <unordered_map>
+
+namespace VulkanEngine
+{
+	enum class MemoryUsage : UINT8
+	{
+		GpuOnly,	// Device local, never mapped
+		CpuToGpu,	// Host visible, written by the CPU every frame or used as staging
+		GpuToCpu,	// Host visible and preferably cached, read back by the CPU
+	};
+
+	class MemoryBlock;
+
+	struct Allocation
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+
+		// Points at offset inside the persistently mapped block, nullptr for device only memory
+		void* mapped = nullptr;
+
+		UINT32 memoryType = 0;
+
+		// nullptr for dedicated allocations which own their VkDeviceMemory
+		MemoryBlock* block = nullptr;
+
+		inline bool IsValid() const { return memory != VK_NULL_HANDLE; }
+	};
+
+	struct MemoryStats
+	{
+		UINT32 blockCount = 0;
+		UINT32 dedicatedCount = 0;
+		UINT32 allocationCount = 0;
+
+		VkDeviceSize bytesReserved = 0;		// Sum of all VkDeviceMemory sizes
+		VkDeviceSize bytesUsed = 0;			// Sum of requested allocation sizes
+		VkDeviceSize bytesAllocated = 0;	// Sum of buddy nodes handed out, includes rounding waste
+		VkDeviceSize largestFreeRange = 0;
+
+		// 0 when all free memory is one contiguous range, approaches 1 as free space splinters
+		double fragmentation = 0;
+	};
+
+	// Power of two buddy allocator over one VkDeviceMemory. Nodes are always
+	// aligned to their own size relative to the start of the block, so any
+	// alignment up to the node size comes for free.
+	class MemoryBlock
+	{
+	private:
+		VkDeviceMemory _memory = VK_NULL_HANDLE;
+		VkDeviceSize _size = 0;
+		VkDeviceSize _minNodeSize = 0;
+		UINT32 _memoryType = 0;
+		UINT8* _mapped = nullptr;
+
+		// Level 0 is the whole block, every level halves the node size
+		std::vector<std::set<VkDeviceSize>> _freeLists;
+		std::unordered_map<VkDeviceSize, UINT32> _allocatedLevels;
+		VkDeviceSize _allocatedBytes = 0;
+
+		inline VkDeviceSize GetNodeSize(UINT32 level) const { return _size >> level; }
+
+	public:
+		MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, VkDeviceSize minNodeSize, UINT32 memoryType, void* mapped);
+
+		// Returns the offset of a node of at least size bytes aligned to it
+		std::optional<VkDeviceSize> Allocate(VkDeviceSize size);
+		void Free(VkDeviceSize offset);
+
+		VkDeviceSize GetNodeSizeAt(VkDeviceSize offset) const;
+		VkDeviceSize GetLargestFreeRange() const;
+
+		inline VkDeviceMemory GetMemory() const { return _memory; }
+		inline VkDeviceSize GetSize() const { return _size; }
+		inline UINT32 GetMemoryType() const { return _memoryType; }
+		inline UINT8* GetMapped() const { return _mapped; }
+		inline VkDeviceSize GetAllocatedBytes() const { return _allocatedBytes; }
+		inline bool IsEmpty() const { return _allocatedLevels.empty(); }
+	};
+
+	// Sub-allocates buffers and images out of large per memory type blocks so
+	// the engine stays far below maxMemoryAllocationCount. Host visible blocks
+	// are persistently mapped.
+	class MemoryAllocator
+	{
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties _memoryProperties{};
+
+		VkDeviceSize _preferredBlockSize = 0;
+		VkDeviceSize _bufferImageGranularity = 1;
+		VkDeviceSize _nonCoherentAtomSize = 1;
+		UINT32 _maxAllocationCount = 0;
+
+		// Indexed by memory type
+		std::vector<std::vector<UPTR<MemoryBlock>>> _blocks;
+
+		UINT32 _deviceAllocationCount = 0;
+		UINT32 _dedicatedCount = 0;
+		VkDeviceSize _dedicatedBytes = 0;
+		UINT32 _allocationCount = 0;
+		VkDeviceSize _usedBytes = 0;
+
+		mutable std::mutex _mutex;
+
+		std::optional<UINT32> FindMemoryType(UINT32 typeFilter, MemoryUsage usage) const;
+		VkDeviceSize GetBlockSize(UINT32 memoryType) const;
+		VkDeviceSize GetMinNodeSize(UINT32 memoryType) const;
+		bool IsCoherent(UINT32 memoryType) const;
+		bool IsHostVisible(UINT32 memoryType) const;
+
+		bool AllocateDeviceMemory(VkDeviceSize size, UINT32 memoryType, VkDeviceMemory& memory, void** mapped);
+
+		VkMappedMemoryRange GetAlignedRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const;
+
+	public:
+		static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+		MemoryAllocator() = default;
+
+		bool Init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+		void Shutdown();
+
+		// isOptimalImage marks resources that bufferImageGranularity must keep apart from linear ones
+		bool Allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, bool isOptimalImage, Allocation& allocation);
+		void Free(Allocation& allocation);
+
+		bool CreateBuffer(const VkBufferCreateInfo& createInfo, MemoryUsage usage, VkBuffer& buffer, Allocation& allocation);
+		bool CreateImage(const VkImageCreateInfo& createInfo, MemoryUsage usage, VkImage& image, Allocation& allocation);
+		void DestroyBuffer(VkBuffer buffer, Allocation& allocation);
+		void DestroyImage(VkImage image, Allocation& allocation);
+
+		// Ranges are relative to the allocation and widened to nonCoherentAtomSize, no-ops on coherent memory
+		void Flush(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+		void Invalidate(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+		MemoryStats GetStats() const;
+		void PrintStats() const;
+
+	public:
+		MemoryAllocator(const MemoryAllocator&) = delete;
+		MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+	};
+}
@@ -0,0 +1,448 @@
+#include "UploadManager.h"
+
+bool VulkanEngine::UploadManager::Init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator,
+	VkQueue transferQueue, UINT32 transferFamily, UINT32 graphicsFamily,
+	UINT32 framesInFlight, bool useTimeline, VkDeviceSize ringSize)
+{
+	_device = device;
+	_allocator = &allocator;
+	_transferQueue = transferQueue;
+	_transferFamily = transferFamily;
+	_graphicsFamily = graphicsFamily;
+	_ringSize = ringSize;
+	_useTimeline = useTimeline;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	// Image copies need texel sized offsets, 16 covers every uncompressed format and block size
+	_copyAlignment = std::max<VkDeviceSize>(16, deviceProperties.limits.optimalBufferCopyOffsetAlignment);
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = _ringSize;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (!_allocator->CreateBuffer(bufferInfo, MemoryUsage::CpuToGpu, _stagingBuffer, _stagingAllocation))
+	{
+		fprintf(stderr, "Failed to create Staging Ring\n");
+		return false;
+	}
+
+	_commandPools.resize(framesInFlight, VK_NULL_HANDLE);
+	_commandBuffers.resize(framesInFlight, VK_NULL_HANDLE);
+	_semaphores.resize(framesInFlight, VK_NULL_HANDLE);
+	_fences.resize(framesInFlight, VK_NULL_HANDLE);
+	_slotValues.resize(framesInFlight, 0);
+	_acquireBufferBarriers.resize(framesInFlight);
+	_acquireImageBarriers.resize(framesInFlight);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = _transferFamily;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	if (_useTimeline && !_timeline.Create(_device))
+		return false;
+
+	for (UINT32 i = 0; i < framesInFlight; i++)
+	{
+		if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPools[i]) != VK_SUCCESS)
+		{
+			fprintf(stderr, "Failed to create Upload Command Pool\n");
+			return false;
+		}
+
+		if (!_useTimeline
+			&& (vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_semaphores[i]) != VK_SUCCESS
+				|| vkCreateFence(_device, &fenceInfo, nullptr, &_fences[i]) != VK_SUCCESS))
+		{
+			fprintf(stderr, "Failed to create Upload sync objects\n");
+			return false;
+		}
+
+		VkCommandBufferAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = _commandPools[i];
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(_device, &allocateInfo, &_commandBuffers[i]) != VK_SUCCESS)
+		{
+			fprintf(stderr, "Failed to create Upload Command Buffer\n");
+			return false;
+		}
+	}
+
+	fprintf(stdout, "Created Upload Manager (%llu KiB ring, %s transfer queue)\n",
+		static_cast<unsigned long long>(_ringSize / 1024),
+		NeedsOwnershipTransfer() ? "dedicated" : "shared graphics");
+	return true;
+}
+
+void VulkanEngine::UploadManager::Shutdown()
+{
+	for (UINT32 i = 0; i < _commandPools.size(); i++)
+		WaitForSlot(i);
+
+	for (size_t i = 0; i < _commandPools.size(); i++)
+	{
+		if (!_useTimeline)
+		{
+			vkDestroyFence(_device, _fences[i], nullptr);
+			vkDestroySemaphore(_device, _semaphores[i], nullptr);
+		}
+		vkDestroyCommandPool(_device, _commandPools[i], nullptr);
+	}
+
+	_timeline.Destroy();
+
+	_fences.clear();
+	_semaphores.clear();
+	_commandPools.clear();
+	_commandBuffers.clear();
+
+	if (_stagingBuffer != VK_NULL_HANDLE)
+		_allocator->DestroyBuffer(_stagingBuffer, _stagingAllocation);
+	_stagingBuffer = VK_NULL_HANDLE;
+	_imageLayouts.clear();
+}
+
+void VulkanEngine::UploadManager::ForgetImage(VkImage image)
+{
+	std::erase_if(_imageLayouts, [image](const auto& entry) { return entry.first.image == image; });
+}
+
+std::optional<VkDeviceSize> VulkanEngine::UploadManager::AllocateStaging(VkDeviceSize size)
+{
+	VkDeviceSize physical = _writeCursor % _ringSize;
+	VkDeviceSize aligned = (physical + _copyAlignment - 1) / _copyAlignment * _copyAlignment;
+	VkDeviceSize padding = aligned - physical;
+
+	// Ranges never wrap, the tail end is skipped and reclaimed along with this batch
+	if (aligned + size > _ringSize)
+	{
+		padding = _ringSize - physical;
+		aligned = 0;
+	}
+
+	if (_writeCursor + padding + size - _readCursor > _ringSize)
+	{
+		ReclaimCompletedBatches();
+
+		if (_writeCursor + padding + size - _readCursor > _ringSize)
+			return std::nullopt;
+	}
+
+	_writeCursor += padding + size;
+	return aligned;
+}
+
+void VulkanEngine::UploadManager::ReclaimCompletedBatches()
+{
+	if (_inFlight.empty())
+		return;
+
+	// One counter read covers every batch on the timeline
+	UINT64 completedValue = _useTimeline ? _timeline.GetValue() : 0;
+
+	while (!_inFlight.empty())
+	{
+		const Batch& batch = _inFlight.front();
+
+		if (_useTimeline ? batch.timelineValue > completedValue : !IsBatchComplete(batch))
+			break;
+
+		_readCursor = batch.ringEnd;
+		_inFlight.pop_front();
+	}
+}
+
+bool VulkanEngine::UploadManager::IsBatchComplete(const Batch& batch) const
+{
+	// A slot's fence may already belong to a newer batch, which only makes reclaiming late, never early
+	return vkGetFenceStatus(_device, _fences[batch.frame]) == VK_SUCCESS;
+}
+
+void VulkanEngine::UploadManager::WaitForSlot(UINT32 frame)
+{
+	if (_useTimeline)
+		_timeline.Wait(_slotValues[frame]);
+	else
+		vkWaitForFences(_device, 1, &_fences[frame], VK_TRUE, UINT64_MAX);
+}
+
+bool VulkanEngine::UploadManager::UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, bool concurrent)
+{
+	if (size == 0 || size > _ringSize)
+		return false;
+
+	std::optional<VkDeviceSize> stagingOffset = AllocateStaging(size);
+	if (!stagingOffset.has_value())
+		return false;
+
+	memcpy(static_cast<UINT8*>(_stagingAllocation.mapped) + stagingOffset.value(), data, size);
+
+	PendingCopy copy;
+	copy.dstBuffer = dstBuffer;
+	copy.dstOffset = dstOffset;
+	copy.stagingOffset = stagingOffset.value();
+	copy.size = size;
+	copy.concurrent = concurrent;
+	_pending.push_back(copy);
+
+	return true;
+}
+
+bool VulkanEngine::UploadManager::UploadBufferResumable(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize& uploaded,
+	bool concurrent, VkDeviceSize chunkSize)
+{
+	while (uploaded < size)
+	{
+		VkDeviceSize chunk = std::min(size - uploaded, chunkSize);
+		if (!UploadBuffer(dstBuffer, uploaded, static_cast<const UINT8*>(data) + uploaded, chunk, concurrent))
+			return false;
+
+		uploaded += chunk;
+	}
+
+	return true;
+}
+
+bool VulkanEngine::UploadManager::UploadImage(VkImage dstImage, const VkExtent3D& extent, const VkImageSubresourceLayers& subresource,
+	const void* data, VkDeviceSize size, VkImageLayout finalLayout)
+{
+	if (size == 0 || size > _ringSize)
+		return false;
+
+	std::optional<VkDeviceSize> stagingOffset = AllocateStaging(size);
+	if (!stagingOffset.has_value())
+		return false;
+
+	memcpy(static_cast<UINT8*>(_stagingAllocation.mapped) + stagingOffset.value(), data, size);
+
+	PendingCopy copy;
+	copy.dstImage = dstImage;
+	copy.region.bufferOffset = stagingOffset.value();
+	copy.region.imageSubresource = subresource;
+	copy.region.imageExtent = extent;
+	copy.finalLayout = finalLayout;
+	copy.stagingOffset = stagingOffset.value();
+	copy.size = size;
+	_pending.push_back(copy);
+
+	return true;
+}
+
+VulkanEngine::UploadSubmission VulkanEngine::UploadManager::Submit(UINT32 frame, UINT64 frameValue)
+{
+	_acquireBufferBarriers[frame].clear();
+	_acquireImageBarriers[frame].clear();
+
+	if (_pending.empty())
+		return {};
+
+	// The graphics work of this slot waited on the previous batch, so this rarely blocks
+	WaitForSlot(frame);
+	ReclaimCompletedBatches();
+	if (!_useTimeline)
+		vkResetFences(_device, 1, &_fences[frame]);
+	vkResetCommandPool(_device, _commandPools[frame], 0);
+
+	_allocator->Flush(_stagingAllocation);
+
+	VkCommandBuffer commandBuffer = _commandBuffers[frame];
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	UINT32 srcFamily = NeedsOwnershipTransfer() ? _transferFamily : VK_QUEUE_FAMILY_IGNORED;
+	UINT32 dstFamily = NeedsOwnershipTransfer() ? _graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+
+	std::vector<VkImageMemoryBarrier> preCopyBarriers;
+	std::vector<VkBufferMemoryBarrier> releaseBufferBarriers;
+	std::vector<VkImageMemoryBarrier> releaseImageBarriers;
+
+	// Layout each subresource this batch writes is left in, the last copy into it decides
+	std::map<ImageSubresource, VkImageLayout> batchLayouts;
+
+	for (const PendingCopy& copy : _pending)
+	{
+		if (copy.dstImage == VK_NULL_HANDLE)
+			continue;
+
+		const VkImageSubresourceLayers& layers = copy.region.imageSubresource;
+		for (UINT32 layer = layers.baseArrayLayer; layer < layers.baseArrayLayer + layers.layerCount; layer++)
+		{
+			ImageSubresource subresource{ copy.dstImage, layers.aspectMask, layers.mipLevel, layer };
+
+			auto [entry, first] = batchLayouts.try_emplace(subresource, copy.finalLayout);
+			if (!first)
+			{
+				entry->second = copy.finalLayout;
+				continue;
+			}
+
+			// Only a subresource never written before may drop its contents, later uploads keep what earlier ones wrote
+			auto known = _imageLayouts.find(subresource);
+
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.oldLayout = known != _imageLayouts.end() ? known->second : VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = copy.dstImage;
+			barrier.subresourceRange = { layers.aspectMask, layers.mipLevel, 1, layer, 1 };
+			preCopyBarriers.push_back(barrier);
+		}
+	}
+
+	if (!preCopyBarriers.empty())
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, static_cast<UINT32>(preCopyBarriers.size()), preCopyBarriers.data());
+
+	std::set<ImageSubresource> copiedSubresources;
+
+	for (const PendingCopy& copy : _pending)
+	{
+		if (copy.dstImage != VK_NULL_HANDLE)
+		{
+			// Copies into a subresource written earlier in the batch are ordered after that write
+			const VkImageSubresourceLayers& layers = copy.region.imageSubresource;
+			bool rewrite = false;
+			for (UINT32 layer = layers.baseArrayLayer; layer < layers.baseArrayLayer + layers.layerCount; layer++)
+				rewrite |= !copiedSubresources.insert(ImageSubresource{ copy.dstImage, layers.aspectMask, layers.mipLevel, layer }).second;
+
+			if (rewrite)
+			{
+				VkMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+					1, &barrier, 0, nullptr, 0, nullptr);
+			}
+
+			vkCmdCopyBufferToImage(commandBuffer, _stagingBuffer, copy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+		}
+		else
+		{
+			VkBufferCopy region{};
+			region.srcOffset = copy.stagingOffset;
+			region.dstOffset = copy.dstOffset;
+			region.size = copy.size;
+			vkCmdCopyBuffer(commandBuffer, _stagingBuffer, copy.dstBuffer, 1, &region);
+
+			// Same family or concurrent sharing needs no buffer barrier, the semaphore already orders and publishes the writes
+			if (!NeedsOwnershipTransfer() || copy.concurrent)
+				continue;
+
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.srcQueueFamilyIndex = srcFamily;
+			barrier.dstQueueFamilyIndex = dstFamily;
+			barrier.buffer = copy.dstBuffer;
+			barrier.offset = copy.dstOffset;
+			barrier.size = copy.size;
+			releaseBufferBarriers.push_back(barrier);
+		}
+	}
+
+	// Also performs the layout transition, once per subresource, repeated identically by the acquire
+	for (const auto& [subresource, finalLayout] : batchLayouts)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = finalLayout;
+		barrier.srcQueueFamilyIndex = srcFamily;
+		barrier.dstQueueFamilyIndex = dstFamily;
+		barrier.image = subresource.image;
+		barrier.subresourceRange = { subresource.aspectMask, subresource.mipLevel, 1, subresource.arrayLayer, 1 };
+		releaseImageBarriers.push_back(barrier);
+
+		_imageLayouts[subresource] = finalLayout;
+	}
+
+	if (!releaseBufferBarriers.empty() || !releaseImageBarriers.empty())
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr,
+			static_cast<UINT32>(releaseBufferBarriers.size()), releaseBufferBarriers.data(),
+			static_cast<UINT32>(releaseImageBarriers.size()), releaseImageBarriers.data());
+
+	vkEndCommandBuffer(commandBuffer);
+
+	// Matching acquire half, recorded by the graphics queue before first use
+	if (NeedsOwnershipTransfer())
+	{
+		for (VkBufferMemoryBarrier barrier : releaseBufferBarriers)
+		{
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			_acquireBufferBarriers[frame].push_back(barrier);
+		}
+
+		for (VkImageMemoryBarrier barrier : releaseImageBarriers)
+		{
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			_acquireImageBarriers[frame].push_back(barrier);
+		}
+	}
+
+	UploadSubmission submission;
+	submission.semaphore = _useTimeline ? _timeline.GetHandle() : _semaphores[frame];
+	submission.value = _useTimeline ? frameValue : 0;
+
+	SemaphoreSubmit semaphores;
+	semaphores.Signal(submission.semaphore, submission.value);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	semaphores.Fill(submitInfo, _useTimeline);
+
+	if (vkQueueSubmit(_transferQueue, 1, &submitInfo, _useTimeline ? VK_NULL_HANDLE : _fences[frame]) != VK_SUCCESS)
+		throw std::runtime_error("Failed to submit uploads to transfer queue");
+
+	_slotValues[frame] = submission.value;
+	_inFlight.push_back({ frame, _writeCursor, submission.value });
+	_pending.clear();
+
+	return submission;
+}
+
+void VulkanEngine::UploadManager::RecordAcquireBarriers(VkCommandBuffer commandBuffer, UINT32 frame)
+{
+	std::vector<VkBufferMemoryBarrier>& bufferBarriers = _acquireBufferBarriers[frame];
+	std::vector<VkImageMemoryBarrier>& imageBarriers = _acquireImageBarriers[frame];
+
+	if (bufferBarriers.empty() && imageBarriers.empty())
+		return;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+		0, nullptr,
+		static_cast<UINT32>(bufferBarriers.size()), bufferBarriers.data(),
+		static_cast<UINT32>(imageBarriers.size()), imageBarriers.data());
+
+	bufferBarriers.clear();
+	imageBarriers.clear();
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <Common.h>
+#include <deque>
+#include <Memory/MemoryAllocator.h>
+#include <Sync/TimelineSemaphore.h>
+
+namespace VulkanEngine
+{
+	// What a graphics submission has to wait on for this frame's uploads,
+	// value is 0 for binary semaphores and the frame value for the timeline
+	struct UploadSubmission
+	{
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		UINT64 value = 0;
+	};
+
+	// Streams data to device local resources through one persistently mapped
+	// staging ring. Uploads queued during a frame are recorded into a single
+	// command buffer and submitted once to the transfer queue, ownership is then
+	// released to the graphics family and acquired by the frame's command buffer.
+	class UploadManager
+	{
+		struct PendingCopy
+		{
+			VkBuffer dstBuffer = VK_NULL_HANDLE;
+			VkDeviceSize dstOffset = 0;
+
+			VkImage dstImage = VK_NULL_HANDLE;
+			VkBufferImageCopy region{};
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			VkDeviceSize stagingOffset = 0;
+			VkDeviceSize size = 0;
+
+			bool concurrent = false;	// Created with VK_SHARING_MODE_CONCURRENT, owned by no single family
+		};
+
+		// One mip level of one array layer, image layouts are tracked at this granularity
+		struct ImageSubresource
+		{
+			VkImage image = VK_NULL_HANDLE;
+			VkImageAspectFlags aspectMask = 0;
+			UINT32 mipLevel = 0;
+			UINT32 arrayLayer = 0;
+
+			auto operator<=>(const ImageSubresource&) const = default;
+		};
+
+		struct Batch
+		{
+			UINT32 frame;
+			UINT64 ringEnd;
+			UINT64 timelineValue;
+		};
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		MemoryAllocator* _allocator = nullptr;
+
+		VkQueue _transferQueue = VK_NULL_HANDLE;
+		UINT32 _transferFamily = 0;
+		UINT32 _graphicsFamily = 0;
+
+		VkBuffer _stagingBuffer = VK_NULL_HANDLE;
+		Allocation _stagingAllocation;
+		VkDeviceSize _ringSize = 0;
+		VkDeviceSize _copyAlignment = 16;
+
+		// Virtual cursors only ever grow, the physical offset is cursor % _ringSize
+		UINT64 _writeCursor = 0;
+		UINT64 _readCursor = 0;
+
+		std::vector<PendingCopy> _pending;
+		std::deque<Batch> _inFlight;
+
+		// Indexed by frame in flight
+		std::vector<VkCommandPool> _commandPools;
+		std::vector<VkCommandBuffer> _commandBuffers;
+		std::vector<VkSemaphore> _semaphores;
+		std::vector<VkFence> _fences;
+		std::vector<UINT64> _slotValues;
+		std::vector<std::vector<VkBufferMemoryBarrier>> _acquireBufferBarriers;
+		std::vector<std::vector<VkImageMemoryBarrier>> _acquireImageBarriers;
+
+		// Layout every uploaded subresource was left in, one missing here was never written
+		std::map<ImageSubresource, VkImageLayout> _imageLayouts;
+
+		// Replaces the per slot semaphores and fences when set
+		bool _useTimeline = false;
+		TimelineSemaphore _timeline;
+
+		std::optional<VkDeviceSize> AllocateStaging(VkDeviceSize size);
+		void ReclaimCompletedBatches();
+		bool IsBatchComplete(const Batch& batch) const;
+		void WaitForSlot(UINT32 frame);
+
+		inline bool NeedsOwnershipTransfer() const { return _transferFamily != _graphicsFamily; }
+
+	public:
+		static constexpr VkDeviceSize DEFAULT_RING_SIZE = 32ull * 1024 * 1024;
+
+		// Leaves room for other uploads of the frame when a large buffer streams in
+		static constexpr VkDeviceSize DEFAULT_CHUNK_SIZE = 4ull * 1024 * 1024;
+
+		UploadManager() = default;
+
+		bool Init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator,
+			VkQueue transferQueue, UINT32 transferFamily, UINT32 graphicsFamily,
+			UINT32 framesInFlight, bool useTimeline, VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+		void Shutdown();
+
+		// Copies data into the staging ring right away, the device copy happens in the next Submit.
+		// Returns false when the ring has no room left this frame, retry after the next Submit.
+		// Buffers created with VK_SHARING_MODE_CONCURRENT pass concurrent and skip the ownership transfer.
+		bool UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, bool concurrent = false);
+
+		// Queues data in pieces of at most chunkSize for as long as the ring has room, uploaded is the
+		// progress carried between calls. Returns true once everything is queued, large buffers
+		// spread over several frames instead of failing.
+		bool UploadBufferResumable(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize& uploaded,
+			bool concurrent = false, VkDeviceSize chunkSize = DEFAULT_CHUNK_SIZE);
+		bool UploadImage(VkImage dstImage, const VkExtent3D& extent, const VkImageSubresourceLayers& subresource,
+			const void* data, VkDeviceSize size, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		// Drops the layouts tracked for an image about to be destroyed, its handle may be reused
+		void ForgetImage(VkImage image);
+
+		// Submits every pending copy as one batch for this frame slot. Returns the semaphore
+		// the frame's graphics submission has to wait on, VK_NULL_HANDLE when nothing was queued.
+		// frameValue is signaled on the timeline and must grow with every call.
+		// Must only be called once the frame is certain to be submitted.
+		UploadSubmission Submit(UINT32 frame, UINT64 frameValue);
+
+		// Acquires ownership of everything released by this frame's Submit, record before first use
+		void RecordAcquireBarriers(VkCommandBuffer commandBuffer, UINT32 frame);
+
+		inline bool HasPendingUploads() const { return !_pending.empty(); }
+
+	public:
+		UploadManager(const UploadManager&) = delete;
+		UploadManager& operator=(const UploadManager&) = delete;
+	};
+}
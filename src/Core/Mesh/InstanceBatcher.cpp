@@ -0,0 +1,186 @@
+#include "InstanceBatcher.h"
+#include <chrono>
+#include <cstring>
+
+bool VulkanEngine::InstanceBatcher::Init(MemoryAllocator& allocator, JobSystem& jobs, UINT32 framesInFlight, UINT32 initialCapacity)
+{
+	_allocator = &allocator;
+	_jobs = &jobs;
+	_frames.resize(framesInFlight);
+	initialCapacity = std::max(initialCapacity, 1u);
+
+	for (FrameBuffer& frame : _frames)
+	{
+		if (!Reserve(frame, initialCapacity))
+			return false;
+	}
+
+	fprintf(stdout, "Created Instance Batcher (%u instances per frame)\n", initialCapacity);
+	return true;
+}
+
+void VulkanEngine::InstanceBatcher::Shutdown()
+{
+	for (FrameBuffer& frame : _frames)
+	{
+		if (frame.buffer != VK_NULL_HANDLE)
+			_allocator->DestroyBuffer(frame.buffer, frame.allocation);
+	}
+
+	_frames.clear();
+	_submissions.clear();
+	_batches.clear();
+}
+
+bool VulkanEngine::InstanceBatcher::Reserve(FrameBuffer& frame, UINT64 instanceCount)
+{
+	if (instanceCount <= frame.capacity)
+		return true;
+
+	// Grows in powers of two so a slowly rising count doesn't reallocate every frame
+	UINT64 capacity = std::max<UINT64>(frame.capacity, 1);
+	while (capacity < instanceCount)
+		capacity *= 2;
+
+	if (capacity > UINT32_MAX)
+	{
+		fprintf(stderr, "Instance count %llu is out of range\n", static_cast<unsigned long long>(instanceCount));
+		return false;
+	}
+
+	// The frame slot was waited on, nothing reads its old buffer anymore
+	if (frame.buffer != VK_NULL_HANDLE)
+		_allocator->DestroyBuffer(frame.buffer, frame.allocation);
+	frame.buffer = VK_NULL_HANDLE;
+	frame.capacity = 0;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = capacity * sizeof(InstanceData);
+	bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (!_allocator->CreateBuffer(bufferInfo, MemoryUsage::CpuToGpu, frame.buffer, frame.allocation))
+	{
+		fprintf(stderr, "Failed to create Instance Buffer\n");
+		return false;
+	}
+
+	frame.capacity = static_cast<UINT32>(capacity);
+	return true;
+}
+
+void VulkanEngine::InstanceBatcher::Submit(const Mesh& mesh, const PipelineHandle& material, std::span<const InstanceData> instances)
+{
+	if (!instances.empty())
+		_submissions.push_back(Submission{ &mesh, material, instances });
+}
+
+bool VulkanEngine::InstanceBatcher::Flush(UINT32 frame)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	_frame = frame;
+	_batches.clear();
+	_stats = Stats{};
+	_stats.submissions = static_cast<UINT32>(_submissions.size());
+
+	// Materials change the most state, so they are the outer sort key. Stable so instances keep their submit order
+	std::stable_sort(_submissions.begin(), _submissions.end(), [](const Submission& a, const Submission& b)
+		{
+			if (a.material != b.material)
+				return a.material < b.material;
+			return a.mesh < b.mesh;
+		});
+
+	UINT64 instanceCount = 0;
+	for (const Submission& submission : _submissions)
+		instanceCount += submission.instances.size();
+
+	FrameBuffer& buffer = _frames[frame];
+	if (!Reserve(buffer, instanceCount))
+	{
+		_submissions.clear();
+		return false;
+	}
+
+	// Every submission is cut into pieces small enough to spread over the job threads
+	struct Copy
+	{
+		const InstanceData* source;
+		UINT32 offset;
+		UINT32 count;
+	};
+
+	std::vector<Copy> copies;
+	UINT32 offset = 0;
+
+	for (const Submission& submission : _submissions)
+	{
+		if (_batches.empty() || _batches.back().material != submission.material || _batches.back().mesh != submission.mesh)
+			_batches.push_back(InstanceBatch{ submission.mesh, submission.material, offset, 0 });
+
+		UINT32 count = static_cast<UINT32>(submission.instances.size());
+		for (UINT32 first = 0; first < count; first += PACK_GRAIN)
+			copies.push_back(Copy{ submission.instances.data() + first, offset + first, std::min(PACK_GRAIN, count - first) });
+
+		_batches.back().instanceCount += count;
+		offset += count;
+	}
+
+	InstanceData* mapped = static_cast<InstanceData*>(buffer.allocation.mapped);
+	auto copyRange = [&copies, mapped](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				memcpy(mapped + copies[i].offset, copies[i].source, copies[i].count * sizeof(InstanceData));
+		};
+
+	if (instanceCount >= PARALLEL_PACK_THRESHOLD)
+		_jobs->ParallelFor(copies.size(), 1, copyRange);
+	else
+		copyRange(0, copies.size());
+
+	VkDeviceSize bytes = instanceCount * sizeof(InstanceData);
+	if (bytes > 0)
+		_allocator->Flush(buffer.allocation, 0, bytes);
+
+	_submissions.clear();
+
+	_stats.batches = static_cast<UINT32>(_batches.size());
+	_stats.instances = instanceCount;
+	_stats.bytes = bytes;
+	_stats.packTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return true;
+}
+
+void VulkanEngine::InstanceBatcher::Bind(VkCommandBuffer commandBuffer) const
+{
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, INSTANCE_BINDING, 1, &_frames[_frame].buffer, &offset);
+}
+
+void VulkanEngine::InstanceBatcher::AddInstanceLayout(VertexLayout& layout)
+{
+	VkVertexInputBindingDescription binding{};
+	binding.binding = INSTANCE_BINDING;
+	binding.stride = sizeof(InstanceData);
+	binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	layout.bindings.push_back(binding);
+
+	const UINT32 offsets[] =
+	{
+		offsetof(InstanceData, positionScale),
+		offsetof(InstanceData, rotation),
+		offsetof(InstanceData, color)
+	};
+
+	for (UINT32 i = 0; i < ARRAYSIZE(offsets); i++)
+	{
+		VkVertexInputAttributeDescription attribute{};
+		attribute.location = INSTANCE_LOCATION + i;
+		attribute.binding = INSTANCE_BINDING;
+		attribute.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attribute.offset = offsets[i];
+		layout.attributes.push_back(attribute);
+	}
+}
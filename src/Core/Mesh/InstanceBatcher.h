@@ -0,0 +1,111 @@
+#pragma once
+
+#include <Common.h>
+#include <span>
+#include <glm/glm.hpp>
+#include <Jobs/JobSystem.h>
+#include <Memory/MemoryAllocator.h>
+#include <Mesh/Mesh.h>
+#include <Pipeline/PipelineCompiler.h>
+#include <Pipeline/PipelineDesc.h>
+
+namespace VulkanEngine
+{
+	// Per instance vertex attributes, read at INSTANCE_LOCATION onwards
+	struct InstanceData
+	{
+		glm::vec4 positionScale;	// xyz translation, w uniform scale
+		glm::vec4 rotation;			// Unit quaternion, w is the scalar part
+		glm::vec4 color;			// rgb tint, a is free for materials
+	};
+
+	// One instanced draw, firstInstance indexes the frame's instance buffer
+	struct InstanceBatch
+	{
+		const Mesh* mesh = nullptr;
+		PipelineHandle material;
+		UINT32 firstInstance = 0;
+		UINT32 instanceCount = 0;
+	};
+
+	// Collects the instances submitted during a frame and merges every submission
+	// sharing a mesh and material into one instanced draw. Instance data is packed
+	// into a persistently mapped buffer per frame in flight, so the GPU reads it
+	// straight from host visible memory without a staging copy.
+	class InstanceBatcher
+	{
+		struct Submission
+		{
+			const Mesh* mesh;
+			PipelineHandle material;
+			std::span<const InstanceData> instances;
+		};
+
+		struct FrameBuffer
+		{
+			VkBuffer buffer = VK_NULL_HANDLE;
+			Allocation allocation;
+			UINT32 capacity = 0;
+		};
+
+	public:
+		struct Stats
+		{
+			UINT32 submissions = 0;
+			UINT32 batches = 0;
+			UINT64 instances = 0;
+			VkDeviceSize bytes = 0;
+			double packTime = 0;	// Milliseconds spent copying into the instance buffer
+		};
+
+	private:
+		MemoryAllocator* _allocator = nullptr;
+		JobSystem* _jobs = nullptr;
+
+		// Indexed by frame in flight
+		std::vector<FrameBuffer> _frames;
+		UINT32 _frame = 0;
+
+		std::vector<Submission> _submissions;
+		std::vector<InstanceBatch> _batches;
+
+		Stats _stats;
+
+		bool Reserve(FrameBuffer& frame, UINT64 instanceCount);
+
+	public:
+		static constexpr UINT32 INSTANCE_BINDING = 1;
+		static constexpr UINT32 INSTANCE_LOCATION = static_cast<UINT32>(VertexSemantic::Count);
+
+		// Below this many instances the copy runs inline, above it is split across the job system
+		static constexpr UINT32 PARALLEL_PACK_THRESHOLD = 64 * 1024;
+		static constexpr UINT32 PACK_GRAIN = 16 * 1024;
+
+		InstanceBatcher() = default;
+
+		bool Init(MemoryAllocator& allocator, JobSystem& jobs, UINT32 framesInFlight, UINT32 initialCapacity = 1024);
+		void Shutdown();
+
+		// The span is only read in Flush and must stay valid until then
+		void Submit(const Mesh& mesh, const PipelineHandle& material, std::span<const InstanceData> instances);
+
+		// Packs this frame's submissions and builds the batches. Call once the frame slot's
+		// previous use completed, the slot's buffer may be reallocated to fit.
+		bool Flush(UINT32 frame);
+
+		// Binds the instance buffer written by the last Flush
+		void Bind(VkCommandBuffer commandBuffer) const;
+
+		inline const std::vector<InstanceBatch>& GetBatches() const { return _batches; }
+
+		// Of the last Flush
+		inline const Stats& GetStats() const { return _stats; }
+
+		// Adds the instance binding and its attributes to a mesh layout
+		static void AddInstanceLayout(VertexLayout& layout);
+
+	public:
+		InstanceBatcher(const InstanceBatcher&) = delete;
+		InstanceBatcher& operator=(const InstanceBatcher&) = delete;
+	};
+}
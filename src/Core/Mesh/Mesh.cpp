@@ -0,0 +1,320 @@
+#include "Mesh.h"
+#include <cstring>
+#include <Mesh/Quantize.h>
+
+namespace
+{
+	template<typename T>
+	void Write(UINT8* destination, const T* values, size_t count)
+	{
+		memcpy(destination, values, sizeof(T) * count);
+	}
+
+	// Attribute used when the mesh has no stream for a semantic
+	template<typename T>
+	T GetOr(const std::vector<T>& stream, size_t index, T fallback)
+	{
+		return index < stream.size() ? stream[index] : fallback;
+	}
+}
+
+VulkanEngine::MeshData VulkanEngine::MeshData::CreateSphere(UINT32 rings, UINT32 segments)
+{
+	rings = std::max(rings, 2u);
+	segments = std::max(segments, 3u);
+
+	MeshData data;
+
+	// Seams and poles get their own vertices so every vertex has a unique uv
+	for (UINT32 ring = 0; ring <= rings; ring++)
+	{
+		float v = static_cast<float>(ring) / rings;
+		float theta = v * glm::pi<float>();
+
+		for (UINT32 segment = 0; segment <= segments; segment++)
+		{
+			float u = static_cast<float>(segment) / segments;
+			float phi = u * 2.0f * glm::pi<float>();
+
+			glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+
+			data.positions.push_back(normal);
+			data.normals.push_back(normal);
+			data.tangents.push_back(glm::vec4(-std::sin(phi), 0.0f, std::cos(phi), 1.0f));
+			data.texCoords.push_back(glm::vec2(u, v));
+		}
+	}
+
+	UINT32 stride = segments + 1;
+	for (UINT32 ring = 0; ring < rings; ring++)
+	{
+		for (UINT32 segment = 0; segment < segments; segment++)
+		{
+			UINT32 a = ring * stride + segment;
+			UINT32 b = a + stride;
+
+			// The first ring's and the last ring's second triangle would be degenerate at the poles
+			if (ring != 0)
+				data.indices.insert(data.indices.end(), { a, a + 1, b });
+			if (ring != rings - 1)
+				data.indices.insert(data.indices.end(), { a + 1, b + 1, b });
+		}
+	}
+
+	return data;
+}
+
+bool VulkanEngine::Mesh::Create(MemoryAllocator& allocator, std::span<const MeshData> lods, const VertexFormat& format)
+{
+	if (!format.Validate())
+		return false;
+
+	bool valid = !lods.empty();
+	for (const MeshData& lod : lods)
+		valid = valid && !lod.positions.empty() && !lod.indices.empty();
+
+	if (!valid)
+	{
+		fprintf(stderr, "Mesh needs positions and indices\n");
+		return false;
+	}
+
+	_allocator = &allocator;
+	_format = format;
+	_vertexCount = 0;
+	_indexCount = 0;
+	_lods.clear();
+
+	// Indices are fetched before vertexOffset is added, so only the largest level has to fit in 16 bits
+	size_t largestLod = 0;
+	for (const MeshData& lod : lods)
+	{
+		largestLod = std::max(largestLod, lod.positions.size());
+		_vertexCount += static_cast<UINT32>(lod.positions.size());
+	}
+
+	_indexType = largestLod <= std::numeric_limits<UINT16>::max() ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+	ComputeBounds(lods);
+	_vertexData.assign(static_cast<size_t>(_format.GetStride()) * _vertexCount, 0);
+	_indexData.clear();
+
+	UINT32 vertexOffset = 0;
+	for (const MeshData& lod : lods)
+	{
+		MeshLod range;
+		range.firstIndex = _indexCount;
+		range.indexCount = static_cast<UINT32>(lod.indices.size());
+		range.vertexOffset = static_cast<INT32>(vertexOffset);
+
+		EncodeVertices(lod, vertexOffset);
+		EncodeIndices(lod);
+
+		vertexOffset += static_cast<UINT32>(lod.positions.size());
+		_indexCount += range.indexCount;
+		_lods.push_back(range);
+	}
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	bufferInfo.size = _vertexData.size();
+	bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	if (!allocator.CreateBuffer(bufferInfo, MemoryUsage::GpuOnly, _vertexBuffer, _vertexAllocation))
+	{
+		fprintf(stderr, "Failed to create Vertex Buffer\n");
+		Destroy();
+		return false;
+	}
+
+	bufferInfo.size = _indexData.size();
+	bufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	if (!allocator.CreateBuffer(bufferInfo, MemoryUsage::GpuOnly, _indexBuffer, _indexAllocation))
+	{
+		fprintf(stderr, "Failed to create Index Buffer\n");
+		Destroy();
+		return false;
+	}
+
+	UINT32 floatStride = VertexFormat::Standard().GetStride();
+	fprintf(stdout, "Created Mesh (%zu lods, %u vertices, %u indices, %u byte vertices, %.0f%% of float, %s indices)\n",
+		_lods.size(), _vertexCount, _indexCount, _format.GetStride(), 100.0 * _format.GetStride() / floatStride,
+		_indexType == VK_INDEX_TYPE_UINT16 ? "16 bit" : "32 bit");
+	return true;
+}
+
+void VulkanEngine::Mesh::Destroy()
+{
+	if (_allocator != nullptr)
+	{
+		if (_vertexBuffer != VK_NULL_HANDLE)
+			_allocator->DestroyBuffer(_vertexBuffer, _vertexAllocation);
+		if (_indexBuffer != VK_NULL_HANDLE)
+			_allocator->DestroyBuffer(_indexBuffer, _indexAllocation);
+	}
+
+	_vertexBuffer = VK_NULL_HANDLE;
+	_indexBuffer = VK_NULL_HANDLE;
+	_vertexData.clear();
+	_indexData.clear();
+	_vertexUploaded = 0;
+	_indexUploaded = 0;
+	_resident = false;
+}
+
+#pragma region Encoding
+
+void VulkanEngine::Mesh::ComputeBounds(std::span<const MeshData> lods)
+{
+	// Every level shares the bounds so quantized positions decode the same way
+	glm::vec3 minimum = lods[0].positions[0];
+	glm::vec3 maximum = lods[0].positions[0];
+	for (const MeshData& lod : lods)
+	{
+		for (const glm::vec3& position : lod.positions)
+		{
+			minimum = glm::min(minimum, position);
+			maximum = glm::max(maximum, position);
+		}
+	}
+
+	// Flat meshes still get a non zero extent so the division when encoding stays finite
+	_bounds.center = (minimum + maximum) * 0.5f;
+	_bounds.extent = glm::max((maximum - minimum) * 0.5f, glm::vec3(1e-6f));
+}
+
+void VulkanEngine::Mesh::EncodeVertices(const MeshData& data, size_t firstVertex)
+{
+	UINT32 stride = _format.GetStride();
+
+	for (size_t i = 0; i < data.positions.size(); i++)
+	{
+		UINT8* vertex = _vertexData.data() + (firstVertex + i) * stride;
+
+		glm::vec3 position = data.positions[i];
+		glm::vec3 normal = GetOr(data.normals, i, glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::vec4 tangent = GetOr(data.tangents, i, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+		glm::vec2 texCoord = GetOr(data.texCoords, i, glm::vec2(0.0f));
+
+		for (const VertexElement& element : _format.GetElements())
+		{
+			UINT8* destination = vertex + element.offset;
+
+			switch (element.semantic)
+			{
+			case VertexSemantic::Position:
+				if (element.encoding == VertexEncoding::Float32)
+				{
+					Write(destination, &position.x, 3);
+				}
+				else if (element.encoding == VertexEncoding::Half)
+				{
+					UINT16 packed[] = { Quantize::PackHalf(position.x), Quantize::PackHalf(position.y), Quantize::PackHalf(position.z), Quantize::PackHalf(tangent.w) };
+					Write(destination, packed, 4);
+				}
+				else
+				{
+					glm::vec3 local = (position - _bounds.center) / _bounds.extent;
+					INT16 packed[] = { Quantize::PackSnorm16(local.x), Quantize::PackSnorm16(local.y), Quantize::PackSnorm16(local.z), Quantize::PackSnorm16(tangent.w) };
+					Write(destination, packed, 4);
+				}
+				break;
+
+			case VertexSemantic::Normal:
+			case VertexSemantic::Tangent:
+			{
+				glm::vec3 direction = element.semantic == VertexSemantic::Normal ? normal : glm::vec3(tangent.x, tangent.y, tangent.z);
+				if (element.encoding == VertexEncoding::Octahedral16)
+				{
+					glm::vec2 encoded = Quantize::OctahedralEncode(direction);
+					INT16 packed[] = { Quantize::PackSnorm16(encoded.x), Quantize::PackSnorm16(encoded.y) };
+					Write(destination, packed, 2);
+				}
+				else if (element.semantic == VertexSemantic::Normal)
+					Write(destination, &normal.x, 3);
+				else
+					Write(destination, &tangent.x, 4);
+				break;
+			}
+
+			case VertexSemantic::TexCoord:
+				if (element.encoding == VertexEncoding::Float32)
+				{
+					Write(destination, &texCoord.x, 2);
+				}
+				else if (element.encoding == VertexEncoding::Half)
+				{
+					UINT16 packed[] = { Quantize::PackHalf(texCoord.x), Quantize::PackHalf(texCoord.y) };
+					Write(destination, packed, 2);
+				}
+				else
+				{
+					UINT16 packed[] = { Quantize::PackUnorm16(texCoord.x), Quantize::PackUnorm16(texCoord.y) };
+					Write(destination, packed, 2);
+				}
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+}
+
+void VulkanEngine::Mesh::EncodeIndices(const MeshData& data)
+{
+	size_t offset = _indexData.size();
+
+	// Halves the index fetch whenever every vertex of a level is addressable in 16 bits
+	if (_indexType == VK_INDEX_TYPE_UINT16)
+	{
+		_indexData.resize(offset + data.indices.size() * sizeof(UINT16));
+
+		UINT16* indices = reinterpret_cast<UINT16*>(_indexData.data() + offset);
+		for (size_t i = 0; i < data.indices.size(); i++)
+			indices[i] = static_cast<UINT16>(data.indices[i]);
+	}
+	else
+	{
+		_indexData.resize(offset + data.indices.size() * sizeof(UINT32));
+		Write(_indexData.data() + offset, data.indices.data(), data.indices.size());
+	}
+}
+
+#pragma endregion
+
+#pragma region Upload
+
+VulkanEngine::UploadStatus VulkanEngine::Mesh::Upload(UploadManager& uploader)
+{
+	if (!IsCreated())
+		return UploadStatus::Failed;
+	if (_resident)
+		return UploadStatus::Uploaded;
+
+	if (!uploader.UploadBufferResumable(_vertexBuffer, _vertexData.data(), _vertexData.size(), _vertexUploaded)
+		|| !uploader.UploadBufferResumable(_indexBuffer, _indexData.data(), _indexData.size(), _indexUploaded))
+		return UploadStatus::RingFull;
+
+	// The staging ring holds its own copy, so the CPU side can go
+	_vertexData = std::vector<UINT8>();
+	_indexData = std::vector<UINT8>();
+	_resident = true;
+	return UploadStatus::Uploaded;
+}
+
+#pragma endregion
+
+void VulkanEngine::Mesh::Bind(VkCommandBuffer commandBuffer) const
+{
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &_vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, _indexBuffer, 0, _indexType);
+}
+
+void VulkanEngine::Mesh::Draw(VkCommandBuffer commandBuffer, UINT32 instanceCount, UINT32 firstInstance, UINT32 lod) const
+{
+	const MeshLod& range = _lods[std::min<size_t>(lod, _lods.size() - 1)];
+	vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount, range.firstIndex, range.vertexOffset, firstInstance);
+}
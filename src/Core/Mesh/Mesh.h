@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Common.h>
+#include <span>
+#include <glm/glm.hpp>
+#include <Assets/AssetLoader.h>
+#include <Memory/MemoryAllocator.h>
+#include <Memory/UploadManager.h>
+#include <Mesh/VertexFormat.h>
+
+namespace VulkanEngine
+{
+	// Unquantized geometry as authored, every attribute stream is optional but positions
+	struct MeshData
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec4> tangents;	// w is the bitangent sign
+		std::vector<glm::vec2> texCoords;
+		std::vector<UINT32> indices;
+
+		// UV sphere of unit radius, triangles wind counter clockwise seen from outside
+		static MeshData CreateSphere(UINT32 rings, UINT32 segments);
+	};
+
+	// Axis aligned box quantized positions are relative to, extent is the half size
+	struct MeshBounds
+	{
+		glm::vec3 center{ 0.0f };
+		glm::vec3 extent{ 1.0f };
+	};
+
+	// Index range of one level of detail, indices are relative to vertexOffset
+	struct MeshLod
+	{
+		UINT32 firstIndex = 0;
+		UINT32 indexCount = 0;
+		INT32 vertexOffset = 0;
+	};
+
+	// Interleaved vertex buffer and index buffer in device local memory. The vertices
+	// are encoded once on the CPU in the given format and streamed through the
+	// staging ring, large meshes spread over as many frames as the ring needs.
+	// Levels of detail share both buffers so one indirect draw can mix them.
+	class Mesh
+	{
+	private:
+		MemoryAllocator* _allocator = nullptr;
+
+		VkBuffer _vertexBuffer = VK_NULL_HANDLE;
+		Allocation _vertexAllocation;
+		VkBuffer _indexBuffer = VK_NULL_HANDLE;
+		Allocation _indexAllocation;
+
+		VertexFormat _format;
+		MeshBounds _bounds;
+		VkIndexType _indexType = VK_INDEX_TYPE_UINT32;
+		UINT32 _vertexCount = 0;
+		UINT32 _indexCount = 0;
+		std::vector<MeshLod> _lods;
+
+		// Encoded data waiting for upload, released once resident
+		std::vector<UINT8> _vertexData;
+		std::vector<UINT8> _indexData;
+		VkDeviceSize _vertexUploaded = 0;
+		VkDeviceSize _indexUploaded = 0;
+		bool _resident = false;
+
+		void ComputeBounds(std::span<const MeshData> lods);
+		void EncodeVertices(const MeshData& data, size_t firstVertex);
+		void EncodeIndices(const MeshData& data);
+
+	public:
+		Mesh() = default;
+
+		// Lods go from most to least detailed. Fails on a level without positions or indices
+		bool Create(MemoryAllocator& allocator, std::span<const MeshData> lods, const VertexFormat& format);
+		inline bool Create(MemoryAllocator& allocator, const MeshData& data, const VertexFormat& format) { return Create(allocator, std::span<const MeshData>(&data, 1), format); }
+		void Destroy();
+
+		// Queues the next chunks, RingFull until everything is queued. Call before the uploader's
+		// Submit, the mesh can be drawn by the same frame once Uploaded is returned.
+		UploadStatus Upload(UploadManager& uploader);
+
+		void Bind(VkCommandBuffer commandBuffer) const;
+		void Draw(VkCommandBuffer commandBuffer, UINT32 instanceCount = 1, UINT32 firstInstance = 0, UINT32 lod = 0) const;
+
+		inline bool IsCreated() const { return _vertexBuffer != VK_NULL_HANDLE; }
+		inline bool IsResident() const { return _resident; }
+
+		inline const VertexFormat& GetFormat() const { return _format; }
+		inline const MeshBounds& GetBounds() const { return _bounds; }
+		inline UINT32 GetVertexCount() const { return _vertexCount; }
+		inline UINT32 GetIndexCount() const { return _indexCount; }
+		inline const std::vector<MeshLod>& GetLods() const { return _lods; }
+		inline VkIndexType GetIndexType() const { return _indexType; }
+
+	public:
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;
+	};
+}
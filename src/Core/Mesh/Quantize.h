@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Common.h>
+#include <bit>
+#include <cmath>
+#include <glm/glm.hpp>
+
+// Encoders for compact vertex attributes. Each one matches a Vulkan format the
+// vertex fetch expands back to floats, so shaders read them like full floats.
+namespace VulkanEngine::Quantize
+{
+	// VK_FORMAT_R16_SNORM, [-1, 1] rounded to the nearest of 65535 steps
+	inline INT16 PackSnorm16(float value)
+	{
+		return static_cast<INT16>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	// VK_FORMAT_R16_UNORM, [0, 1] rounded to the nearest of 65536 steps
+	inline UINT16 PackUnorm16(float value)
+	{
+		return static_cast<UINT16>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	// VK_FORMAT_R16_SFLOAT, rounds to nearest even, overflow becomes infinity and tiny values flush to zero
+	inline UINT16 PackHalf(float value)
+	{
+		UINT32 bits = std::bit_cast<UINT32>(value);
+		UINT32 sign = (bits >> 16) & 0x8000;
+		UINT32 magnitude = bits & 0x7fffffff;
+
+		// NaN stays a quiet NaN, infinity and anything past the half range becomes infinity
+		if (magnitude > 0x7f800000)
+			return static_cast<UINT16>(sign | 0x7e00);
+		if (magnitude >= 0x477ff000)
+			return static_cast<UINT16>(sign | 0x7c00);
+
+		// Below the smallest normal half the value is shifted into a denormal
+		if (magnitude < 0x38800000)
+		{
+			if (magnitude < 0x33000000)
+				return static_cast<UINT16>(sign);
+
+			UINT32 mantissa = (magnitude & 0x007fffff) | 0x00800000;
+			UINT32 shift = 126 - (magnitude >> 23);
+			UINT32 half = mantissa >> shift;
+			UINT32 remainder = mantissa & ((1u << shift) - 1);
+			UINT32 midpoint = 1u << (shift - 1);
+
+			if (remainder > midpoint || (remainder == midpoint && (half & 1)))
+				half++;
+
+			return static_cast<UINT16>(sign | half);
+		}
+
+		// Rebias the exponent from 127 to 15 and round the 13 dropped mantissa bits
+		UINT32 half = (magnitude - 0x38000000) >> 13;
+		UINT32 remainder = magnitude & 0x1fff;
+
+		if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+			half++;
+
+		return static_cast<UINT16>(sign | half);
+	}
+
+	// Maps a unit vector onto the octahedron folded into the [-1, 1] square. Two 16 bit
+	// components keep the angular error far below what lighting can show.
+	inline glm::vec2 OctahedralEncode(glm::vec3 direction)
+	{
+		direction = direction / (std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z));
+
+		glm::vec2 encoded(direction.x, direction.y);
+		if (direction.z < 0.0f)
+		{
+			encoded.x = (1.0f - std::fabs(direction.y)) * (direction.x >= 0.0f ? 1.0f : -1.0f);
+			encoded.y = (1.0f - std::fabs(direction.x)) * (direction.y >= 0.0f ? 1.0f : -1.0f);
+		}
+
+		return encoded;
+	}
+
+	// Inverse of OctahedralEncode, the same math the vertex shader runs
+	inline glm::vec3 OctahedralDecode(glm::vec2 encoded)
+	{
+		glm::vec3 direction(encoded.x, encoded.y, 1.0f - std::fabs(encoded.x) - std::fabs(encoded.y));
+
+		float fold = std::max(-direction.z, 0.0f);
+		direction.x += direction.x >= 0.0f ? -fold : fold;
+		direction.y += direction.y >= 0.0f ? -fold : fold;
+
+		return glm::normalize(direction);
+	}
+}
@@ -0,0 +1,146 @@
+#include "VertexFormat.h"
+
+namespace
+{
+	struct EncodingInfo
+	{
+		VulkanEngine::VertexSemantic semantic;
+		VulkanEngine::VertexEncoding encoding;
+		VkFormat format;
+		UINT32 size;
+	};
+
+	using VulkanEngine::VertexSemantic;
+	using VulkanEngine::VertexEncoding;
+
+	// Every combination a VertexFormat accepts
+	const EncodingInfo ENCODINGS[] =
+	{
+		{ VertexSemantic::Position,	VertexEncoding::Float32,		VK_FORMAT_R32G32B32_SFLOAT,		12 },
+		{ VertexSemantic::Position,	VertexEncoding::Half,			VK_FORMAT_R16G16B16A16_SFLOAT,	8 },
+		{ VertexSemantic::Position,	VertexEncoding::Snorm16,		VK_FORMAT_R16G16B16A16_SNORM,	8 },
+		{ VertexSemantic::Normal,	VertexEncoding::Float32,		VK_FORMAT_R32G32B32_SFLOAT,		12 },
+		{ VertexSemantic::Normal,	VertexEncoding::Octahedral16,	VK_FORMAT_R16G16_SNORM,			4 },
+		{ VertexSemantic::Tangent,	VertexEncoding::Float32,		VK_FORMAT_R32G32B32A32_SFLOAT,	16 },
+		{ VertexSemantic::Tangent,	VertexEncoding::Octahedral16,	VK_FORMAT_R16G16_SNORM,			4 },
+		{ VertexSemantic::TexCoord,	VertexEncoding::Float32,		VK_FORMAT_R32G32_SFLOAT,		8 },
+		{ VertexSemantic::TexCoord,	VertexEncoding::Half,			VK_FORMAT_R16G16_SFLOAT,		4 },
+		{ VertexSemantic::TexCoord,	VertexEncoding::Unorm16,		VK_FORMAT_R16G16_UNORM,			4 },
+	};
+
+	// Only the four component position encodings have a w to hold the bitangent sign
+	bool HasSignComponent(VertexEncoding positionEncoding)
+	{
+		return positionEncoding == VertexEncoding::Half || positionEncoding == VertexEncoding::Snorm16;
+	}
+}
+
+bool VulkanEngine::VertexFormat::Add(VertexSemantic semantic, VertexEncoding encoding)
+{
+	if (Find(semantic) != nullptr)
+	{
+		fprintf(stderr, "Vertex format already has semantic %u\n", static_cast<UINT32>(semantic));
+		return false;
+	}
+
+	const VertexElement* position = semantic == VertexSemantic::Tangent ? Find(VertexSemantic::Position) : nullptr;
+	const VertexElement* tangent = semantic == VertexSemantic::Position ? Find(VertexSemantic::Tangent) : nullptr;
+	bool octahedralTangent = (semantic == VertexSemantic::Tangent && encoding == VertexEncoding::Octahedral16) || (tangent != nullptr && tangent->encoding == VertexEncoding::Octahedral16);
+	VertexEncoding positionEncoding = semantic == VertexSemantic::Position ? encoding : position != nullptr ? position->encoding : VertexEncoding::Half;
+	if (octahedralTangent && !HasSignComponent(positionEncoding))
+	{
+		fprintf(stderr, "Octahedral tangents need a Half or Snorm16 position to store the bitangent sign\n");
+		return false;
+	}
+
+	for (const EncodingInfo& info : ENCODINGS)
+	{
+		if (info.semantic != semantic || info.encoding != encoding)
+			continue;
+
+		_elements.push_back(VertexElement{ semantic, encoding, info.format, _stride, info.size });
+		_stride += info.size;
+		return true;
+	}
+
+	fprintf(stderr, "Vertex encoding %u is not supported for semantic %u\n", static_cast<UINT32>(encoding), static_cast<UINT32>(semantic));
+	return false;
+}
+
+bool VulkanEngine::VertexFormat::Validate() const
+{
+	const VertexElement* position = Find(VertexSemantic::Position);
+	if (position == nullptr)
+	{
+		fprintf(stderr, "Vertex format has no position\n");
+		return false;
+	}
+
+	if (GetEncoding(VertexSemantic::Tangent) == VertexEncoding::Octahedral16 && !HasSignComponent(position->encoding))
+	{
+		fprintf(stderr, "Octahedral tangents need a Half or Snorm16 position to store the bitangent sign\n");
+		return false;
+	}
+
+	return true;
+}
+
+const VulkanEngine::VertexElement* VulkanEngine::VertexFormat::Find(VertexSemantic semantic) const
+{
+	for (const VertexElement& element : _elements)
+	{
+		if (element.semantic == semantic)
+			return &element;
+	}
+
+	return nullptr;
+}
+
+VulkanEngine::VertexEncoding VulkanEngine::VertexFormat::GetEncoding(VertexSemantic semantic) const
+{
+	const VertexElement* element = Find(semantic);
+	return element != nullptr ? element->encoding : VertexEncoding::Float32;
+}
+
+VulkanEngine::VertexLayout VulkanEngine::VertexFormat::GetLayout(UINT32 binding) const
+{
+	VertexLayout layout;
+
+	VkVertexInputBindingDescription bindingDescription{};
+	bindingDescription.binding = binding;
+	bindingDescription.stride = _stride;
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	layout.bindings.push_back(bindingDescription);
+
+	for (const VertexElement& element : _elements)
+	{
+		VkVertexInputAttributeDescription attribute{};
+		attribute.location = static_cast<UINT32>(element.semantic);
+		attribute.binding = binding;
+		attribute.format = element.format;
+		attribute.offset = element.offset;
+		layout.attributes.push_back(attribute);
+	}
+
+	return layout;
+}
+
+VulkanEngine::VertexFormat VulkanEngine::VertexFormat::Standard()
+{
+	VertexFormat format;
+	format.Add(VertexSemantic::Position, VertexEncoding::Float32);
+	format.Add(VertexSemantic::Normal, VertexEncoding::Float32);
+	format.Add(VertexSemantic::Tangent, VertexEncoding::Float32);
+	format.Add(VertexSemantic::TexCoord, VertexEncoding::Float32);
+	return format;
+}
+
+VulkanEngine::VertexFormat VulkanEngine::VertexFormat::Quantized()
+{
+	VertexFormat format;
+	format.Add(VertexSemantic::Position, VertexEncoding::Snorm16);
+	format.Add(VertexSemantic::Normal, VertexEncoding::Octahedral16);
+	format.Add(VertexSemantic::Tangent, VertexEncoding::Octahedral16);
+	format.Add(VertexSemantic::TexCoord, VertexEncoding::Half);
+	return format;
+}
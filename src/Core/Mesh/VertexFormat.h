@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Common.h>
+#include <Pipeline/PipelineDesc.h>
+
+namespace VulkanEngine
+{
+	// The shader input location of an attribute is its semantic
+	enum class VertexSemantic : UINT8
+	{
+		Position,
+		Normal,
+		Tangent,
+		TexCoord,
+		Count
+	};
+
+	enum class VertexEncoding : UINT8
+	{
+		Float32,
+		Half,			// 16 bit floats
+		Snorm16,		// Positions only, relative to the mesh bounds
+		Unorm16,		// Texture coordinates in [0, 1] only
+		Octahedral16	// Unit directions as two 16 bit snorm components
+	};
+
+	struct VertexElement
+	{
+		VertexSemantic semantic;
+		VertexEncoding encoding;
+		VkFormat format;
+		UINT32 offset;
+		UINT32 size;
+	};
+
+	// Interleaved layout of one vertex buffer. Compact encodings decode in the
+	// vertex fetch, except positions and directions that need the mesh bounds
+	// or the octahedral unfold, which the vertex shader applies.
+	// A quantized tangent keeps its bitangent sign in the position's w component,
+	// so it needs a Half or Snorm16 position.
+	class VertexFormat
+	{
+	private:
+		std::vector<VertexElement> _elements;
+		UINT32 _stride = 0;
+
+	public:
+		VertexFormat() = default;
+
+		// Fails on an encoding the semantic can't use, elements are laid out in the order added
+		bool Add(VertexSemantic semantic, VertexEncoding encoding);
+
+		// Checks what Add can't while the format is incomplete: a position exists, and an
+		// octahedral tangent has a position with a w for its sign
+		bool Validate() const;
+
+		inline const std::vector<VertexElement>& GetElements() const { return _elements; }
+		inline UINT32 GetStride() const { return _stride; }
+
+		const VertexElement* Find(VertexSemantic semantic) const;
+
+		// Float32 for a semantic the format doesn't have. Snorm16 positions and Octahedral16
+		// directions are the encodings the vertex shader has to decode, one flag each
+		VertexEncoding GetEncoding(VertexSemantic semantic) const;
+
+		VertexLayout GetLayout(UINT32 binding = 0) const;
+
+		// 48 bytes: float3 position, float3 normal, float4 tangent, float2 uv
+		static VertexFormat Standard();
+
+		// 20 bytes: snorm16x4 position, octahedral normal and tangent, half2 uv
+		static VertexFormat Quantized();
+	};
+}
@@ -0,0 +1,298 @@
+#include "LayoutCache.h"
+#include <cstring>
+
+namespace
+{
+	// Every sampler create info field from flags on is 4 bytes wide, so the range compares and hashes without padding
+	const char* GetSamplerFieldsBegin(const VkSamplerCreateInfo& createInfo)
+	{
+		return reinterpret_cast<const char*>(&createInfo.flags);
+	}
+
+	size_t GetSamplerFieldsSize(const VkSamplerCreateInfo& createInfo)
+	{
+		return reinterpret_cast<const char*>(&createInfo.unnormalizedCoordinates + 1) - GetSamplerFieldsBegin(createInfo);
+	}
+}
+
+bool VulkanEngine::LayoutCache::Init(VkDevice device)
+{
+	_device = device;
+
+	fprintf(stdout, "Created Layout Cache\n");
+	return true;
+}
+
+void VulkanEngine::LayoutCache::Shutdown()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (auto& [key, layout] : _pipelineLayouts)
+		vkDestroyPipelineLayout(_device, layout, nullptr);
+
+	for (auto& [key, layout] : _setLayouts)
+		vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+
+	for (auto& [key, sampler] : _samplers)
+		vkDestroySampler(_device, sampler, nullptr);
+
+	_pipelineLayouts.clear();
+	_setLayouts.clear();
+	_samplers.clear();
+}
+
+VkDescriptorSetLayout VulkanEngine::LayoutCache::GetSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings)
+{
+	std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+		{
+			return a.binding < b.binding;
+		});
+
+	SetLayoutKey key;
+	for (const VkDescriptorSetLayoutBinding& binding : bindings)
+	{
+		SetLayoutKey::Binding& keyBinding = key.bindings.emplace_back();
+		keyBinding.binding = binding.binding;
+		keyBinding.type = binding.descriptorType;
+		keyBinding.count = binding.descriptorCount;
+		keyBinding.stages = binding.stageFlags;
+
+		// Immutable samplers are part of the layout, the cached handles identify them
+		if (binding.pImmutableSamplers != nullptr)
+			keyBinding.immutableSamplers.assign(binding.pImmutableSamplers, binding.pImmutableSamplers + binding.descriptorCount);
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto cached = _setLayouts.find(key);
+	if (cached != _setLayouts.end())
+	{
+		_stats.hits++;
+		return cached->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	createInfo.bindingCount = static_cast<UINT32>(bindings.size());
+	createInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(_device, &createInfo, nullptr, &layout) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create Descriptor Set Layout\n");
+		return VK_NULL_HANDLE;
+	}
+
+	_stats.setLayouts++;
+	_setLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+VkPipelineLayout VulkanEngine::LayoutCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants)
+{
+	PipelineLayoutKey key{ setLayouts, pushConstants };
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto cached = _pipelineLayouts.find(key);
+	if (cached != _pipelineLayouts.end())
+	{
+		_stats.hits++;
+		return cached->second;
+	}
+
+	VkPipelineLayoutCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	createInfo.setLayoutCount = static_cast<UINT32>(setLayouts.size());
+	createInfo.pSetLayouts = setLayouts.data();
+	createInfo.pushConstantRangeCount = static_cast<UINT32>(pushConstants.size());
+	createInfo.pPushConstantRanges = pushConstants.data();
+
+	VkPipelineLayout layout;
+	if (vkCreatePipelineLayout(_device, &createInfo, nullptr, &layout) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create Pipeline Layout\n");
+		return VK_NULL_HANDLE;
+	}
+
+	_stats.pipelineLayouts++;
+	_pipelineLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+VkSampler VulkanEngine::LayoutCache::GetSampler(const VkSamplerCreateInfo& createInfo)
+{
+	SamplerKey key;
+	key.createInfo = createInfo;
+	key.createInfo.pNext = nullptr;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto cached = _samplers.find(key);
+	if (cached != _samplers.end())
+	{
+		_stats.hits++;
+		return cached->second;
+	}
+
+	VkSampler sampler;
+	if (vkCreateSampler(_device, &createInfo, nullptr, &sampler) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create Sampler\n");
+		return VK_NULL_HANDLE;
+	}
+
+	_stats.samplers++;
+	_samplers.emplace(key, sampler);
+	return sampler;
+}
+
+VkPipelineLayout VulkanEngine::LayoutCache::GetPipelineLayout(const std::vector<SPTR<Shader>>& shaders)
+{
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	VkPushConstantRange pushConstants{};
+
+	if (!GetShaderLayouts(shaders, setLayouts, pushConstants))
+		return VK_NULL_HANDLE;
+
+	std::vector<VkPushConstantRange> ranges;
+	if (pushConstants.size > 0)
+		ranges.push_back(pushConstants);
+
+	return GetPipelineLayout(setLayouts, ranges);
+}
+
+bool VulkanEngine::LayoutCache::GetSetLayouts(const std::vector<SPTR<Shader>>& shaders, std::vector<VkDescriptorSetLayout>& setLayouts)
+{
+	VkPushConstantRange pushConstants{};
+	return GetShaderLayouts(shaders, setLayouts, pushConstants);
+}
+
+bool VulkanEngine::LayoutCache::GetShaderLayouts(const std::vector<SPTR<Shader>>& shaders, std::vector<VkDescriptorSetLayout>& setLayouts, VkPushConstantRange& pushConstants)
+{
+	std::map<UINT32, std::vector<VkDescriptorSetLayoutBinding>> sets;
+	pushConstants = VkPushConstantRange{};
+
+	for (const SPTR<Shader>& shader : shaders)
+	{
+		const ShaderReflection& reflection = shader->GetReflection();
+
+		for (const ReflectedBinding& reflected : reflection.GetBindings())
+		{
+			std::vector<VkDescriptorSetLayoutBinding>& bindings = sets[reflected.set];
+
+			auto binding = std::find_if(bindings.begin(), bindings.end(),
+				[&reflected](const VkDescriptorSetLayoutBinding& binding) { return binding.binding == reflected.binding; });
+
+			if (binding == bindings.end())
+			{
+				VkDescriptorSetLayoutBinding created{};
+				created.binding = reflected.binding;
+				created.descriptorType = reflected.type;
+				created.descriptorCount = reflected.count;
+				created.stageFlags = reflection.GetStage();
+				bindings.push_back(created);
+				continue;
+			}
+
+			if (binding->descriptorType != reflected.type)
+			{
+				fprintf(stderr, "Shader '%s' declares set %u binding %u with a different descriptor type\n",
+					shader->GetName().c_str(), reflected.set, reflected.binding);
+				return false;
+			}
+
+			binding->descriptorCount = std::max(binding->descriptorCount, reflected.count);
+			binding->stageFlags |= reflection.GetStage();
+		}
+
+		if (reflection.GetPushConstantSize() > 0)
+		{
+			pushConstants.size = std::max(pushConstants.size, reflection.GetPushConstantSize());
+			pushConstants.stageFlags |= reflection.GetStage();
+		}
+	}
+
+	// Set numbers index the layout array, unused sets in between still need a layout
+	setLayouts.clear();
+	if (!sets.empty())
+		setLayouts.resize(sets.rbegin()->first + 1, VK_NULL_HANDLE);
+
+	for (UINT32 set = 0; set < setLayouts.size(); set++)
+	{
+		auto bindings = sets.find(set);
+		setLayouts[set] = GetSetLayout(bindings != sets.end() ? bindings->second : std::vector<VkDescriptorSetLayoutBinding>{});
+
+		if (setLayouts[set] == VK_NULL_HANDLE)
+			return false;
+	}
+
+	return true;
+}
+
+UINT64 VulkanEngine::LayoutCache::SetLayoutKey::GetHash() const
+{
+	UINT64 hash = HashValue(bindings.size());
+	for (const Binding& binding : bindings)
+	{
+		hash = HashCombine(hash, HashValue(binding.binding));
+		hash = HashCombine(hash, HashValue(binding.type));
+		hash = HashCombine(hash, HashValue(binding.count));
+		hash = HashCombine(hash, HashValue(binding.stages));
+		hash = HashCombine(hash, HashBytes(binding.immutableSamplers.data(), binding.immutableSamplers.size() * sizeof(VkSampler)));
+	}
+
+	return hash;
+}
+
+bool VulkanEngine::LayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const
+{
+	auto sameRange = [](const VkPushConstantRange& a, const VkPushConstantRange& b)
+		{
+			return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+		};
+
+	return setLayouts == other.setLayouts &&
+		std::equal(pushConstants.begin(), pushConstants.end(), other.pushConstants.begin(), other.pushConstants.end(), sameRange);
+}
+
+UINT64 VulkanEngine::LayoutCache::PipelineLayoutKey::GetHash() const
+{
+	// Set layouts are cached too, so their handles identify their contents
+	UINT64 hash = HashBytes(setLayouts.data(), setLayouts.size() * sizeof(VkDescriptorSetLayout), HashValue(setLayouts.size()));
+	for (const VkPushConstantRange& range : pushConstants)
+	{
+		hash = HashCombine(hash, HashValue(range.stageFlags));
+		hash = HashCombine(hash, HashValue(range.offset));
+		hash = HashCombine(hash, HashValue(range.size));
+	}
+
+	return hash;
+}
+
+bool VulkanEngine::LayoutCache::SamplerKey::operator==(const SamplerKey& other) const
+{
+	return memcmp(GetSamplerFieldsBegin(createInfo), GetSamplerFieldsBegin(other.createInfo), GetSamplerFieldsSize(createInfo)) == 0;
+}
+
+UINT64 VulkanEngine::LayoutCache::SamplerKey::GetHash() const
+{
+	return HashBytes(GetSamplerFieldsBegin(createInfo), GetSamplerFieldsSize(createInfo));
+}
+
+VulkanEngine::LayoutCache::Stats VulkanEngine::LayoutCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _stats;
+}
+
+void VulkanEngine::LayoutCache::PrintStats()
+{
+	Stats stats = GetStats();
+
+	fprintf(stdout, "Layout Cache : %llu set layouts, %llu pipeline layouts, %llu samplers, %llu hits\n",
+		static_cast<unsigned long long>(stats.setLayouts),
+		static_cast<unsigned long long>(stats.pipelineLayouts),
+		static_cast<unsigned long long>(stats.samplers),
+		static_cast<unsigned long long>(stats.hits));
+}
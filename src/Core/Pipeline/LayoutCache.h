@@ -0,0 +1,114 @@
+#pragma once
+
+#include <Common.h>
+#include <mutex>
+#include <unordered_map>
+#include <Shader/Shader.h>
+
+namespace VulkanEngine
+{
+	// Deduplicates descriptor set layouts, pipeline layouts and samplers by their
+	// create infos. Pipelines whose shaders declare the same interface end up
+	// with the same VkPipelineLayout, so binding one after another keeps the bound
+	// descriptor sets and push constants valid. Everything lives until Shutdown.
+	class LayoutCache
+	{
+	public:
+		struct Stats
+		{
+			UINT64 setLayouts = 0;
+			UINT64 pipelineLayouts = 0;
+			UINT64 samplers = 0;
+			UINT64 hits = 0;			// Requests served by an existing object
+		};
+
+	private:
+		// Full descriptions are kept as keys and compared on a hit, so a hash collision never hands out the wrong object
+		struct SetLayoutKey
+		{
+			struct Binding
+			{
+				UINT32 binding = 0;
+				VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+				UINT32 count = 0;
+				VkShaderStageFlags stages = 0;
+				std::vector<VkSampler> immutableSamplers;
+
+				bool operator==(const Binding& other) const = default;
+			};
+
+			std::vector<Binding> bindings;		// Sorted by binding
+
+			bool operator==(const SetLayoutKey& other) const = default;
+			UINT64 GetHash() const;
+
+			struct Hasher
+			{
+				inline size_t operator()(const SetLayoutKey& key) const { return static_cast<size_t>(key.GetHash()); }
+			};
+		};
+
+		struct PipelineLayoutKey
+		{
+			std::vector<VkDescriptorSetLayout> setLayouts;
+			std::vector<VkPushConstantRange> pushConstants;
+
+			bool operator==(const PipelineLayoutKey& other) const;
+			UINT64 GetHash() const;
+
+			struct Hasher
+			{
+				inline size_t operator()(const PipelineLayoutKey& key) const { return static_cast<size_t>(key.GetHash()); }
+			};
+		};
+
+		struct SamplerKey
+		{
+			VkSamplerCreateInfo createInfo{};	// pNext is not followed
+
+			bool operator==(const SamplerKey& other) const;
+			UINT64 GetHash() const;
+
+			struct Hasher
+			{
+				inline size_t operator()(const SamplerKey& key) const { return static_cast<size_t>(key.GetHash()); }
+			};
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+
+		std::mutex _mutex;
+		std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, SetLayoutKey::Hasher> _setLayouts;
+		std::unordered_map<PipelineLayoutKey, VkPipelineLayout, PipelineLayoutKey::Hasher> _pipelineLayouts;
+		std::unordered_map<SamplerKey, VkSampler, SamplerKey::Hasher> _samplers;
+
+		Stats _stats;
+
+		bool GetShaderLayouts(const std::vector<SPTR<Shader>>& shaders, std::vector<VkDescriptorSetLayout>& setLayouts, VkPushConstantRange& pushConstants);
+
+	public:
+		LayoutCache() = default;
+
+		bool Init(VkDevice device);
+		void Shutdown();
+
+		// Bindings may come in any order, they are sorted by binding number
+		VkDescriptorSetLayout GetSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+		VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants);
+		VkSampler GetSampler(const VkSamplerCreateInfo& createInfo);
+
+		// Merges the reflected interfaces of every stage, sets a shader skips get an empty layout.
+		// Push constants become one range visible to every stage that declares a block
+		VkPipelineLayout GetPipelineLayout(const std::vector<SPTR<Shader>>& shaders);
+
+		// The set layouts GetPipelineLayout builds from the shaders, indexed by set number, for allocating descriptor sets
+		bool GetSetLayouts(const std::vector<SPTR<Shader>>& shaders, std::vector<VkDescriptorSetLayout>& setLayouts);
+
+		Stats GetStats();
+		void PrintStats();
+
+	public:
+		LayoutCache(const LayoutCache&) = delete;
+		LayoutCache& operator=(const LayoutCache&) = delete;
+	};
+}
@@ -0,0 +1,152 @@
+#include "PipelineCache.h"
+#include <filesystem>
+#include <fstream>
+
+bool VulkanEngine::PipelineCache::Init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path)
+{
+	_device = device;
+	_path = path;
+	vkGetPhysicalDeviceProperties(physicalDevice, &_deviceProperties);
+
+	MappedFile data;
+	_isWarm = !_path.empty() && std::filesystem::exists(_path) && data.Open(_path, FileAccess::WillNeed) && IsCompatible(data);
+
+	if (!_isWarm)
+		data.Close();
+
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = data.GetSize();
+	createInfo.pInitialData = data.GetSize() == 0 ? nullptr : data.GetData();
+
+	if (vkCreatePipelineCache(_device, &createInfo, nullptr, &_cache) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create Pipeline Cache\n");
+		return false;
+	}
+
+	LoadMetrics();
+
+	fprintf(stdout, "Created %s Pipeline Cache (%zu bytes loaded)\n", _isWarm ? "warm" : "cold", data.GetSize());
+	return true;
+}
+
+void VulkanEngine::PipelineCache::Shutdown()
+{
+	if (_cache == VK_NULL_HANDLE)
+		return;
+
+	if (!_path.empty() && Save())
+		SaveMetrics();
+
+	vkDestroyPipelineCache(_device, _cache, nullptr);
+	_cache = VK_NULL_HANDLE;
+}
+
+bool VulkanEngine::PipelineCache::IsCompatible(const MappedFile& data) const
+{
+	VkPipelineCacheHeaderVersionOne header{};
+	if (data.GetSize() < sizeof(header))
+	{
+		fprintf(stderr, "Pipeline Cache %s is truncated, starting cold\n", _path.c_str());
+		return false;
+	}
+
+	memcpy(&header, data.GetData(), sizeof(header));
+
+	// Data from another driver, device or driver version is rejected by some
+	// implementations and silently ignored by others, so check it ourselves
+	if (header.headerSize < sizeof(header)
+		|| header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		|| header.vendorID != _deviceProperties.vendorID
+		|| header.deviceID != _deviceProperties.deviceID
+		|| memcmp(header.pipelineCacheUUID, _deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		fprintf(stderr, "Pipeline Cache %s does not match current device, starting cold\n", _path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool VulkanEngine::PipelineCache::Save() const
+{
+	size_t size = 0;
+	if (vkGetPipelineCacheData(_device, _cache, &size, nullptr) != VK_SUCCESS)
+		return false;
+
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(_device, _cache, &size, data.data()) != VK_SUCCESS)
+		return false;
+
+	std::filesystem::path path(_path);
+	std::filesystem::path tempPath(GetTemporaryPath(_path));
+
+	std::error_code error;
+	if (path.has_parent_path())
+		std::filesystem::create_directories(path.parent_path(), error);
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), size);
+
+		if (!file)
+		{
+			fprintf(stderr, "Failed to write Pipeline Cache to %s\n", tempPath.string().c_str());
+			file.close();
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	// Rename replaces the old cache in one step, a crash mid write never leaves a torn file behind
+	std::filesystem::rename(tempPath, path, error);
+	if (error)
+	{
+		fprintf(stderr, "Failed to replace Pipeline Cache %s : %s\n", _path.c_str(), error.message().c_str());
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	fprintf(stdout, "Saved Pipeline Cache to %s (%zu bytes)\n", _path.c_str(), size);
+	return true;
+}
+
+void VulkanEngine::PipelineCache::LoadMetrics()
+{
+	if (_path.empty())
+		return;
+
+	std::ifstream file(_path + ".meta");
+	std::string key;
+	double value;
+	while (file >> key >> value)
+	{
+		if (key == "cold_creation_ms")
+			_coldCreationTime = value;
+	}
+}
+
+void VulkanEngine::PipelineCache::SaveMetrics() const
+{
+	// Only a cold run gives the baseline that warm runs are measured against
+	if (_isWarm)
+		return;
+
+	std::ofstream file(_path + ".meta", std::ios::trunc);
+	file << "cold_creation_ms " << _creationTime.load() << "\n";
+}
+
+void VulkanEngine::PipelineCache::PrintStartupMetrics() const
+{
+	if (!_isWarm || _coldCreationTime <= 0)
+	{
+		fprintf(stdout, "Pipeline creation took %.3f ms (%s start)\n", _creationTime.load(), _isWarm ? "warm" : "cold");
+		return;
+	}
+
+	fprintf(stdout, "Pipeline creation took %.3f ms (warm start), cold start took %.3f ms, saved %.3f ms\n",
+		_creationTime.load(),
+		_coldCreationTime,
+		_coldCreationTime - _creationTime.load());
+}
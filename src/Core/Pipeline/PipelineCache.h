@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Common.h>
+#include <atomic>
+
+namespace VulkanEngine
+{
+	// Driver pipeline cache persisted to disk between runs. Loaded data is only
+	// used when its header matches the current device, and the cache is written
+	// back atomically on shutdown. Time spent creating pipelines is tracked so
+	// warm starts can be compared against the last cold start.
+	class PipelineCache
+	{
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		VkPipelineCache _cache = VK_NULL_HANDLE;
+
+		std::string _path;
+		VkPhysicalDeviceProperties _deviceProperties{};
+
+		bool _isWarm = false;
+		std::atomic<double> _creationTime = 0;	// ms spent creating pipelines this run, summed over compile threads
+		double _coldCreationTime = 0;	// ms spent by the last cold run, 0 if unknown
+
+		bool IsCompatible(const MappedFile& data) const;
+
+		void LoadMetrics();
+		void SaveMetrics() const;
+
+	public:
+		PipelineCache() = default;
+
+		bool Init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path);
+		void Shutdown();
+
+		bool Save() const;
+
+		inline VkPipelineCache GetHandle() const { return _cache; }
+		inline bool IsWarm() const { return _isWarm; }
+
+		inline void AddCreationTime(double milliseconds) { _creationTime.fetch_add(milliseconds, std::memory_order_relaxed); }
+
+		void PrintStartupMetrics() const;
+
+	public:
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator=(const PipelineCache&) = delete;
+	};
+}
@@ -0,0 +1,364 @@
+#include "PipelineCompiler.h"
+#include <chrono>
+
+VkPipeline VulkanEngine::CompiledPipeline::Resolve() const
+{
+	for (const CompiledPipeline* pipeline = this; pipeline != nullptr; pipeline = pipeline->_fallback.get())
+		if (pipeline->IsReady())
+			return pipeline->_pipeline;
+
+	return VK_NULL_HANDLE;
+}
+
+#pragma region Request
+
+void VulkanEngine::PipelineCompiler::Request::CopyStages(const VkPipelineShaderStageCreateInfo* source, UINT32 count)
+{
+	stages.assign(source, source + count);
+	entryPoints.resize(count);
+	specializations.resize(count);
+	mapEntries.resize(count);
+	specializationData.resize(count);
+
+	// Every vector is sized before any pointer into it is taken
+	for (UINT32 i = 0; i < count; i++)
+	{
+		VkPipelineShaderStageCreateInfo& stage = stages[i];
+		stage.pNext = nullptr;
+
+		entryPoints[i] = stage.pName != nullptr ? stage.pName : "main";
+		stage.pName = entryPoints[i].c_str();
+
+		if (stage.pSpecializationInfo == nullptr)
+			continue;
+
+		const VkSpecializationInfo& specialization = *stage.pSpecializationInfo;
+		mapEntries[i].assign(specialization.pMapEntries, specialization.pMapEntries + specialization.mapEntryCount);
+
+		const char* data = static_cast<const char*>(specialization.pData);
+		specializationData[i].assign(data, data + specialization.dataSize);
+
+		specializations[i] = specialization;
+		specializations[i].pMapEntries = mapEntries[i].data();
+		specializations[i].pData = specializationData[i].data();
+		stage.pSpecializationInfo = &specializations[i];
+	}
+}
+
+void VulkanEngine::PipelineCompiler::Request::CopyGraphics(const VkGraphicsPipelineCreateInfo& source)
+{
+	graphicsInfo = source;
+
+	// Extension chains can't be copied generically, they are dropped
+	graphicsInfo.pNext = nullptr;
+
+	CopyStages(source.pStages, source.stageCount);
+	graphicsInfo.pStages = stages.data();
+
+	if (source.pVertexInputState != nullptr)
+	{
+		vertexInput = *source.pVertexInputState;
+		vertexInput.pNext = nullptr;
+
+		vertexBindings.assign(vertexInput.pVertexBindingDescriptions, vertexInput.pVertexBindingDescriptions + vertexInput.vertexBindingDescriptionCount);
+		vertexAttributes.assign(vertexInput.pVertexAttributeDescriptions, vertexInput.pVertexAttributeDescriptions + vertexInput.vertexAttributeDescriptionCount);
+		vertexInput.pVertexBindingDescriptions = vertexBindings.data();
+		vertexInput.pVertexAttributeDescriptions = vertexAttributes.data();
+
+		graphicsInfo.pVertexInputState = &vertexInput;
+	}
+
+	if (source.pInputAssemblyState != nullptr)
+	{
+		inputAssembly = *source.pInputAssemblyState;
+		inputAssembly.pNext = nullptr;
+		graphicsInfo.pInputAssemblyState = &inputAssembly;
+	}
+
+	if (source.pTessellationState != nullptr)
+	{
+		tessellation = *source.pTessellationState;
+		tessellation.pNext = nullptr;
+		graphicsInfo.pTessellationState = &tessellation;
+	}
+
+	if (source.pViewportState != nullptr)
+	{
+		viewport = *source.pViewportState;
+		viewport.pNext = nullptr;
+
+		// Dynamic viewports and scissors leave the arrays null while still giving a count
+		if (viewport.pViewports != nullptr)
+		{
+			viewports.assign(viewport.pViewports, viewport.pViewports + viewport.viewportCount);
+			viewport.pViewports = viewports.data();
+		}
+
+		if (viewport.pScissors != nullptr)
+		{
+			scissors.assign(viewport.pScissors, viewport.pScissors + viewport.scissorCount);
+			viewport.pScissors = scissors.data();
+		}
+
+		graphicsInfo.pViewportState = &viewport;
+	}
+
+	if (source.pRasterizationState != nullptr)
+	{
+		rasterization = *source.pRasterizationState;
+		rasterization.pNext = nullptr;
+		graphicsInfo.pRasterizationState = &rasterization;
+	}
+
+	if (source.pMultisampleState != nullptr)
+	{
+		multisample = *source.pMultisampleState;
+		multisample.pNext = nullptr;
+
+		if (multisample.pSampleMask != nullptr)
+		{
+			// One 32 bit word per 32 samples
+			size_t words = (static_cast<size_t>(multisample.rasterizationSamples) + 31) / 32;
+			sampleMask.assign(multisample.pSampleMask, multisample.pSampleMask + words);
+			multisample.pSampleMask = sampleMask.data();
+		}
+
+		graphicsInfo.pMultisampleState = &multisample;
+	}
+
+	if (source.pDepthStencilState != nullptr)
+	{
+		depthStencil = *source.pDepthStencilState;
+		depthStencil.pNext = nullptr;
+		graphicsInfo.pDepthStencilState = &depthStencil;
+	}
+
+	if (source.pColorBlendState != nullptr)
+	{
+		colorBlend = *source.pColorBlendState;
+		colorBlend.pNext = nullptr;
+
+		blendAttachments.assign(colorBlend.pAttachments, colorBlend.pAttachments + colorBlend.attachmentCount);
+		colorBlend.pAttachments = blendAttachments.data();
+
+		graphicsInfo.pColorBlendState = &colorBlend;
+	}
+
+	if (source.pDynamicState != nullptr)
+	{
+		dynamic = *source.pDynamicState;
+		dynamic.pNext = nullptr;
+
+		dynamicStates.assign(dynamic.pDynamicStates, dynamic.pDynamicStates + dynamic.dynamicStateCount);
+		dynamic.pDynamicStates = dynamicStates.data();
+
+		graphicsInfo.pDynamicState = &dynamic;
+	}
+}
+
+void VulkanEngine::PipelineCompiler::Request::CopyCompute(const VkComputePipelineCreateInfo& source)
+{
+	computeInfo = source;
+	computeInfo.pNext = nullptr;
+
+	CopyStages(&source.stage, 1);
+	computeInfo.stage = stages[0];
+}
+
+#pragma endregion
+
+bool VulkanEngine::PipelineCompiler::Init(VkDevice device, PipelineCache& cache, JobSystem& jobs, UINT32 maxConcurrent)
+{
+	_device = device;
+	_cache = &cache;
+	_jobs = &jobs;
+	_maxConcurrent = std::max(maxConcurrent, 1u);
+
+	fprintf(stdout, "Created Pipeline Compiler running up to %d compiles at once\n", _maxConcurrent);
+	return true;
+}
+
+void VulkanEngine::PipelineCompiler::Shutdown()
+{
+	if (_jobs == nullptr)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (const SPTR<Request>& request : _queue)
+			request->handle->_status.store(PipelineStatus::Failed, std::memory_order_release);
+		_queue.clear();
+	}
+
+	_jobs->Wait(_compileJobs);
+
+	for (const PipelineHandle& pipeline : _pipelines)
+	{
+		if (pipeline->_pipeline != VK_NULL_HANDLE)
+			vkDestroyPipeline(_device, pipeline->_pipeline, nullptr);
+
+		// Handles still held elsewhere must not hand out the destroyed pipeline
+		pipeline->_pipeline = VK_NULL_HANDLE;
+		pipeline->_status.store(PipelineStatus::Failed, std::memory_order_release);
+	}
+
+	_pipelines.clear();
+	_jobs = nullptr;
+}
+
+VulkanEngine::PipelineHandle VulkanEngine::PipelineCompiler::CompileGraphics(const VkGraphicsPipelineCreateInfo& createInfo, const std::string& name, PipelineHandle fallback)
+{
+	SPTR<Request> request = MAKE_SPTR<Request>();
+	request->handle = MAKE_SPTR<CompiledPipeline>(name, VK_PIPELINE_BIND_POINT_GRAPHICS, createInfo.layout, std::move(fallback));
+	request->CopyGraphics(createInfo);
+
+	return Enqueue(std::move(request));
+}
+
+VulkanEngine::PipelineHandle VulkanEngine::PipelineCompiler::CompileCompute(const VkComputePipelineCreateInfo& createInfo, const std::string& name, PipelineHandle fallback)
+{
+	SPTR<Request> request = MAKE_SPTR<Request>();
+	request->handle = MAKE_SPTR<CompiledPipeline>(name, VK_PIPELINE_BIND_POINT_COMPUTE, createInfo.layout, std::move(fallback));
+	request->CopyCompute(createInfo);
+
+	return Enqueue(std::move(request));
+}
+
+bool VulkanEngine::PipelineCompiler::Wait(const PipelineHandle& pipeline)
+{
+	while (pipeline->GetStatus() == PipelineStatus::Pending)
+		if (!_jobs->RunOne())
+			std::this_thread::yield();
+
+	return pipeline->IsReady();
+}
+
+void VulkanEngine::PipelineCompiler::Retire(const PipelineHandle& pipeline, DeletionQueue& deletionQueue, UINT64 frameValue)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::erase(_pipelines, pipeline);
+
+	if (pipeline->GetStatus() == PipelineStatus::Pending)
+	{
+		pipeline->_discarded = true;
+		return;
+	}
+
+	// Handles falling back on this one skip it from now on, the queued destruction can't reach them through Resolve
+	VkPipeline handle = pipeline->_pipeline;
+	pipeline->_discarded = true;
+	pipeline->_status.store(PipelineStatus::Failed, std::memory_order_release);
+	pipeline->_pipeline = VK_NULL_HANDLE;
+
+	if (handle == VK_NULL_HANDLE)
+		return;
+
+	VkDevice device = _device;
+	deletionQueue.Push(frameValue, [device, handle] { vkDestroyPipeline(device, handle, nullptr); });
+}
+
+void VulkanEngine::PipelineCompiler::Replace(PipelineHandle& current, PipelineHandle next, DeletionQueue& deletionQueue, UINT64 frameValue)
+{
+	PipelineHandle previous = std::move(current);
+	current = std::move(next);
+
+	// The replacement no longer needs to fall back on what it replaces, let it go
+	if (current->_fallback == previous)
+		current->_fallback = nullptr;
+
+	if (previous != nullptr)
+		Retire(previous, deletionQueue, frameValue);
+}
+
+size_t VulkanEngine::PipelineCompiler::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _queue.size() + _running;
+}
+
+VulkanEngine::PipelineHandle VulkanEngine::PipelineCompiler::Enqueue(SPTR<Request> request)
+{
+	PipelineHandle handle = request->handle;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pipelines.push_back(handle);
+	_queue.push_back(std::move(request));
+	DispatchLocked();
+
+	return handle;
+}
+
+void VulkanEngine::PipelineCompiler::DispatchLocked()
+{
+	while (_running < _maxConcurrent && !_queue.empty())
+	{
+		SPTR<Request> request = std::move(_queue.front());
+		_queue.pop_front();
+		_running++;
+
+		_jobs->Run([this, request] { Compile(request); }, &_compileJobs);
+	}
+}
+
+void VulkanEngine::PipelineCompiler::Compile(const SPTR<Request>& request)
+{
+	CompiledPipeline& pipeline = *request->handle;
+
+	auto creationStart = std::chrono::high_resolution_clock::now();
+
+	// Pipeline caches are internally synchronized, every compile shares the one driver cache
+	VkResult result = pipeline._bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE
+		? vkCreateComputePipelines(_device, _cache->GetHandle(), 1, &request->computeInfo, nullptr, &pipeline._pipeline)
+		: vkCreateGraphicsPipelines(_device, _cache->GetHandle(), 1, &request->graphicsInfo, nullptr, &pipeline._pipeline);
+
+	std::chrono::duration<double, std::milli> creationTime = std::chrono::high_resolution_clock::now() - creationStart;
+	_cache->AddCreationTime(creationTime.count());
+
+	bool success = result == VK_SUCCESS;
+	if (!success)
+	{
+		fprintf(stderr, "Failed to create Pipeline '%s'\n", pipeline._name.c_str());
+		pipeline._pipeline = VK_NULL_HANDLE;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// Published under the lock so Retire sees either a pending pipeline or a finished one
+	if (pipeline._discarded && pipeline._pipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(_device, pipeline._pipeline, nullptr);
+		pipeline._pipeline = VK_NULL_HANDLE;
+	}
+
+	pipeline._compileTime = creationTime.count();
+	pipeline._status.store(success && !pipeline._discarded ? PipelineStatus::Ready : PipelineStatus::Failed, std::memory_order_release);
+
+	if (success)
+		_stats.compiled++;
+	else
+		_stats.failed++;
+	_stats.totalTime += creationTime.count();
+	_stats.longestTime = std::max(_stats.longestTime, creationTime.count());
+
+	// Queued while this one was running, started now that a slot is free
+	_running--;
+	DispatchLocked();
+}
+
+VulkanEngine::PipelineCompiler::Stats VulkanEngine::PipelineCompiler::GetStats()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _stats;
+}
+
+void VulkanEngine::PipelineCompiler::PrintStats()
+{
+	Stats stats = GetStats();
+
+	fprintf(stdout, "Pipeline Compiler : %llu compiled, %llu failed, %.3f ms total, %.3f ms longest\n",
+		static_cast<unsigned long long>(stats.compiled),
+		static_cast<unsigned long long>(stats.failed),
+		stats.totalTime,
+		stats.longestTime);
+}
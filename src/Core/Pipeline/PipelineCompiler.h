@@ -0,0 +1,186 @@
+#pragma once
+
+#include <Common.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <Jobs/JobSystem.h>
+#include <Memory/DeletionQueue.h>
+#include <Pipeline/PipelineCache.h>
+
+namespace VulkanEngine
+{
+	enum class PipelineStatus
+	{
+		Pending,
+		Ready,
+		Failed
+	};
+
+	// Handle shared by the compiler and everything drawing with the pipeline.
+	// The pipeline is only published once compilation finished, until then
+	// Resolve hands out the fallback so recording never waits on the driver.
+	class CompiledPipeline
+	{
+		friend class PipelineCompiler;
+
+	private:
+		std::string _name;
+		VkPipelineBindPoint _bindPoint;
+		VkPipelineLayout _layout;
+		SPTR<CompiledPipeline> _fallback;
+
+		// Written before _status is released as Ready
+		VkPipeline _pipeline = VK_NULL_HANDLE;
+		double _compileTime = 0.0;
+
+		std::atomic<PipelineStatus> _status = PipelineStatus::Pending;
+
+		// Retired before its compile finished, destroyed as soon as it does
+		bool _discarded = false;
+
+	public:
+		CompiledPipeline(const std::string& name, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, SPTR<CompiledPipeline> fallback)
+			: _name(name), _bindPoint(bindPoint), _layout(layout), _fallback(std::move(fallback)) {}
+
+		inline PipelineStatus GetStatus() const { return _status.load(std::memory_order_acquire); }
+		inline bool IsReady() const { return GetStatus() == PipelineStatus::Ready; }
+
+		// VK_NULL_HANDLE until compiled
+		inline VkPipeline GetPipeline() const { return IsReady() ? _pipeline : VK_NULL_HANDLE; }
+
+		// This pipeline once ready, otherwise the first ready fallback. VK_NULL_HANDLE means the draw has to be skipped.
+		VkPipeline Resolve() const;
+
+		inline const std::string& GetName() const { return _name; }
+		inline VkPipelineBindPoint GetBindPoint() const { return _bindPoint; }
+
+		// Owned by whoever created the pipeline, the compiler never destroys it
+		inline VkPipelineLayout GetLayout() const { return _layout; }
+
+		// Milliseconds the driver spent, only valid once ready
+		inline double GetCompileTime() const { return _compileTime; }
+
+	public:
+		CompiledPipeline(const CompiledPipeline&) = delete;
+		CompiledPipeline& operator=(const CompiledPipeline&) = delete;
+	};
+
+	using PipelineHandle = SPTR<CompiledPipeline>;
+
+	// Compiles graphics and compute pipelines as jobs, all sharing one driver cache.
+	// Create infos are deep copied when a compile is requested, so the caller's
+	// structures may go out of scope right away. Only a few compiles run at once
+	// so job threads stay free for the frame's own work.
+	class PipelineCompiler
+	{
+	public:
+		struct Stats
+		{
+			UINT64 compiled = 0;
+			UINT64 failed = 0;
+			double totalTime = 0.0;		// ms summed over all compiles
+			double longestTime = 0.0;	// ms of the slowest compile
+		};
+
+	private:
+		// Owns everything the create info points to, never moves once filled in
+		struct Request
+		{
+			PipelineHandle handle;
+
+			VkGraphicsPipelineCreateInfo graphicsInfo{};
+			VkComputePipelineCreateInfo computeInfo{};
+
+			std::vector<VkPipelineShaderStageCreateInfo> stages;
+			std::vector<std::string> entryPoints;
+			std::vector<VkSpecializationInfo> specializations;
+			std::vector<std::vector<VkSpecializationMapEntry>> mapEntries;
+			std::vector<std::vector<char>> specializationData;
+
+			VkPipelineVertexInputStateCreateInfo vertexInput{};
+			std::vector<VkVertexInputBindingDescription> vertexBindings;
+			std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+
+			VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+			VkPipelineTessellationStateCreateInfo tessellation{};
+
+			VkPipelineViewportStateCreateInfo viewport{};
+			std::vector<VkViewport> viewports;
+			std::vector<VkRect2D> scissors;
+
+			VkPipelineRasterizationStateCreateInfo rasterization{};
+
+			VkPipelineMultisampleStateCreateInfo multisample{};
+			std::vector<VkSampleMask> sampleMask;
+
+			VkPipelineDepthStencilStateCreateInfo depthStencil{};
+
+			VkPipelineColorBlendStateCreateInfo colorBlend{};
+			std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+
+			VkPipelineDynamicStateCreateInfo dynamic{};
+			std::vector<VkDynamicState> dynamicStates;
+
+			void CopyStages(const VkPipelineShaderStageCreateInfo* source, UINT32 count);
+			void CopyGraphics(const VkGraphicsPipelineCreateInfo& source);
+			void CopyCompute(const VkComputePipelineCreateInfo& source);
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+		PipelineCache* _cache = nullptr;
+		JobSystem* _jobs = nullptr;
+
+		std::mutex _mutex;
+		std::deque<SPTR<Request>> _queue;
+		UINT32 _running = 0;
+		UINT32 _maxConcurrent = 1;
+
+		// Compile jobs handed to the job system and not finished yet
+		JobCounter _compileJobs;
+
+		// Every pipeline created, destroyed on Shutdown
+		std::vector<PipelineHandle> _pipelines;
+
+		Stats _stats;
+
+		PipelineHandle Enqueue(SPTR<Request> request);
+		void DispatchLocked();
+		void Compile(const SPTR<Request>& request);
+
+	public:
+		PipelineCompiler() = default;
+
+		// maxConcurrent caps how many job threads may be busy compiling at the same time
+		bool Init(VkDevice device, PipelineCache& cache, JobSystem& jobs, UINT32 maxConcurrent);
+
+		// Compiles still queued fail, running ones are waited for, then every pipeline is destroyed
+		void Shutdown();
+
+		// Never blocks, the returned handle becomes ready once a job thread compiled it.
+		// Shader modules and the layout referenced must stay alive until the handle is no longer pending.
+		PipelineHandle CompileGraphics(const VkGraphicsPipelineCreateInfo& createInfo, const std::string& name, PipelineHandle fallback = nullptr);
+		PipelineHandle CompileCompute(const VkComputePipelineCreateInfo& createInfo, const std::string& name, PipelineHandle fallback = nullptr);
+
+		// Runs jobs on the calling thread until the pipeline is no longer pending, meant for startup only
+		bool Wait(const PipelineHandle& pipeline);
+
+		// Destroys the pipeline once every frame up to frameValue completed. A pipeline still
+		// compiling is destroyed as soon as it finishes instead. Either way the handle is failed
+		// right away, so handles falling back on it resolve past it.
+		void Retire(const PipelineHandle& pipeline, DeletionQueue& deletionQueue, UINT64 frameValue);
+
+		// Swaps next in for current at a frame boundary and retires the previous pipeline.
+		// Frames recorded from now on use next, frames up to frameValue may still use the previous one.
+		void Replace(PipelineHandle& current, PipelineHandle next, DeletionQueue& deletionQueue, UINT64 frameValue);
+
+		size_t GetPendingCount();
+
+		Stats GetStats();
+		void PrintStats();
+
+	public:
+		PipelineCompiler(const PipelineCompiler&) = delete;
+		PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+	};
+}
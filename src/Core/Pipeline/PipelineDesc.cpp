@@ -0,0 +1,110 @@
+#include "PipelineDesc.h"
+
+VulkanEngine::BlendState VulkanEngine::BlendState::Opaque()
+{
+	return BlendState{};
+}
+
+VulkanEngine::BlendState VulkanEngine::BlendState::AlphaBlend()
+{
+	BlendState state;
+	state.enable = true;
+	state.srcColor = VK_BLEND_FACTOR_SRC_ALPHA;
+	state.dstColor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	state.srcAlpha = VK_BLEND_FACTOR_ONE;
+	state.dstAlpha = VK_BLEND_FACTOR_ZERO;
+	return state;
+}
+
+bool VulkanEngine::VertexLayout::operator==(const VertexLayout& other) const
+{
+	auto sameBinding = [](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b)
+		{
+			return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate;
+		};
+
+	auto sameAttribute = [](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b)
+		{
+			return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+		};
+
+	return std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(), sameBinding) &&
+		std::equal(attributes.begin(), attributes.end(), other.attributes.begin(), other.attributes.end(), sameAttribute);
+}
+
+UINT64 VulkanEngine::PipelineDesc::GetHash() const
+{
+	UINT64 hash = HashValue(shaders.size());
+	for (const SPTR<Shader>& shader : shaders)
+		hash = HashCombine(hash, shader->GetHash());
+
+	hash = HashCombine(hash, specialization.GetHash());
+
+	for (const VkVertexInputBindingDescription& binding : vertexLayout.bindings)
+	{
+		hash = HashCombine(hash, HashValue(binding.binding));
+		hash = HashCombine(hash, HashValue(binding.stride));
+		hash = HashCombine(hash, HashValue(binding.inputRate));
+	}
+
+	for (const VkVertexInputAttributeDescription& attribute : vertexLayout.attributes)
+	{
+		hash = HashCombine(hash, HashValue(attribute.location));
+		hash = HashCombine(hash, HashValue(attribute.binding));
+		hash = HashCombine(hash, HashValue(attribute.format));
+		hash = HashCombine(hash, HashValue(attribute.offset));
+	}
+
+	hash = HashCombine(hash, HashValue(topology));
+	hash = HashCombine(hash, HashValue(primitiveRestart));
+	hash = HashCombine(hash, HashValue(polygonMode));
+	hash = HashCombine(hash, HashValue(cullMode));
+	hash = HashCombine(hash, HashValue(frontFace));
+	hash = HashCombine(hash, HashValue(lineWidth));
+	hash = HashCombine(hash, HashValue(depthTest));
+	hash = HashCombine(hash, HashValue(depthWrite));
+	hash = HashCombine(hash, HashValue(depthCompare));
+	hash = HashCombine(hash, HashValue(samples));
+
+	for (const BlendState& state : blend)
+	{
+		hash = HashCombine(hash, HashValue(state.enable));
+		hash = HashCombine(hash, HashValue(state.srcColor));
+		hash = HashCombine(hash, HashValue(state.dstColor));
+		hash = HashCombine(hash, HashValue(state.colorOp));
+		hash = HashCombine(hash, HashValue(state.srcAlpha));
+		hash = HashCombine(hash, HashValue(state.dstAlpha));
+		hash = HashCombine(hash, HashValue(state.alphaOp));
+		hash = HashCombine(hash, HashValue(state.writeMask));
+	}
+
+	for (VkDynamicState state : dynamicStates)
+		hash = HashCombine(hash, HashValue(state));
+
+	hash = HashCombine(hash, HashValue(renderPass));
+	hash = HashCombine(hash, HashValue(subpass));
+	return hash;
+}
+
+bool VulkanEngine::PipelineDesc::operator==(const PipelineDesc& other) const
+{
+	auto sameShader = [](const SPTR<Shader>& a, const SPTR<Shader>& b) { return a->GetHash() == b->GetHash(); };
+
+	return std::equal(shaders.begin(), shaders.end(), other.shaders.begin(), other.shaders.end(), sameShader) &&
+		specialization == other.specialization &&
+		vertexLayout == other.vertexLayout &&
+		topology == other.topology &&
+		primitiveRestart == other.primitiveRestart &&
+		polygonMode == other.polygonMode &&
+		cullMode == other.cullMode &&
+		frontFace == other.frontFace &&
+		lineWidth == other.lineWidth &&
+		depthTest == other.depthTest &&
+		depthWrite == other.depthWrite &&
+		depthCompare == other.depthCompare &&
+		samples == other.samples &&
+		blend == other.blend &&
+		dynamicStates == other.dynamicStates &&
+		renderPass == other.renderPass &&
+		subpass == other.subpass;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Common.h>
+#include <Shader/Shader.h>
+#include <Shader/Specialization.h>
+
+namespace VulkanEngine
+{
+	// Blend state of one color attachment
+	//	if (enable)
+	//	{
+	//		finalColor.rgb = (srcColor * newColor.rgb) <colorOp> (dstColor * oldColor.rgb);
+	//		finalColor.a = (srcAlpha * newColor.a) <alphaOp> (dstAlpha * oldColor.a);
+	//	}
+	//	else
+	//		finalColor = newColor;
+	//	finalColor = finalColor & writeMask;
+	struct BlendState
+	{
+		bool enable = false;
+		VkBlendFactor srcColor = VK_BLEND_FACTOR_ONE;
+		VkBlendFactor dstColor = VK_BLEND_FACTOR_ZERO;
+		VkBlendOp colorOp = VK_BLEND_OP_ADD;
+		VkBlendFactor srcAlpha = VK_BLEND_FACTOR_ONE;
+		VkBlendFactor dstAlpha = VK_BLEND_FACTOR_ZERO;
+		VkBlendOp alphaOp = VK_BLEND_OP_ADD;
+		VkColorComponentFlags writeMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+		static BlendState Opaque();
+		static BlendState AlphaBlend();
+
+		bool operator==(const BlendState&) const = default;
+	};
+
+	// Vertex buffers a pipeline reads, left empty the vertex shader's reflected inputs are used
+	struct VertexLayout
+	{
+		std::vector<VkVertexInputBindingDescription> bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes;
+
+		bool operator==(const VertexLayout& other) const;
+	};
+
+	// Everything that goes into a graphics pipeline, as a plain value. Two descs
+	// comparing equal always produce the same VkPipeline, so materials describing
+	// the same state share one pipeline through PipelineLibrary. Shaders compare by
+	// the content hash of their SPIR-V, the render pass by handle.
+	struct PipelineDesc
+	{
+		std::vector<SPTR<Shader>> shaders;
+		VertexLayout vertexLayout;
+
+		// Shared by every stage, each combination of values is a variant of its own
+		SpecializationConstants specialization;
+
+		// Input Assembly
+		VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		bool primitiveRestart = false;
+
+		// Rasterizer
+		VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+		VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+		VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+		float lineWidth = 1.0f;
+
+		// Depth
+		bool depthTest = false;
+		bool depthWrite = false;
+		VkCompareOp depthCompare = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+		// Multisampling
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+		// One per color attachment of the subpass
+		std::vector<BlendState> blend = { BlendState::Opaque() };
+
+		// Viewport and scissor are always dynamic, the pipeline doesn't depend on the swap chain size
+		std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		UINT32 subpass = 0;
+
+		// Stable across runs as long as the shaders and render pass are the same objects
+		UINT64 GetHash() const;
+
+		bool operator==(const PipelineDesc& other) const;
+
+		struct Hasher
+		{
+			inline size_t operator()(const PipelineDesc& desc) const { return static_cast<size_t>(desc.GetHash()); }
+		};
+	};
+}
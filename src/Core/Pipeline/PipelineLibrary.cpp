@@ -0,0 +1,243 @@
+#include "PipelineLibrary.h"
+
+bool VulkanEngine::PipelineLibrary::Init(PipelineCompiler& compiler, LayoutCache& layouts)
+{
+	_compiler = &compiler;
+	_layouts = &layouts;
+
+	fprintf(stdout, "Created Pipeline Library\n");
+	return true;
+}
+
+void VulkanEngine::PipelineLibrary::Shutdown()
+{
+	// The compiler owns the pipelines, only the references are dropped here
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pipelines.clear();
+}
+
+VulkanEngine::PipelineHandle VulkanEngine::PipelineLibrary::GetGraphics(const PipelineDesc& desc, const std::string& name, PipelineHandle fallback)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto cached = _pipelines.find(desc);
+	if (cached != _pipelines.end())
+	{
+		_stats.hits++;
+		return cached->second.pipeline;
+	}
+
+	// Variants carry their constants in the name so compile logs tell them apart
+	std::string variantName = desc.specialization.IsEmpty() ? name : name + "[" + desc.specialization.ToString() + "]";
+
+	PipelineHandle pipeline = Compile(desc, variantName, std::move(fallback));
+	if (pipeline == nullptr)
+		return nullptr;
+
+	_stats.misses++;
+	_pipelines.emplace(desc, Entry{ pipeline, name });
+	return pipeline;
+}
+
+UINT32 VulkanEngine::PipelineLibrary::Prewarm(const PipelineDesc& base, const std::vector<SpecializationConstants>& variants, const std::string& name)
+{
+	UINT64 misses = GetStats().misses;
+
+	PipelineDesc desc = base;
+	for (const SpecializationConstants& variant : variants)
+	{
+		desc.specialization = variant;
+		GetGraphics(desc, name);
+	}
+
+	return static_cast<UINT32>(GetStats().misses - misses);
+}
+
+void VulkanEngine::PipelineLibrary::Evict(const PipelineHandle& pipeline)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::erase_if(_pipelines, [&pipeline](const auto& entry) { return entry.second.pipeline == pipeline; });
+}
+
+VulkanEngine::PipelineLibrary::Stats VulkanEngine::PipelineLibrary::GetStats()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _stats;
+}
+
+std::vector<VulkanEngine::PipelineLibrary::VariantStats> VulkanEngine::PipelineLibrary::GetVariantStats()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::map<std::string, VariantStats> byName;
+	for (const auto& [desc, entry] : _pipelines)
+	{
+		VariantStats& stats = byName[entry.name];
+		stats.name = entry.name;
+		stats.variants++;
+
+		if (!entry.pipeline->IsReady())
+			continue;
+
+		stats.ready++;
+		stats.compileTime += entry.pipeline->GetCompileTime();
+		stats.longestTime = std::max(stats.longestTime, entry.pipeline->GetCompileTime());
+	}
+
+	std::vector<VariantStats> variants;
+	for (auto& [name, stats] : byName)
+		variants.push_back(stats);
+
+	return variants;
+}
+
+void VulkanEngine::PipelineLibrary::PrintStats()
+{
+	Stats stats = GetStats();
+
+	fprintf(stdout, "Pipeline Library : %zu pipelines, %llu hits, %llu misses\n",
+		GetSize(),
+		static_cast<unsigned long long>(stats.hits),
+		static_cast<unsigned long long>(stats.misses));
+
+	for (const VariantStats& variant : GetVariantStats())
+	{
+		fprintf(stdout, "\t%s : %u variants, %u ready, %.3f ms compiling, %.3f ms longest\n",
+			variant.name.c_str(), variant.variants, variant.ready, variant.compileTime, variant.longestTime);
+	}
+}
+
+VulkanEngine::PipelineHandle VulkanEngine::PipelineLibrary::Compile(const PipelineDesc& desc, const std::string& name, PipelineHandle fallback)
+{
+	// Shader - stages and entry points come from reflection
+	VkSpecializationInfo specialization = desc.specialization.GetInfo();
+
+	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+	for (const SPTR<Shader>& shader : desc.shaders)
+	{
+		VkPipelineShaderStageCreateInfo stage = shader->GetStageInfo();
+		stage.pSpecializationInfo = desc.specialization.IsEmpty() ? nullptr : &specialization;
+		shaderStages.push_back(stage);
+	}
+
+	// Layout - descs whose shaders declare the same interface share one
+	VkPipelineLayout pipelineLayout = _layouts->GetPipelineLayout(desc.shaders);
+	if (pipelineLayout == VK_NULL_HANDLE)
+		return nullptr;
+
+	// Vertex Input - reflected inputs interleaved in one buffer unless the desc lays them out
+	VertexLayout vertexLayout = desc.vertexLayout;
+	if (vertexLayout.bindings.empty())
+	{
+		for (const SPTR<Shader>& shader : desc.shaders)
+		{
+			if (shader->GetStage() != VK_SHADER_STAGE_VERTEX_BIT)
+				continue;
+
+			VkVertexInputBindingDescription binding{};
+			binding.binding = 0;
+			binding.stride = shader->GetReflection().GetVertexAttributes(0, vertexLayout.attributes);
+			binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+			if (!vertexLayout.attributes.empty())
+				vertexLayout.bindings.push_back(binding);
+		}
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<UINT32>(vertexLayout.bindings.size());
+	vertexInputInfo.pVertexBindingDescriptions = vertexLayout.bindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<UINT32>(vertexLayout.attributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = vertexLayout.attributes.data();
+
+	// Input Assembly - structure of input
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = desc.topology;
+	inputAssembly.primitiveRestartEnable = desc.primitiveRestart ? VK_TRUE : VK_FALSE;
+
+	// Dynamic Render states
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<UINT32>(desc.dynamicStates.size());
+	dynamicState.pDynamicStates = desc.dynamicStates.data();
+
+	// Viewport And Scissors - set while recording
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	// Rasterizer
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = desc.polygonMode;
+	rasterizer.cullMode = desc.cullMode;
+	rasterizer.frontFace = desc.frontFace;
+	rasterizer.depthBiasEnable = VK_FALSE;
+	rasterizer.lineWidth = desc.lineWidth;
+
+	// Multisampling
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = desc.samples;
+	multisampling.minSampleShading = 1.0f;
+
+	// Depth
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = desc.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = desc.depthCompare;
+	depthStencil.minDepthBounds = 0.0f;
+	depthStencil.maxDepthBounds = 1.0f;
+
+	// Color Blending
+	std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+	for (const BlendState& state : desc.blend)
+	{
+		VkPipelineColorBlendAttachmentState attachment{};
+		attachment.blendEnable = state.enable ? VK_TRUE : VK_FALSE;
+		attachment.srcColorBlendFactor = state.srcColor;
+		attachment.dstColorBlendFactor = state.dstColor;
+		attachment.colorBlendOp = state.colorOp;
+		attachment.srcAlphaBlendFactor = state.srcAlpha;
+		attachment.dstAlphaBlendFactor = state.dstAlpha;
+		attachment.alphaBlendOp = state.alphaOp;
+		attachment.colorWriteMask = state.writeMask;
+		blendAttachments.push_back(attachment);
+	}
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = static_cast<UINT32>(blendAttachments.size());
+	colorBlending.pAttachments = blendAttachments.data();
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = static_cast<UINT32>(shaderStages.size());
+	pipelineInfo.pStages = shaderStages.data();
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pTessellationState = nullptr;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.renderPass = desc.renderPass;
+	pipelineInfo.subpass = desc.subpass;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	// Deep copied by the compiler, returns right away
+	return _compiler->CompileGraphics(pipelineInfo, name, std::move(fallback));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Common.h>
+#include <mutex>
+#include <unordered_map>
+#include <Pipeline/LayoutCache.h>
+#include <Pipeline/PipelineCompiler.h>
+#include <Pipeline/PipelineDesc.h>
+
+namespace VulkanEngine
+{
+	// Maps PipelineDesc values to compiled pipelines. The first request for a desc
+	// hands it to the PipelineCompiler, every later one is a hash probe returning
+	// the same handle, so materials sharing state share the VkPipeline.
+	// Layouts come from the LayoutCache through the reflected shaders.
+	class PipelineLibrary
+	{
+	public:
+		struct Stats
+		{
+			UINT64 hits = 0;
+			UINT64 misses = 0;			// Requests that started a compile
+		};
+
+		// Specialization variants created under one name
+		struct VariantStats
+		{
+			std::string name;
+			UINT32 variants = 0;
+			UINT32 ready = 0;
+			double compileTime = 0.0;	// ms summed over the ready variants
+			double longestTime = 0.0;
+		};
+
+	private:
+		PipelineCompiler* _compiler = nullptr;
+		LayoutCache* _layouts = nullptr;
+
+		std::mutex _mutex;
+		struct Entry
+		{
+			PipelineHandle pipeline;
+			std::string name;		// Without the specialization suffix, groups the variants
+		};
+
+		std::unordered_map<PipelineDesc, Entry, PipelineDesc::Hasher> _pipelines;
+
+		Stats _stats;
+
+		PipelineHandle Compile(const PipelineDesc& desc, const std::string& name, PipelineHandle fallback);
+
+	public:
+		PipelineLibrary() = default;
+
+		bool Init(PipelineCompiler& compiler, LayoutCache& layouts);
+		void Shutdown();
+
+		// fallback is only used when the desc is new, a cached pipeline keeps the one it was created with
+		PipelineHandle GetGraphics(const PipelineDesc& desc, const std::string& name, PipelineHandle fallback = nullptr);
+
+		// Starts compiling every listed variant of base that isn't cached yet, returns how many were started.
+		// Meant for load time so switching features while running doesn't fall back for a few frames
+		UINT32 Prewarm(const PipelineDesc& base, const std::vector<SpecializationConstants>& variants, const std::string& name);
+
+		// Forgets a pipeline about to be retired so no later request hands it out again
+		void Evict(const PipelineHandle& pipeline);
+
+		inline size_t GetSize() { std::lock_guard<std::mutex> lock(_mutex); return _pipelines.size(); }
+
+		Stats GetStats();
+		std::vector<VariantStats> GetVariantStats();
+		void PrintStats();
+
+	public:
+		PipelineLibrary(const PipelineLibrary&) = delete;
+		PipelineLibrary& operator=(const PipelineLibrary&) = delete;
+	};
+}
@@ -0,0 +1,320 @@
+#include "FrameProfiler.h"
+#include <fstream>
+#include <cmath>
+
+namespace
+{
+	constexpr size_t STAGE_COUNT = static_cast<size_t>(VulkanEngine::FrameStage::Count);
+
+	inline UINT32 StageBit(VulkanEngine::FrameStage stage)
+	{
+		return 1u << static_cast<UINT32>(stage);
+	}
+}
+
+VulkanEngine::FrameProfiler::FrameProfiler(UINT32 historySize) :
+	_history(historySize)
+{
+}
+
+bool VulkanEngine::FrameProfiler::Init(VkPhysicalDevice physicalDevice, VkDevice device, UINT32 queueFamily, UINT32 framesInFlight)
+{
+	_physicalDevice = physicalDevice;
+	_device = device;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	_timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+	return CreateTimer(GpuQueue::Graphics, FrameStage::Gpu, queueFamily, framesInFlight);
+}
+
+bool VulkanEngine::FrameProfiler::InitComputeTimings(UINT32 computeFamily, UINT32 framesInFlight)
+{
+	return CreateTimer(GpuQueue::Compute, FrameStage::ComputeGpu, computeFamily, framesInFlight);
+}
+
+bool VulkanEngine::FrameProfiler::CreateTimer(GpuQueue queue, FrameStage stage, UINT32 queueFamily, UINT32 framesInFlight)
+{
+	GpuTimer& timer = _timers[static_cast<size_t>(queue)];
+	timer.stage = stage;
+	timer.slotFrames.assign(framesInFlight, UINT64_MAX);
+
+	UINT32 queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	UINT32 validBits = queueFamilies[queueFamily].timestampValidBits;
+	if (validBits == 0)
+	{
+		// CPU timings still work, GPU column just stays empty
+		fprintf(stderr, "Timestamp queries not supported on queue family %d, %s timings disabled\n", queueFamily, GetStageName(stage));
+		return true;
+	}
+
+	timer.timestampMask = validBits >= 64 ? UINT64_MAX : ((1ull << validBits) - 1);
+
+	// Two timestamps, begin and end of the timed work, per frame in flight
+	VkQueryPoolCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	createInfo.queryCount = framesInFlight * 2;
+
+	if (vkCreateQueryPool(_device, &createInfo, nullptr, &timer.queryPool) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create Timestamp Query Pool\n");
+		return false;
+	}
+
+	fprintf(stdout, "Created Timestamp Query Pool (%s)\n", GetStageName(stage));
+	return true;
+}
+
+void VulkanEngine::FrameProfiler::Shutdown()
+{
+	for (GpuTimer& timer : _timers)
+	{
+		if (timer.queryPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(_device, timer.queryPool, nullptr);
+
+		timer.queryPool = VK_NULL_HANDLE;
+	}
+}
+
+void VulkanEngine::FrameProfiler::BeginFrame()
+{
+	_current = FrameSample{};
+	_current.frame = _frameNumber;
+	_frameStart = Clock::now();
+	_inFrame = true;
+}
+
+void VulkanEngine::FrameProfiler::EndFrame()
+{
+	if (!_inFrame)
+		return;
+
+	std::chrono::duration<double, std::milli> elapsed = Clock::now() - _frameStart;
+	_current.stages[static_cast<size_t>(FrameStage::CpuFrame)] = elapsed.count();
+	_current.validMask |= StageBit(FrameStage::CpuFrame);
+
+	_history[_frameNumber % _history.size()] = _current;
+	_frameNumber++;
+	_inFrame = false;
+}
+
+void VulkanEngine::FrameProfiler::BeginStage(FrameStage stage)
+{
+	_stageStart[static_cast<size_t>(stage)] = Clock::now();
+}
+
+void VulkanEngine::FrameProfiler::EndStage(FrameStage stage)
+{
+	if (!_inFrame)
+		return;
+
+	std::chrono::duration<double, std::milli> elapsed = Clock::now() - _stageStart[static_cast<size_t>(stage)];
+	_current.stages[static_cast<size_t>(stage)] += elapsed.count();
+	_current.validMask |= StageBit(stage);
+}
+
+VulkanEngine::FrameProfiler::FrameSample* VulkanEngine::FrameProfiler::FindSample(UINT64 frame)
+{
+	FrameSample& sample = _history[frame % _history.size()];
+	if (sample.frame != frame || sample.validMask == 0)
+		return nullptr;
+
+	return &sample;
+}
+
+void VulkanEngine::FrameProfiler::CollectGpuTimings(UINT32 slot)
+{
+	for (GpuTimer& timer : _timers)
+	{
+		if (timer.queryPool == VK_NULL_HANDLE || timer.slotFrames[slot] == UINT64_MAX)
+			continue;
+
+		// Layout is { timestamp, availability } per query
+		UINT64 results[4]{};
+		VkResult result = vkGetQueryPoolResults(
+			_device, timer.queryPool, slot * 2, 2,
+			sizeof(results), results, sizeof(UINT64) * 2,
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		if ((result != VK_SUCCESS && result != VK_NOT_READY) || results[1] == 0 || results[3] == 0)
+			continue;
+
+		FrameSample* sample = FindSample(timer.slotFrames[slot]);
+		timer.slotFrames[slot] = UINT64_MAX;
+		if (sample == nullptr)
+			continue;
+
+		UINT64 ticks = ((results[2] & timer.timestampMask) - (results[0] & timer.timestampMask)) & timer.timestampMask;
+		sample->stages[static_cast<size_t>(timer.stage)] = ticks * _timestampPeriod * 1e-6;
+		sample->validMask |= StageBit(timer.stage);
+	}
+}
+
+void VulkanEngine::FrameProfiler::WriteBeginTimestamp(VkCommandBuffer commandBuffer, UINT32 slot, GpuQueue queue)
+{
+	if (!IsGpuTimingSupported(queue))
+		return;
+
+	VkQueryPool queryPool = _timers[static_cast<size_t>(queue)].queryPool;
+	vkCmdResetQueryPool(commandBuffer, queryPool, slot * 2, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, slot * 2);
+}
+
+void VulkanEngine::FrameProfiler::WriteEndTimestamp(VkCommandBuffer commandBuffer, UINT32 slot, GpuQueue queue)
+{
+	if (!IsGpuTimingSupported(queue))
+		return;
+
+	GpuTimer& timer = _timers[static_cast<size_t>(queue)];
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timer.queryPool, slot * 2 + 1);
+	timer.slotFrames[slot] = _frameNumber;
+}
+
+VulkanEngine::StageStats VulkanEngine::FrameProfiler::GetStats(FrameStage stage, UINT64 firstFrame) const
+{
+	std::vector<double> values;
+	values.reserve(_history.size());
+
+	UINT64 first = _frameNumber > _history.size() ? _frameNumber - _history.size() : 0;
+	first = std::max(first, firstFrame);
+	for (UINT64 frame = first; frame < _frameNumber; frame++)
+	{
+		const FrameSample& sample = _history[frame % _history.size()];
+		if (sample.frame == frame && (sample.validMask & StageBit(stage)))
+			values.push_back(sample.stages[static_cast<size_t>(stage)]);
+	}
+
+	StageStats stats;
+	if (values.empty())
+		return stats;
+
+	std::sort(values.begin(), values.end());
+
+	// Nearest rank percentile
+	auto percentile = [&values](double p)
+		{
+			size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+			return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+		};
+
+	double sum = 0;
+	for (double value : values)
+		sum += value;
+
+	stats.p50 = percentile(0.50);
+	stats.p95 = percentile(0.95);
+	stats.p99 = percentile(0.99);
+	stats.average = sum / values.size();
+	stats.samples = values.size();
+
+	return stats;
+}
+
+void VulkanEngine::FrameProfiler::PrintSummary() const
+{
+	fprintf(stdout, "Frame timings over last %llu frames (ms)\n",
+		static_cast<unsigned long long>(std::min<UINT64>(_frameNumber, _history.size())));
+
+	for (size_t i = 0; i < STAGE_COUNT; i++)
+	{
+		StageStats stats = GetStats(static_cast<FrameStage>(i));
+		if (stats.samples == 0)
+			continue;
+
+		fprintf(stdout, "\t%-10s p50 %8.3f | p95 %8.3f | p99 %8.3f | avg %8.3f\n",
+			GetStageName(static_cast<FrameStage>(i)), stats.p50, stats.p95, stats.p99, stats.average);
+	}
+}
+
+bool VulkanEngine::FrameProfiler::ExportCSV(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		fprintf(stderr, "Failed to open %s for frame timings\n", path.c_str());
+		return false;
+	}
+
+	file << "frame";
+	for (size_t i = 0; i < STAGE_COUNT; i++)
+		file << "," << GetStageName(static_cast<FrameStage>(i));
+	file << "\n";
+
+	UINT64 first = _frameNumber > _history.size() ? _frameNumber - _history.size() : 0;
+	for (UINT64 frame = first; frame < _frameNumber; frame++)
+	{
+		const FrameSample& sample = _history[frame % _history.size()];
+		if (sample.frame != frame)
+			continue;
+
+		file << frame;
+		for (size_t i = 0; i < STAGE_COUNT; i++)
+		{
+			file << ",";
+			if (sample.validMask & StageBit(static_cast<FrameStage>(i)))
+				file << sample.stages[i];
+		}
+		file << "\n";
+	}
+
+	fprintf(stdout, "Frame timings written to %s\n", path.c_str());
+	return true;
+}
+
+bool VulkanEngine::FrameProfiler::ExportJSON(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		fprintf(stderr, "Failed to open %s for frame timings\n", path.c_str());
+		return false;
+	}
+
+	file << "{\n";
+	file << "\t\"frames\": " << _frameNumber << ",\n";
+	file << "\t\"window\": " << std::min<UINT64>(_frameNumber, _history.size()) << ",\n";
+	file << "\t\"unit\": \"ms\",\n";
+	file << "\t\"stages\": {\n";
+
+	bool first = true;
+	for (size_t i = 0; i < STAGE_COUNT; i++)
+	{
+		StageStats stats = GetStats(static_cast<FrameStage>(i));
+		if (stats.samples == 0)
+			continue;
+
+		if (!first)
+			file << ",\n";
+		first = false;
+
+		file << std::format("\t\t\"{}\": {{ \"p50\": {}, \"p95\": {}, \"p99\": {}, \"avg\": {}, \"samples\": {} }}",
+			GetStageName(static_cast<FrameStage>(i)), stats.p50, stats.p95, stats.p99, stats.average, stats.samples);
+	}
+
+	file << "\n\t}\n}\n";
+
+	fprintf(stdout, "Frame timing stats written to %s\n", path.c_str());
+	return true;
+}
+
+const char* VulkanEngine::FrameProfiler::GetStageName(FrameStage stage)
+{
+	switch (stage)
+	{
+	case FrameStage::FenceWait:	return "FenceWait";
+	case FrameStage::Acquire:	return "Acquire";
+	case FrameStage::Record:	return "Record";
+	case FrameStage::Submit:	return "Submit";
+	case FrameStage::Present:	return "Present";
+	case FrameStage::CpuFrame:	return "CpuFrame";
+	case FrameStage::Gpu:		return "Gpu";
+	case FrameStage::ComputeGpu:	return "ComputeGpu";
+	default:					return "Unknown";
+	}
+}
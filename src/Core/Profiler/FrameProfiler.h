@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Common.h>
+#include <chrono>
+
+namespace VulkanEngine
+{
+	enum class FrameStage : UINT8
+	{
+		FenceWait,
+		Acquire,
+		Record,
+		Submit,
+		Present,
+		CpuFrame,	// BeginFrame to EndFrame
+		Gpu,		// Render pass on device, resolved frames in flight later
+		ComputeGpu,	// Async compute submission on the compute queue
+
+		Count
+	};
+
+	// Queues timed with their own query pool, each one reports its busy time as a GPU stage
+	enum class GpuQueue : UINT8
+	{
+		Graphics,
+		Compute,
+
+		Count
+	};
+
+	struct StageStats
+	{
+		double p50 = 0;
+		double p95 = 0;
+		double p99 = 0;
+		double average = 0;
+		UINT64 samples = 0;
+	};
+
+	// Collects per stage CPU timings of DrawFrame and the GPU busy time of each
+	// queue from timestamp queries. Queries of a frame slot are only read back after
+	// that slot's fence has been waited on, so reading them never stalls.
+	// All timings are in milliseconds.
+	class FrameProfiler
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		struct FrameSample
+		{
+			UINT64 frame = 0;
+			UINT32 validMask = 0;
+			double stages[static_cast<size_t>(FrameStage::Count)]{};
+		};
+
+		struct GpuTimer
+		{
+			VkQueryPool queryPool = VK_NULL_HANDLE;
+			UINT64 timestampMask = 0;
+			FrameStage stage = FrameStage::Gpu;
+
+			// Frame number which last wrote the queries of each slot, UINT64_MAX if none
+			std::vector<UINT64> slotFrames;
+		};
+
+	private:
+		VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+		VkDevice _device = VK_NULL_HANDLE;
+		double _timestampPeriod = 0;	// nanoseconds per tick
+
+		GpuTimer _timers[static_cast<size_t>(GpuQueue::Count)];
+
+		std::vector<FrameSample> _history;
+		UINT64 _frameNumber = 0;
+
+		FrameSample _current;
+		Clock::time_point _frameStart;
+		Clock::time_point _stageStart[static_cast<size_t>(FrameStage::Count)];
+		bool _inFrame = false;
+
+		inline bool IsGpuTimingSupported(GpuQueue queue) const { return _timers[static_cast<size_t>(queue)].queryPool != VK_NULL_HANDLE; }
+
+		FrameSample* FindSample(UINT64 frame);
+		bool CreateTimer(GpuQueue queue, FrameStage stage, UINT32 queueFamily, UINT32 framesInFlight);
+
+	public:
+		FrameProfiler(UINT32 historySize = 4096);
+
+		bool Init(VkPhysicalDevice physicalDevice, VkDevice device, UINT32 queueFamily, UINT32 framesInFlight);
+		void Shutdown();
+
+		// Times submissions to a dedicated compute queue as ComputeGpu, after Init
+		bool InitComputeTimings(UINT32 computeFamily, UINT32 framesInFlight);
+
+		// Starts a new frame sample, an unfinished previous sample is dropped
+		void BeginFrame();
+		void EndFrame();
+
+		void BeginStage(FrameStage stage);
+		void EndStage(FrameStage stage);
+
+		// Reads the GPU timings last written by this slot on every queue, call after its fence is signaled
+		void CollectGpuTimings(UINT32 slot);
+
+		void WriteBeginTimestamp(VkCommandBuffer commandBuffer, UINT32 slot, GpuQueue queue = GpuQueue::Graphics);
+		void WriteEndTimestamp(VkCommandBuffer commandBuffer, UINT32 slot, GpuQueue queue = GpuQueue::Graphics);
+
+		// Only frames numbered firstFrame or later that are still in the history are included
+		StageStats GetStats(FrameStage stage, UINT64 firstFrame = 0) const;
+		inline UINT64 GetFrameCount() const { return _frameNumber; }
+
+		void PrintSummary() const;
+		bool ExportCSV(const std::string& path) const;
+		bool ExportJSON(const std::string& path) const;
+
+		static const char* GetStageName(FrameStage stage);
+
+	public:
+		FrameProfiler(const FrameProfiler&) = delete;
+		FrameProfiler& operator=(const FrameProfiler&) = delete;
+	};
+}
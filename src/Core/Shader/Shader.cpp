@@ -1,31 +1,46 @@
 #include "Shader.h"
-#include <VulkanApplication.h>
 
-VulkanEngine::Shader::Shader(const std::string& file) :
-	name(FileName(file)),
-	path(file)
+VulkanEngine::Shader::Shader(VkDevice device, const std::string& path, const UINT32* code, size_t codeSize, UINT64 hash) :
+	_device(device),
+	_name(FileName(path)),
+	_path(path),
+	_hash(hash),
+	_codeSize(codeSize)
 {
-	std::vector<char> code = ReadFile(file);
-
 	VkShaderModuleCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const UINT32*>(code.data());
+	createInfo.codeSize = codeSize;
+	createInfo.pCode = code;
+
+	if (vkCreateShaderModule(_device, &createInfo, nullptr, &_module) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create Shader Module '%s'\n", _path.c_str());
+		_module = VK_NULL_HANDLE;
+		return;
+	}
 
-	if (vkCreateShaderModule(VulkanEngine::VulkanApplication::Get()->GetDevice(), &createInfo, nullptr, &module) != VK_SUCCESS)
-		throw std::runtime_error("failed to create shader module!");
+	// Reflected once here, the code isn't kept around after the module exists
+	if (!_reflection.Reflect(code, codeSize))
+		fprintf(stderr, "Failed to reflect Shader '%s'\n", _path.c_str());
 }
 
 VulkanEngine::Shader::~Shader()
 {
-	vkDestroyShaderModule(VulkanEngine::VulkanApplication::Get()->GetDevice(), module, nullptr);
+	if (_module != VK_NULL_HANDLE)
+		vkDestroyShaderModule(_device, _module, nullptr);
+}
+
+VkPipelineShaderStageCreateInfo VulkanEngine::Shader::GetStageInfo(VkShaderStageFlagBits stage, const char* entryPoint) const
+{
+	VkPipelineShaderStageCreateInfo stageInfo{};
+	stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stageInfo.stage = stage;
+	stageInfo.module = _module;
+	stageInfo.pName = entryPoint;
+	return stageInfo;
 }
 
-void VulkanEngine::Shader::Compile()
+VkPipelineShaderStageCreateInfo VulkanEngine::Shader::GetStageInfo() const
 {
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = module;
-	vertShaderStageInfo.pName = "main";
+	return GetStageInfo(_reflection.GetStage(), _reflection.GetEntryPoint().c_str());
 }
@@ -1,22 +1,46 @@
 #pragma once
 
 #include <Common.h>
+#include <Shader/ShaderReflection.h>
 
 namespace VulkanEngine
 {
+	// One VkShaderModule, owned through the SPTR handed out by ShaderServer.
+	// Pipelines keep a reference for as long as they may be rebuilt from it.
 	class Shader
 	{
 	private:
-		const std::string& name;
-		const std::string& path;
+		VkDevice _device = VK_NULL_HANDLE;
+		VkShaderModule _module = VK_NULL_HANDLE;
 
-		VkShaderModule module;
+		std::string _name;
+		std::string _path;
+		UINT64 _hash = 0;		// Content hash of the SPIR-V the module was created from
+		size_t _codeSize = 0;
+
+		ShaderReflection _reflection;
 
 	public:
-		Shader(const std::string& file);
+		Shader(VkDevice device, const std::string& path, const UINT32* code, size_t codeSize, UINT64 hash);
 		~Shader();
 
-		inline VkShaderModule GetModule() const { return module; }
-		void Compile();
+		inline VkShaderModule GetModule() const { return _module; }
+		inline bool IsValid() const { return _module != VK_NULL_HANDLE; }
+
+		inline const std::string& GetName() const { return _name; }
+		inline const std::string& GetPath() const { return _path; }
+		inline UINT64 GetHash() const { return _hash; }
+		inline size_t GetCodeSize() const { return _codeSize; }
+		inline const ShaderReflection& GetReflection() const { return _reflection; }
+		inline VkShaderStageFlagBits GetStage() const { return _reflection.GetStage(); }
+
+		VkPipelineShaderStageCreateInfo GetStageInfo(VkShaderStageFlagBits stage, const char* entryPoint = "main") const;
+
+		// Stage and entry point as reflected from the module
+		VkPipelineShaderStageCreateInfo GetStageInfo() const;
+
+	public:
+		Shader(const Shader&) = delete;
+		Shader& operator=(const Shader&) = delete;
 	};
-}
\ No newline at end of file
+}
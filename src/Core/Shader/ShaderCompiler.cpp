@@ -0,0 +1,245 @@
+#include "ShaderCompiler.h"
+#include <chrono>
+#include <fstream>
+#include <shaderc/shaderc.hpp>
+
+bool VulkanEngine::ShaderCompiler::Init(const std::string& cacheDirectory, ShaderOptimization optimization)
+{
+	_optimization = optimization;
+	_cacheDirectory = cacheDirectory;
+
+	SPTR<shaderc::Compiler> compiler = MAKE_SPTR<shaderc::Compiler>();
+	if (!compiler->IsValid())
+	{
+		fprintf(stderr, "Failed to create Shader Compiler\n");
+		return false;
+	}
+	_compiler = compiler;
+
+	if (!_cacheDirectory.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(_cacheDirectory, error);
+		if (error)
+		{
+			fprintf(stderr, "Failed to create shader cache '%s', caching disabled\n", cacheDirectory.c_str());
+			_cacheDirectory.clear();
+		}
+	}
+
+	fprintf(stdout, "Created Shader Compiler (%s)\n", GetCompilerVersion().c_str());
+	return true;
+}
+
+void VulkanEngine::ShaderCompiler::Shutdown()
+{
+	_compiler = nullptr;
+}
+
+bool VulkanEngine::ShaderCompiler::Compile(const std::string& path, const char* source, size_t sourceSize, const std::vector<ShaderDefine>& defines, std::vector<UINT32>& spirv)
+{
+	INT32 stage = GetStage(path);
+	if (stage < 0)
+	{
+		fprintf(stderr, "Unknown shader stage for '%s'\n", path.c_str());
+		_failed++;
+		return false;
+	}
+
+	UINT64 key = GetCacheKey(source, sourceSize, defines, stage);
+	if (ReadCache(key, spirv))
+	{
+		_cacheHits++;
+		return true;
+	}
+
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+
+	if (_optimization == ShaderOptimization::Performance)
+		options.SetOptimizationLevel(shaderc_optimization_level_performance);
+	else if (_optimization == ShaderOptimization::Size)
+		options.SetOptimizationLevel(shaderc_optimization_level_size);
+	else
+	{
+		options.SetOptimizationLevel(shaderc_optimization_level_zero);
+		options.SetGenerateDebugInfo();
+	}
+
+	for (const ShaderDefine& define : defines)
+		options.AddMacroDefinition(define.name, define.value);
+
+	auto compileStart = std::chrono::high_resolution_clock::now();
+
+	const shaderc::Compiler& compiler = *std::static_pointer_cast<shaderc::Compiler>(_compiler);
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(
+		source, sourceSize, static_cast<shaderc_shader_kind>(stage), path.c_str(), "main", options);
+
+	std::chrono::duration<double, std::milli> compileTime = std::chrono::high_resolution_clock::now() - compileStart;
+	_compileTime.fetch_add(compileTime.count(), std::memory_order_relaxed);
+
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+	{
+		fprintf(stderr, "Failed to compile Shader '%s'\n%s", path.c_str(), result.GetErrorMessage().c_str());
+		_failed++;
+		return false;
+	}
+
+	spirv.assign(result.cbegin(), result.cend());
+	_compiled++;
+
+	WriteCache(key, spirv);
+	return true;
+}
+
+bool VulkanEngine::ShaderCompiler::CompileFile(const std::string& path, const std::vector<ShaderDefine>& defines, std::vector<UINT32>& spirv)
+{
+	MappedFile source;
+	if (!source.Open(path))
+	{
+		fprintf(stderr, "Failed to read Shader source '%s'\n", path.c_str());
+		_failed++;
+		return false;
+	}
+
+	return Compile(path, source.GetData(), source.GetSize(), defines, spirv);
+}
+
+bool VulkanEngine::ShaderCompiler::WriteSpirv(const std::string& path, const std::vector<UINT32>& spirv)
+{
+	// Unique per call, the watcher thread and a compile job may write the same cache entry at once
+	std::string temporary = GetTemporaryPath(path);
+
+	bool written;
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(UINT32));
+		written = static_cast<bool>(file);
+	}
+
+	std::error_code error;
+	if (!written)
+	{
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+	{
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+
+	return true;
+}
+
+const std::string& VulkanEngine::ShaderCompiler::GetCompilerVersion()
+{
+	static const std::string version = []
+	{
+		unsigned int spirvVersion = 0;
+		unsigned int revision = 0;
+		shaderc_get_spv_version(&spirvVersion, &revision);
+
+		return std::format("shaderc vk{} spv{}.{}r{} vulkan1.2",
+			VK_HEADER_VERSION, (spirvVersion >> 16) & 0xff, (spirvVersion >> 8) & 0xff, revision);
+	}();
+
+	return version;
+}
+
+bool VulkanEngine::ShaderCompiler::IsShaderSource(const std::string& path)
+{
+	return GetStage(path) >= 0;
+}
+
+VulkanEngine::ShaderCompiler::Stats VulkanEngine::ShaderCompiler::GetStats() const
+{
+	Stats stats;
+	stats.cacheHits = _cacheHits.load(std::memory_order_relaxed);
+	stats.compiled = _compiled.load(std::memory_order_relaxed);
+	stats.failed = _failed.load(std::memory_order_relaxed);
+	stats.compileTime = _compileTime.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void VulkanEngine::ShaderCompiler::PrintStats() const
+{
+	Stats stats = GetStats();
+
+	fprintf(stdout, "Shader Compiler : %llu cache hits, %llu compiled in %.3f ms, %llu failed\n",
+		static_cast<unsigned long long>(stats.cacheHits),
+		static_cast<unsigned long long>(stats.compiled),
+		stats.compileTime,
+		static_cast<unsigned long long>(stats.failed));
+}
+
+UINT64 VulkanEngine::ShaderCompiler::GetCacheKey(const char* source, size_t sourceSize, const std::vector<ShaderDefine>& defines, INT32 stage) const
+{
+	UINT64 key = HashBytes(source, sourceSize);
+
+	// Order matters to the preprocessor, so defines are hashed in the order given
+	for (const ShaderDefine& define : defines)
+	{
+		key = HashCombine(key, HashBytes(define.name.data(), define.name.size()));
+		key = HashCombine(key, HashBytes(define.value.data(), define.value.size()));
+	}
+
+	const std::string& version = GetCompilerVersion();
+	key = HashCombine(key, HashBytes(version.data(), version.size()));
+	key = HashCombine(key, HashValue(stage));
+	key = HashCombine(key, HashValue(_optimization));
+	return key;
+}
+
+bool VulkanEngine::ShaderCompiler::ReadCache(UINT64 key, std::vector<UINT32>& spirv) const
+{
+	if (_cacheDirectory.empty())
+		return false;
+
+	MappedFile file;
+	std::filesystem::path path = _cacheDirectory / std::format("{:016x}.spv", key);
+	if (!std::filesystem::exists(path) || !file.Open(path.string()))
+		return false;
+
+	// A truncated entry is treated as a miss and overwritten by the next compile
+	if (file.GetSize() < sizeof(UINT32) || file.GetSize() % sizeof(UINT32) != 0)
+		return false;
+
+	spirv.assign(file.As<UINT32>(), file.As<UINT32>() + file.GetSize() / sizeof(UINT32));
+	return true;
+}
+
+void VulkanEngine::ShaderCompiler::WriteCache(UINT64 key, const std::vector<UINT32>& spirv) const
+{
+	if (_cacheDirectory.empty())
+		return;
+
+	std::filesystem::path path = _cacheDirectory / std::format("{:016x}.spv", key);
+	if (!WriteSpirv(path.string(), spirv))
+		fprintf(stderr, "Failed to write shader cache entry '%s'\n", path.string().c_str());
+}
+
+INT32 VulkanEngine::ShaderCompiler::GetStage(const std::string& path)
+{
+	std::string extension = std::filesystem::path(path).extension().string();
+
+	if (extension == ".vert")
+		return shaderc_vertex_shader;
+	if (extension == ".frag")
+		return shaderc_fragment_shader;
+	if (extension == ".comp")
+		return shaderc_compute_shader;
+	if (extension == ".geom")
+		return shaderc_geometry_shader;
+	if (extension == ".tesc")
+		return shaderc_tess_control_shader;
+	if (extension == ".tese")
+		return shaderc_tess_evaluation_shader;
+
+	return -1;
+}
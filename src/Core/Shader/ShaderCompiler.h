@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Common.h>
+#include <atomic>
+#include <filesystem>
+
+namespace VulkanEngine
+{
+	enum class ShaderOptimization
+	{
+		None,			// Keeps the SPIR-V close to the source, easiest to debug
+		Size,
+		Performance
+	};
+
+	struct ShaderDefine
+	{
+		std::string name;
+		std::string value;
+	};
+
+	// Compiles GLSL to optimized SPIR-V in process through shaderc. Every result is
+	// stored in an on disk cache addressed by a hash of the source, the defines, the
+	// stage, the optimization level and the compiler version, so a warm start only
+	// reads the cache and never runs the front end or the optimizer.
+	// Compiling is thread safe. #include directives are not resolved.
+	class ShaderCompiler
+	{
+	public:
+		struct Stats
+		{
+			UINT64 cacheHits = 0;
+			UINT64 compiled = 0;
+			UINT64 failed = 0;
+			double compileTime = 0.0;	// ms spent in the front end and optimizer
+		};
+
+	private:
+		std::filesystem::path _cacheDirectory;
+		ShaderOptimization _optimization = ShaderOptimization::Performance;
+
+		// Type erased so shaderc stays out of every file that includes this header
+		SPTR<void> _compiler;
+
+		std::atomic<UINT64> _cacheHits = 0;
+		std::atomic<UINT64> _compiled = 0;
+		std::atomic<UINT64> _failed = 0;
+		std::atomic<double> _compileTime = 0.0;
+
+		UINT64 GetCacheKey(const char* source, size_t sourceSize, const std::vector<ShaderDefine>& defines, INT32 stage) const;
+		bool ReadCache(UINT64 key, std::vector<UINT32>& spirv) const;
+		void WriteCache(UINT64 key, const std::vector<UINT32>& spirv) const;
+
+		static INT32 GetStage(const std::string& path);
+
+	public:
+		ShaderCompiler() = default;
+
+		// An empty cacheDirectory disables the disk cache
+		bool Init(const std::string& cacheDirectory, ShaderOptimization optimization = ShaderOptimization::Performance);
+		void Shutdown();
+
+		// The stage is taken from the extension of path, .vert .frag .comp .geom .tesc or .tese
+		bool Compile(const std::string& path, const char* source, size_t sourceSize, const std::vector<ShaderDefine>& defines, std::vector<UINT32>& spirv);
+		bool CompileFile(const std::string& path, const std::vector<ShaderDefine>& defines, std::vector<UINT32>& spirv);
+
+		// Written next to the target and renamed over it, so a reader never sees half a module
+		static bool WriteSpirv(const std::string& path, const std::vector<UINT32>& spirv);
+
+		// Identifies the front end, SPIR-V version and target environment, part of every cache key
+		static const std::string& GetCompilerVersion();
+
+		static bool IsShaderSource(const std::string& path);
+
+		Stats GetStats() const;
+		void PrintStats() const;
+
+	public:
+		ShaderCompiler(const ShaderCompiler&) = delete;
+		ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+	};
+}
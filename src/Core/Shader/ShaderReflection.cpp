@@ -0,0 +1,483 @@
+#include "ShaderReflection.h"
+#include <unordered_map>
+
+namespace
+{
+	// Subset of the SPIR-V specification the reflection reads
+	constexpr UINT32 SPIRV_MAGIC = 0x07230203;
+	constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+	// Universal limit on struct members, a larger member index can only come from a broken module
+	constexpr UINT32 MAX_STRUCT_MEMBERS = 16383;
+
+	// Types nest deeper than this only through a cycle, which a valid module can't contain
+	constexpr UINT32 MAX_TYPE_DEPTH = 64;
+
+	enum Op : UINT32
+	{
+		OpEntryPoint = 15,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72
+	};
+
+	// Words after the opcode every instance of the instruction has, for the instructions reflection reads
+	UINT32 GetMinOperandCount(UINT32 op)
+	{
+		switch (op)
+		{
+		case OpEntryPoint:		return 3;	// Execution model, entry point id, name
+		case OpTypeInt:			return 3;	// Result, width, signedness
+		case OpTypeFloat:		return 2;	// Result, width
+		case OpTypeVector:		return 3;	// Result, component type, count
+		case OpTypeMatrix:		return 3;	// Result, column type, count
+		case OpTypeImage:		return 8;	// Result, sampled type, dim, depth, arrayed, multisampled, sampled, format
+		case OpTypeSampler:		return 1;
+		case OpTypeSampledImage: return 2;
+		case OpTypeArray:		return 3;	// Result, element type, length id
+		case OpTypeRuntimeArray: return 2;
+		case OpTypeStruct:		return 1;
+		case OpTypePointer:		return 3;	// Result, storage class, pointee type
+		case OpConstant:		return 3;	// Result type, result, first value word
+		case OpVariable:		return 3;	// Result type, result, storage class
+		case OpDecorate:		return 2;	// Target, decoration
+		case OpMemberDecorate:	return 3;	// Struct, member, decoration
+		default:				return 0;
+		}
+	}
+
+	enum Decoration : UINT32
+	{
+		DecorationBlock = 2,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBuiltIn = 11,
+		DecorationLocation = 30,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35
+	};
+
+	enum StorageClass : UINT32
+	{
+		StorageClassUniformConstant = 0,
+		StorageClassInput = 1,
+		StorageClassUniform = 2,
+		StorageClassPushConstant = 9,
+		StorageClassStorageBuffer = 12
+	};
+
+	enum Dim : UINT32
+	{
+		DimBuffer = 5,
+		DimSubpassData = 6
+	};
+
+	struct Type
+	{
+		UINT32 op = 0;
+		std::vector<UINT32> operands;	// Everything after the result id
+	};
+
+	struct Decorations
+	{
+		UINT32 set = 0;
+		UINT32 binding = 0;
+		UINT32 location = 0;
+		UINT32 arrayStride = 0;
+		bool hasBinding = false;
+		bool hasLocation = false;
+		bool isBuiltIn = false;
+		bool isBlock = false;
+		bool isBufferBlock = false;
+	};
+
+	struct Member
+	{
+		UINT32 offset = 0;
+		UINT32 matrixStride = 0;
+	};
+
+	struct Variable
+	{
+		UINT32 pointerType = 0;
+		UINT32 id = 0;
+		UINT32 storageClass = 0;
+	};
+
+	struct Module
+	{
+		std::unordered_map<UINT32, Type> types;
+		std::unordered_map<UINT32, UINT32> constants;
+		std::unordered_map<UINT32, Decorations> decorations;
+		std::unordered_map<UINT32, std::vector<Member>> members;
+		std::vector<Variable> variables;
+
+		const Type* FindType(UINT32 id) const
+		{
+			auto type = types.find(id);
+			return type != types.end() ? &type->second : nullptr;
+		}
+
+		Decorations GetDecorations(UINT32 id) const
+		{
+			auto decoration = decorations.find(id);
+			return decoration != decorations.end() ? decoration->second : Decorations{};
+		}
+
+		UINT32 GetSize(UINT32 id, UINT32 matrixStride = 0, UINT32 depth = 0) const
+		{
+			const Type* type = FindType(id);
+			if (type == nullptr || depth > MAX_TYPE_DEPTH)
+				return 0;
+
+			switch (type->op)
+			{
+			case OpTypeInt:
+			case OpTypeFloat:
+				return type->operands[0] / 8;
+
+			case OpTypeVector:
+				return type->operands[1] * GetSize(type->operands[0], 0, depth + 1);
+
+			case OpTypeMatrix:
+				return type->operands[1] * (matrixStride != 0 ? matrixStride : GetSize(type->operands[0], 0, depth + 1));
+
+			case OpTypeArray:
+			{
+				auto length = constants.find(type->operands[1]);
+				UINT32 stride = GetDecorations(id).arrayStride;
+				if (stride == 0)
+					stride = GetSize(type->operands[0], matrixStride, depth + 1);
+
+				return length != constants.end() ? length->second * stride : 0;
+			}
+
+			case OpTypeStruct:
+			{
+				auto layout = members.find(id);
+				UINT32 size = 0;
+
+				for (size_t i = 0; i < type->operands.size(); i++)
+				{
+					Member member = layout != members.end() && i < layout->second.size() ? layout->second[i] : Member{};
+					size = std::max(size, member.offset + GetSize(type->operands[i], member.matrixStride, depth + 1));
+				}
+
+				return size;
+			}
+
+			default:
+				return 0;
+			}
+		}
+	};
+
+	VkShaderStageFlagBits GetExecutionStage(UINT32 executionModel)
+	{
+		switch (executionModel)
+		{
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: return VK_SHADER_STAGE_ALL;
+		}
+	}
+
+	VkFormat GetInputFormat(const Module& module, UINT32 typeId)
+	{
+		const Type* type = module.FindType(typeId);
+		if (type == nullptr)
+			return VK_FORMAT_UNDEFINED;
+
+		UINT32 components = 1;
+		if (type->op == OpTypeVector)
+		{
+			components = type->operands[1];
+			type = module.FindType(type->operands[0]);
+		}
+
+		// Attributes wider or narrower than 32 bits per component are left to the caller
+		if (type == nullptr || (type->op != OpTypeFloat && type->op != OpTypeInt) || components < 1 || components > 4 || type->operands[0] != 32)
+			return VK_FORMAT_UNDEFINED;
+
+		static const VkFormat floats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat signedInts[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat unsignedInts[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if (type->op == OpTypeFloat)
+			return floats[components - 1];
+		if (type->op == OpTypeInt)
+			return type->operands[1] != 0 ? signedInts[components - 1] : unsignedInts[components - 1];
+
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	VkDescriptorType GetDescriptorType(const Module& module, UINT32 typeId, UINT32 storageClass)
+	{
+		const Type* type = module.FindType(typeId);
+		if (type == nullptr)
+			return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+
+		switch (type->op)
+		{
+		case OpTypeSampler:
+			return VK_DESCRIPTOR_TYPE_SAMPLER;
+
+		case OpTypeSampledImage:
+			return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+		case OpTypeImage:
+		{
+			UINT32 dim = type->operands[1];
+			UINT32 sampled = type->operands[5];
+
+			if (dim == DimSubpassData)
+				return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			if (dim == DimBuffer)
+				return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+
+			return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+
+		case OpTypeStruct:
+		{
+			if (storageClass == StorageClassStorageBuffer)
+				return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+			// Before SPIR-V 1.3 storage buffers were Uniform blocks decorated BufferBlock
+			Decorations decorations = module.GetDecorations(typeId);
+			if (decorations.isBufferBlock)
+				return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			if (decorations.isBlock)
+				return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+			return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		}
+
+		default:
+			return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		}
+	}
+}
+
+bool VulkanEngine::ShaderReflection::Reflect(const UINT32* code, size_t codeSize)
+{
+	_stage = VK_SHADER_STAGE_ALL;
+	_entryPoint.clear();
+	_bindings.clear();
+	_inputs.clear();
+	_pushConstantSize = 0;
+
+	size_t wordCount = codeSize / sizeof(UINT32);
+	if (wordCount < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC)
+		return false;
+
+	Module module;
+
+	for (size_t offset = SPIRV_HEADER_WORDS; offset < wordCount;)
+	{
+		UINT32 length = code[offset] >> 16;
+		UINT32 op = code[offset] & 0xffff;
+
+		if (length == 0 || offset + length > wordCount)
+			return false;
+
+		const UINT32* operands = code + offset + 1;
+		UINT32 operandCount = length - 1;
+		offset += length;
+
+		// Every operand read below is within the minimum, anything optional is checked where it is read
+		if (operandCount < GetMinOperandCount(op))
+			return false;
+
+		switch (op)
+		{
+		case OpEntryPoint:
+			// Modules with several entry points are reflected for the first one only
+			if (_entryPoint.empty())
+			{
+				_stage = GetExecutionStage(operands[0]);
+
+				const char* name = reinterpret_cast<const char*>(operands + 2);
+				_entryPoint.assign(name, strnlen(name, (operandCount - 2) * sizeof(UINT32)));
+			}
+			break;
+
+		case OpTypeInt:
+		case OpTypeFloat:
+		case OpTypeVector:
+		case OpTypeMatrix:
+		case OpTypeImage:
+		case OpTypeSampler:
+		case OpTypeSampledImage:
+		case OpTypeArray:
+		case OpTypeRuntimeArray:
+		case OpTypeStruct:
+		case OpTypePointer:
+			module.types[operands[0]] = Type{ op, std::vector<UINT32>(operands + 1, operands + operandCount) };
+			break;
+
+		case OpConstant:
+			module.constants[operands[1]] = operands[2];
+			break;
+
+		case OpVariable:
+			module.variables.push_back(Variable{ operands[0], operands[1], operands[2] });
+			break;
+
+		case OpDecorate:
+		{
+			Decorations& decorations = module.decorations[operands[0]];
+
+			bool hasValue = operands[1] == DecorationArrayStride || operands[1] == DecorationBuiltIn || operands[1] == DecorationLocation ||
+				operands[1] == DecorationBinding || operands[1] == DecorationDescriptorSet;
+			if (hasValue && operandCount < 3)
+				return false;
+
+			UINT32 value = hasValue ? operands[2] : 0;
+
+			switch (operands[1])
+			{
+			case DecorationBlock: decorations.isBlock = true; break;
+			case DecorationBufferBlock: decorations.isBufferBlock = true; break;
+			case DecorationArrayStride: decorations.arrayStride = value; break;
+			case DecorationBuiltIn: decorations.isBuiltIn = true; break;
+			case DecorationLocation: decorations.location = value; decorations.hasLocation = true; break;
+			case DecorationBinding: decorations.binding = value; decorations.hasBinding = true; break;
+			case DecorationDescriptorSet: decorations.set = value; break;
+			}
+			break;
+		}
+
+		case OpMemberDecorate:
+		{
+			if (operands[2] != DecorationOffset && operands[2] != DecorationMatrixStride)
+				break;
+			if (operandCount < 4 || operands[1] >= MAX_STRUCT_MEMBERS)
+				return false;
+
+			std::vector<Member>& members = module.members[operands[0]];
+			if (members.size() <= operands[1])
+				members.resize(operands[1] + 1);
+
+			if (operands[2] == DecorationOffset)
+				members[operands[1]].offset = operands[3];
+			else if (operands[2] == DecorationMatrixStride)
+				members[operands[1]].matrixStride = operands[3];
+			break;
+		}
+		}
+	}
+
+	for (const Variable& variable : module.variables)
+	{
+		const Type* pointer = module.FindType(variable.pointerType);
+		if (pointer == nullptr || pointer->op != OpTypePointer || pointer->operands.size() < 2)
+			continue;
+
+		UINT32 typeId = pointer->operands[1];
+		Decorations decorations = module.GetDecorations(variable.id);
+
+		if (variable.storageClass == StorageClassPushConstant)
+		{
+			_pushConstantSize = std::max(_pushConstantSize, module.GetSize(typeId));
+			continue;
+		}
+
+		if (variable.storageClass == StorageClassInput)
+		{
+			if (_stage != VK_SHADER_STAGE_VERTEX_BIT || decorations.isBuiltIn || !decorations.hasLocation)
+				continue;
+
+			VkFormat format = GetInputFormat(module, typeId);
+			if (format == VK_FORMAT_UNDEFINED)
+			{
+				fprintf(stderr, "Vertex input at location %u has no 32 bit scalar or vector format\n", decorations.location);
+				continue;
+			}
+
+			_inputs.push_back(ReflectedInput{ decorations.location, format, module.GetSize(typeId) });
+			continue;
+		}
+
+		bool isResource = variable.storageClass == StorageClassUniformConstant ||
+			variable.storageClass == StorageClassUniform ||
+			variable.storageClass == StorageClassStorageBuffer;
+
+		if (!isResource || !decorations.hasBinding)
+			continue;
+
+		// Arrays of resources become one binding with a descriptor per element
+		UINT32 count = 1;
+		UINT32 depth = 0;
+		for (const Type* type = module.FindType(typeId); type != nullptr;)
+		{
+			if (++depth > MAX_TYPE_DEPTH)
+				return false;
+
+			if (type->op == OpTypeArray)
+			{
+				auto length = module.constants.find(type->operands[1]);
+				count *= length != module.constants.end() ? length->second : 1;
+			}
+			else if (type->op != OpTypeRuntimeArray)
+				break;
+			else
+				fprintf(stderr, "Unsized descriptor array at set %u binding %u reflected as one descriptor\n", decorations.set, decorations.binding);
+
+			typeId = type->operands[0];
+			type = module.FindType(typeId);
+		}
+
+		VkDescriptorType descriptorType = GetDescriptorType(module, typeId, variable.storageClass);
+		if (descriptorType == VK_DESCRIPTOR_TYPE_MAX_ENUM)
+			continue;
+
+		_bindings.push_back(ReflectedBinding{ decorations.set, decorations.binding, descriptorType, count });
+	}
+
+	std::sort(_bindings.begin(), _bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b)
+		{
+			return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+		});
+
+	std::sort(_inputs.begin(), _inputs.end(), [](const ReflectedInput& a, const ReflectedInput& b) { return a.location < b.location; });
+
+	return true;
+}
+
+UINT32 VulkanEngine::ShaderReflection::GetVertexAttributes(UINT32 binding, std::vector<VkVertexInputAttributeDescription>& attributes) const
+{
+	UINT32 stride = 0;
+
+	for (const ReflectedInput& input : _inputs)
+	{
+		VkVertexInputAttributeDescription attribute{};
+		attribute.location = input.location;
+		attribute.binding = binding;
+		attribute.format = input.format;
+		attribute.offset = stride;
+
+		attributes.push_back(attribute);
+		stride += input.size;
+	}
+
+	return stride;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Common.h>
+
+namespace VulkanEngine
+{
+	struct ReflectedBinding
+	{
+		UINT32 set = 0;
+		UINT32 binding = 0;
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		UINT32 count = 1;
+	};
+
+	struct ReflectedInput
+	{
+		UINT32 location = 0;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		UINT32 size = 0;		// Bytes the attribute takes in a tightly packed vertex
+	};
+
+	// Resource interface of one SPIR-V module, read straight from the binary: the
+	// descriptor bindings it declares, its push constant block and, for vertex
+	// shaders, the vertex inputs. Only what a pipeline layout needs is extracted,
+	// names and decorations of anything else are skipped.
+	class ShaderReflection
+	{
+	private:
+		VkShaderStageFlagBits _stage = VK_SHADER_STAGE_ALL;
+		std::string _entryPoint;
+
+		std::vector<ReflectedBinding> _bindings;	// Sorted by set then binding
+		std::vector<ReflectedInput> _inputs;		// Sorted by location
+		UINT32 _pushConstantSize = 0;
+
+	public:
+		ShaderReflection() = default;
+
+		// Fails on a malformed module, a module without an entry point is accepted but has no stage
+		bool Reflect(const UINT32* code, size_t codeSize);
+
+		inline VkShaderStageFlagBits GetStage() const { return _stage; }
+		inline const std::string& GetEntryPoint() const { return _entryPoint; }
+
+		inline const std::vector<ReflectedBinding>& GetBindings() const { return _bindings; }
+		inline const std::vector<ReflectedInput>& GetInputs() const { return _inputs; }
+		inline UINT32 GetPushConstantSize() const { return _pushConstantSize; }
+
+		// Interleaves every input into one vertex buffer binding in location order, returns the stride
+		UINT32 GetVertexAttributes(UINT32 binding, std::vector<VkVertexInputAttributeDescription>& attributes) const;
+	};
+}
@@ -0,0 +1,142 @@
+#include "ShaderServer.h"
+
+namespace
+{
+	const UINT32 SPIRV_MAGIC = 0x07230203;
+}
+
+bool VulkanEngine::ShaderServer::Init(VkDevice device)
+{
+	_device = device;
+
+	fprintf(stdout, "Created Shader Server\n");
+	return true;
+}
+
+void VulkanEngine::ShaderServer::Shutdown()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (const auto& [hash, shader] : _modules)
+	{
+		if (shader.use_count() > 1)
+			fprintf(stderr, "Shader '%s' is still referenced on shutdown\n", shader->GetPath().c_str());
+	}
+
+	_modules.clear();
+	_pathHashes.clear();
+}
+
+SPTR<VulkanEngine::Shader> VulkanEngine::ShaderServer::Load(const std::string& path)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto pathHash = _pathHashes.find(path);
+		if (pathHash != _pathHashes.end())
+		{
+			auto module = _modules.find(pathHash->second);
+			if (module != _modules.end())
+			{
+				_stats.pathHits++;
+				return module->second;
+			}
+		}
+	}
+
+	// The mapping is page aligned so it can be handed to Vulkan as SPIR-V words without a copy
+	MappedFile code;
+	if (!code.Open(path, FileAccess::WillNeed))
+	{
+		fprintf(stderr, "Failed to read Shader '%s'\n", path.c_str());
+		return nullptr;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stats.fileReads++;
+	}
+
+	const UINT32* words = code.As<UINT32>();
+	SPTR<Shader> shader = FindOrCreate(path, words, code.GetSize(), HashCode(words, code.GetSize()));
+
+	if (shader != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pathHashes[path] = shader->GetHash();
+	}
+
+	return shader;
+}
+
+SPTR<VulkanEngine::Shader> VulkanEngine::ShaderServer::Load(const std::string& name, const UINT32* code, size_t codeSize)
+{
+	return FindOrCreate(name, code, codeSize, HashCode(code, codeSize));
+}
+
+SPTR<VulkanEngine::Shader> VulkanEngine::ShaderServer::FindOrCreate(const std::string& path, const UINT32* code, size_t codeSize, UINT64 hash)
+{
+	if (codeSize < sizeof(UINT32) || codeSize % sizeof(UINT32) != 0 || code[0] != SPIRV_MAGIC)
+	{
+		fprintf(stderr, "Shader '%s' is not valid SPIR-V\n", path.c_str());
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto module = _modules.find(hash);
+	if (module != _modules.end())
+	{
+		_stats.contentHits++;
+		return module->second;
+	}
+
+	// Created under the lock so two threads loading the same blob can't both build it
+	SPTR<Shader> shader = std::make_shared<Shader>(_device, path, code, codeSize, hash);
+	if (!shader->IsValid())
+		return nullptr;
+
+	_stats.modulesCreated++;
+	_modules.emplace(hash, shader);
+	return shader;
+}
+
+void VulkanEngine::ShaderServer::Invalidate(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pathHashes.erase(path);
+}
+
+size_t VulkanEngine::ShaderServer::ReleaseUnused()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	size_t released = std::erase_if(_modules, [](const auto& entry) { return entry.second.use_count() == 1; });
+
+	// Paths pointing at released modules would only miss, drop them too
+	std::erase_if(_pathHashes, [this](const auto& entry) { return !_modules.contains(entry.second); });
+
+	return released;
+}
+
+UINT64 VulkanEngine::ShaderServer::HashCode(const UINT32* code, size_t codeSize)
+{
+	return HashBytes(code, codeSize);
+}
+
+VulkanEngine::ShaderServer::Stats VulkanEngine::ShaderServer::GetStats()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _stats;
+}
+
+void VulkanEngine::ShaderServer::PrintStats()
+{
+	Stats stats = GetStats();
+
+	fprintf(stdout, "Shader Server : %llu modules, %llu file reads, %llu path hits, %llu content hits\n",
+		static_cast<unsigned long long>(stats.modulesCreated),
+		static_cast<unsigned long long>(stats.fileReads),
+		static_cast<unsigned long long>(stats.pathHits),
+		static_cast<unsigned long long>(stats.contentHits));
+}
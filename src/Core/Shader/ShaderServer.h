@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Common.h>
+#include <mutex>
+#include <unordered_map>
+#include <Shader/Shader.h>
+
+namespace VulkanEngine
+{
+	// Library of shader modules keyed by the content hash of their SPIR-V.
+	// Every path is read once, identical blobs share one module no matter where
+	// they came from, and modules stay cached until nothing else references them.
+	class ShaderServer
+	{
+	public:
+		struct Stats
+		{
+			UINT64 fileReads = 0;		// Paths read from disk
+			UINT64 pathHits = 0;		// Loads served without touching the file
+			UINT64 contentHits = 0;		// Blobs that matched an existing module
+			UINT64 modulesCreated = 0;
+		};
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+
+		std::mutex _mutex;
+		std::unordered_map<UINT64, SPTR<Shader>> _modules;		// content hash -> module
+		std::unordered_map<std::string, UINT64> _pathHashes;	// path -> content hash
+
+		Stats _stats;
+
+		SPTR<Shader> FindOrCreate(const std::string& path, const UINT32* code, size_t codeSize, UINT64 hash);
+
+	public:
+		ShaderServer() = default;
+
+		bool Init(VkDevice device);
+		void Shutdown();
+
+		// Returns nullptr when the file is missing or is not valid SPIR-V
+		SPTR<Shader> Load(const std::string& path);
+
+		// Registers SPIR-V already in memory, name is only used for diagnostics
+		SPTR<Shader> Load(const std::string& name, const UINT32* code, size_t codeSize);
+
+		// Forgets a path so the next Load reads it again, used when the file changed on disk
+		void Invalidate(const std::string& path);
+
+		// Drops modules only the library still references, returns how many were destroyed
+		size_t ReleaseUnused();
+
+		static UINT64 HashCode(const UINT32* code, size_t codeSize);
+
+		Stats GetStats();
+		void PrintStats();
+
+	public:
+		ShaderServer(const ShaderServer&) = delete;
+		ShaderServer& operator=(const ShaderServer&) = delete;
+	};
+}
@@ -0,0 +1,201 @@
+#include "ShaderWatcher.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif // __linux__
+
+VulkanEngine::ShaderWatcher::~ShaderWatcher()
+{
+	Stop();
+}
+
+bool VulkanEngine::ShaderWatcher::Start(const std::string& directory, ShaderCompiler& compiler)
+{
+	std::error_code error;
+	_directory = std::filesystem::weakly_canonical(directory, error);
+	_compiler = &compiler;
+
+	if (error || !std::filesystem::is_directory(_directory))
+	{
+		fprintf(stderr, "Shader directory '%s' does not exist, hot reload disabled\n", directory.c_str());
+		return false;
+	}
+
+#ifdef __linux__
+	_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotify < 0)
+	{
+		fprintf(stderr, "Failed to create inotify instance\n");
+		return false;
+	}
+
+	// Editors either rewrite the file in place or write a temporary and rename it over the original
+	if (inotify_add_watch(_inotify, _directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		fprintf(stderr, "Failed to watch shader directory '%s'\n", _directory.string().c_str());
+		close(_inotify);
+		_inotify = -1;
+		return false;
+	}
+#endif // __linux__
+
+	_stop = false;
+	_thread = std::thread(&ShaderWatcher::WatchLoop, this);
+
+	fprintf(stdout, "Watching '%s' for shader changes\n", _directory.string().c_str());
+	return true;
+}
+
+void VulkanEngine::ShaderWatcher::Stop()
+{
+	if (!_thread.joinable())
+		return;
+
+	_stop = true;
+	_thread.join();
+
+#ifdef __linux__
+	close(_inotify);
+	_inotify = -1;
+#endif // __linux__
+}
+
+std::vector<VulkanEngine::CompiledShader> VulkanEngine::ShaderWatcher::PollChanges()
+{
+	std::vector<CompiledShader> compiled;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	compiled.swap(_compiled);
+	return compiled;
+}
+
+void VulkanEngine::ShaderWatcher::WatchLoop()
+{
+	while (!_stop)
+	{
+		if (WaitForEvents())
+			_lastEvent = std::chrono::steady_clock::now();
+
+		if (!_dirty.empty() && std::chrono::steady_clock::now() - _lastEvent >= DEBOUNCE)
+			CompileDirty();
+	}
+}
+
+#ifdef __linux__
+
+bool VulkanEngine::ShaderWatcher::WaitForEvents()
+{
+	// Short timeout so Stop is noticed and debounced sources get compiled on time
+	pollfd descriptor{ _inotify, POLLIN, 0 };
+	if (poll(&descriptor, 1, static_cast<int>(DEBOUNCE.count())) <= 0)
+		return false;
+
+	alignas(inotify_event) char buffer[4096];
+	bool received = false;
+
+	ssize_t length;
+	while ((length = read(_inotify, buffer, sizeof(buffer))) > 0)
+	{
+		for (char* cursor = buffer; cursor < buffer + length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+			cursor += sizeof(inotify_event) + event->len;
+
+			if (event->len == 0)
+				continue;
+
+			std::filesystem::path source = _directory / event->name;
+			if (!ShaderCompiler::IsShaderSource(source.string()))
+				continue;
+
+			if (std::find(_dirty.begin(), _dirty.end(), source) == _dirty.end())
+				_dirty.push_back(source);
+			received = true;
+		}
+	}
+
+	return received;
+}
+
+#else
+
+bool VulkanEngine::ShaderWatcher::WaitForEvents()
+{
+	// No change notifications used here, modification times are compared on every poll
+	static constexpr std::chrono::milliseconds POLL_INTERVAL{ 250 };
+	std::this_thread::sleep_for(std::min<std::chrono::milliseconds>(DEBOUNCE, POLL_INTERVAL));
+
+	static thread_local std::map<std::filesystem::path, std::filesystem::file_time_type> writeTimes;
+	static thread_local std::chrono::steady_clock::time_point lastScan;
+
+	if (std::chrono::steady_clock::now() - lastScan < POLL_INTERVAL)
+		return false;
+	lastScan = std::chrono::steady_clock::now();
+
+	bool received = false;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(_directory, error))
+	{
+		if (!entry.is_regular_file() || !ShaderCompiler::IsShaderSource(entry.path().string()))
+			continue;
+
+		std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+		auto known = writeTimes.find(entry.path());
+
+		// First sighting only records the time, sources are not rebuilt on startup
+		if (known != writeTimes.end() && known->second != writeTime)
+		{
+			if (std::find(_dirty.begin(), _dirty.end(), entry.path()) == _dirty.end())
+				_dirty.push_back(entry.path());
+			received = true;
+		}
+
+		writeTimes[entry.path()] = writeTime;
+	}
+
+	return received;
+}
+
+#endif // __linux__
+
+void VulkanEngine::ShaderWatcher::CompileDirty()
+{
+	std::vector<std::filesystem::path> dirty;
+	dirty.swap(_dirty);
+
+	for (const std::filesystem::path& source : dirty)
+	{
+		auto compileStart = std::chrono::high_resolution_clock::now();
+		std::vector<UINT32> spirv;
+		if (!Compile(source, spirv))
+			continue;
+
+		std::chrono::duration<double, std::milli> compileTime = std::chrono::high_resolution_clock::now() - compileStart;
+		fprintf(stdout, "Recompiled Shader '%s' in %.1f ms\n", source.filename().string().c_str(), compileTime.count());
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto pending = std::find_if(_compiled.begin(), _compiled.end(), [&source](const CompiledShader& shader) { return shader.path == source.string(); });
+		if (pending != _compiled.end())
+			pending->spirv = std::move(spirv);
+		else
+			_compiled.push_back(CompiledShader{ source.string(), std::move(spirv) });
+	}
+}
+
+bool VulkanEngine::ShaderWatcher::Compile(const std::filesystem::path& source, std::vector<UINT32>& spirv)
+{
+	if (!_compiler->CompileFile(source.string(), {}, spirv))
+		return false;
+
+	// Keeps the SPIR-V next to the source current for external tools, the engine itself always compiles the source
+	std::string output = source.string() + ".spv";
+	if (!ShaderCompiler::WriteSpirv(output, spirv))
+	{
+		fprintf(stderr, "Failed to replace Shader '%s'\n", output.c_str());
+		return false;
+	}
+
+	return true;
+}
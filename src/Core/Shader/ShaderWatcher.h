@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Common.h>
+#include "ShaderCompiler.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace VulkanEngine
+{
+	struct CompiledShader
+	{
+		std::string path;			// Weakly canonical
+		std::vector<UINT32> spirv;
+	};
+
+	// Watches a shader directory and recompiles GLSL sources to SPIR-V on a
+	// background thread as soon as they are saved. Linux uses inotify, other
+	// platforms poll modification times. The render thread collects the sources
+	// that were rebuilt with PollChanges, once per frame, together with their SPIR-V
+	// so it never has to compile anything itself.
+	class ShaderWatcher
+	{
+	private:
+		std::filesystem::path _directory;
+		ShaderCompiler* _compiler = nullptr;
+
+		std::thread _thread;
+		std::atomic<bool> _stop = false;
+
+		std::mutex _mutex;
+		std::vector<CompiledShader> _compiled;
+
+#ifdef __linux__
+		int _inotify = -1;
+#endif // __linux__
+
+		// Sources saved since the last compile, compiled once no new event arrived for DEBOUNCE
+		std::vector<std::filesystem::path> _dirty;
+		std::chrono::steady_clock::time_point _lastEvent;
+
+		void WatchLoop();
+		bool WaitForEvents();
+		void CompileDirty();
+		bool Compile(const std::filesystem::path& source, std::vector<UINT32>& spirv);
+
+	public:
+		// Editors write a file in several steps, wait for them to settle before compiling
+		static constexpr std::chrono::milliseconds DEBOUNCE{ 50 };
+
+		ShaderWatcher() = default;
+		~ShaderWatcher();
+
+		// Sources are compiled through compiler and also written to <source>.spv
+		bool Start(const std::string& directory, ShaderCompiler& compiler);
+		void Stop();
+
+		// Sources recompiled since the last call, a source saved twice only reports its latest SPIR-V
+		std::vector<CompiledShader> PollChanges();
+
+		inline bool IsRunning() const { return _thread.joinable(); }
+
+	public:
+		ShaderWatcher(const ShaderWatcher&) = delete;
+		ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+	};
+}
@@ -0,0 +1,71 @@
+#include "Specialization.h"
+
+void VulkanEngine::SpecializationConstants::Set(UINT32 constantId, UINT32 value)
+{
+	auto entry = std::lower_bound(_entries.begin(), _entries.end(), constantId,
+		[](const VkSpecializationMapEntry& entry, UINT32 id) { return entry.constantID < id; });
+
+	size_t index = entry - _entries.begin();
+	if (entry != _entries.end() && entry->constantID == constantId)
+	{
+		_data[index] = value;
+		return;
+	}
+
+	_entries.insert(entry, VkSpecializationMapEntry{ constantId, 0, sizeof(UINT32) });
+	_data.insert(_data.begin() + index, value);
+
+	// Entries after the inserted one moved up a slot in the data
+	for (size_t i = index; i < _entries.size(); i++)
+		_entries[i].offset = static_cast<UINT32>(i * sizeof(UINT32));
+}
+
+VkSpecializationInfo VulkanEngine::SpecializationConstants::GetInfo() const
+{
+	VkSpecializationInfo info{};
+	info.mapEntryCount = static_cast<UINT32>(_entries.size());
+	info.pMapEntries = _entries.data();
+	info.dataSize = _data.size() * sizeof(UINT32);
+	info.pData = _data.data();
+	return info;
+}
+
+UINT64 VulkanEngine::SpecializationConstants::GetHash() const
+{
+	UINT64 hash = HashValue(_entries.size());
+	for (size_t i = 0; i < _entries.size(); i++)
+	{
+		hash = HashCombine(hash, HashValue(_entries[i].constantID));
+		hash = HashCombine(hash, HashValue(_data[i]));
+	}
+
+	return hash;
+}
+
+std::string VulkanEngine::SpecializationConstants::ToString() const
+{
+	std::string text;
+	for (size_t i = 0; i < _entries.size(); i++)
+	{
+		if (i > 0)
+			text += ',';
+
+		text += std::to_string(_entries[i].constantID) + '=' + std::to_string(_data[i]);
+	}
+
+	return text;
+}
+
+bool VulkanEngine::SpecializationConstants::operator==(const SpecializationConstants& other) const
+{
+	if (_data != other._data || _entries.size() != other._entries.size())
+		return false;
+
+	for (size_t i = 0; i < _entries.size(); i++)
+	{
+		if (_entries[i].constantID != other._entries[i].constantID)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Common.h>
+#include <bit>
+#include <initializer_list>
+
+namespace VulkanEngine
+{
+	// Values for the specialization constants of a pipeline, applied to every stage.
+	// Constants are 32 bit and sorted by id, so equal sets compare and hash equal no
+	// matter the order they were set in. Stages that don't declare an id ignore it.
+	class SpecializationConstants
+	{
+	private:
+		std::vector<VkSpecializationMapEntry> _entries;
+		std::vector<UINT32> _data;
+
+	public:
+		SpecializationConstants() = default;
+
+		void Set(UINT32 constantId, UINT32 value);
+		inline void Set(UINT32 constantId, INT32 value) { Set(constantId, static_cast<UINT32>(value)); }
+		inline void Set(UINT32 constantId, float value) { Set(constantId, std::bit_cast<UINT32>(value)); }
+
+		// SPIR-V booleans are specialized with a VkBool32
+		inline void SetBool(UINT32 constantId, bool value) { Set(constantId, value ? UINT32(VK_TRUE) : UINT32(VK_FALSE)); }
+
+		inline bool IsEmpty() const { return _entries.empty(); }
+		inline size_t GetCount() const { return _entries.size(); }
+
+		// Points into this object, valid until it is changed or destroyed
+		VkSpecializationInfo GetInfo() const;
+
+		UINT64 GetHash() const;
+
+		// Short form for pipeline names, "id=value" pairs
+		std::string ToString() const;
+
+		bool operator==(const SpecializationConstants& other) const;
+	};
+
+	// Compile time set of boolean shader features, Feature is an enum class whose last
+	// value is Count. Each feature maps to a bool specialization constant, its id being
+	// the feature index plus an offset, so a shader declares
+	//	layout(constant_id = N) const bool FEATURE = false;
+	// and the driver drops the branches of disabled features when creating the pipeline.
+	template <typename Feature>
+	class FeatureSet
+	{
+	public:
+		static constexpr UINT32 FEATURE_COUNT = static_cast<UINT32>(Feature::Count);
+		static_assert(FEATURE_COUNT <= 32, "FeatureSet holds at most 32 features");
+
+		static constexpr UINT32 ALL_BITS = FEATURE_COUNT == 32 ? ~0u : (1u << FEATURE_COUNT) - 1;
+		static constexpr UINT64 VARIANT_COUNT = 1ull << FEATURE_COUNT;
+
+	private:
+		UINT32 _bits = 0;
+
+	public:
+		constexpr FeatureSet() = default;
+		constexpr explicit FeatureSet(UINT32 bits) : _bits(bits & ALL_BITS) {}
+
+		constexpr FeatureSet(std::initializer_list<Feature> features)
+		{
+			for (Feature feature : features)
+				_bits |= Bit(feature);
+		}
+
+		constexpr FeatureSet With(Feature feature) const { return FeatureSet(_bits | Bit(feature)); }
+		constexpr FeatureSet Without(Feature feature) const { return FeatureSet(_bits & ~Bit(feature)); }
+		constexpr bool Has(Feature feature) const { return (_bits & Bit(feature)) != 0; }
+
+		constexpr UINT32 GetBits() const { return _bits; }
+
+		constexpr bool operator==(const FeatureSet&) const = default;
+
+		SpecializationConstants ToSpecialization(UINT32 firstConstantId = 0) const
+		{
+			SpecializationConstants constants;
+			for (UINT32 i = 0; i < FEATURE_COUNT; i++)
+				constants.SetBool(firstConstantId + i, (_bits & (1u << i)) != 0);
+
+			return constants;
+		}
+
+	private:
+		static constexpr UINT32 Bit(Feature feature) { return 1u << static_cast<UINT32>(feature); }
+	};
+}
@@ -0,0 +1,118 @@
+#include "TimelineSemaphore.h"
+
+bool VulkanEngine::TimelineSemaphore::IsSupported(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	if (deviceProperties.apiVersion < VK_API_VERSION_1_2)
+		return false;
+
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &features12;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+	return features12.timelineSemaphore == VK_TRUE;
+}
+
+bool VulkanEngine::TimelineSemaphore::Create(VkDevice device, UINT64 initialValue)
+{
+	_device = device;
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = initialValue;
+
+	VkSemaphoreCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	createInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(_device, &createInfo, nullptr, &_semaphore) != VK_SUCCESS)
+	{
+		fprintf(stderr, "Failed to create Timeline Semaphore\n");
+		return false;
+	}
+
+	return true;
+}
+
+void VulkanEngine::TimelineSemaphore::Destroy()
+{
+	if (_semaphore != VK_NULL_HANDLE)
+		vkDestroySemaphore(_device, _semaphore, nullptr);
+	_semaphore = VK_NULL_HANDLE;
+}
+
+UINT64 VulkanEngine::TimelineSemaphore::GetValue() const
+{
+	UINT64 value = 0;
+	vkGetSemaphoreCounterValue(_device, _semaphore, &value);
+	return value;
+}
+
+bool VulkanEngine::TimelineSemaphore::Wait(UINT64 value, UINT64 timeout) const
+{
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &_semaphore;
+	waitInfo.pValues = &value;
+
+	return vkWaitSemaphores(_device, &waitInfo, timeout) == VK_SUCCESS;
+}
+
+void VulkanEngine::TimelineSemaphore::Signal(UINT64 value)
+{
+	VkSemaphoreSignalInfo signalInfo{};
+	signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+	signalInfo.semaphore = _semaphore;
+	signalInfo.value = value;
+
+	vkSignalSemaphore(_device, &signalInfo);
+}
+
+void VulkanEngine::SemaphoreSubmit::Wait(VkSemaphore semaphore, VkPipelineStageFlags stage, UINT64 value)
+{
+	if (semaphore == VK_NULL_HANDLE)
+		return;
+
+	waitSemaphores[waitCount] = semaphore;
+	waitValues[waitCount] = value;
+	waitStages[waitCount] = stage;
+	waitCount++;
+}
+
+void VulkanEngine::SemaphoreSubmit::Signal(VkSemaphore semaphore, UINT64 value)
+{
+	if (semaphore == VK_NULL_HANDLE)
+		return;
+
+	signalSemaphores[signalCount] = semaphore;
+	signalValues[signalCount] = value;
+	signalCount++;
+}
+
+void VulkanEngine::SemaphoreSubmit::Fill(VkSubmitInfo& submitInfo, bool useTimeline)
+{
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	submitInfo.signalSemaphoreCount = signalCount;
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+	if (!useTimeline)
+		return;
+
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.pNext = submitInfo.pNext;
+	timelineInfo.waitSemaphoreValueCount = waitCount;
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = signalCount;
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
+	submitInfo.pNext = &timelineInfo;
+}
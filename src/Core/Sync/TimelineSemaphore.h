@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Common.h>
+#include <array>
+
+namespace VulkanEngine
+{
+	// Thin owner of a VK_SEMAPHORE_TYPE_TIMELINE semaphore (core in Vulkan 1.2).
+	// A single monotonically increasing value replaces a fence and a binary
+	// semaphore per frame slot, both the host and any queue can wait on it.
+	class TimelineSemaphore
+	{
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		VkSemaphore _semaphore = VK_NULL_HANDLE;
+
+	public:
+		TimelineSemaphore() = default;
+
+		static bool IsSupported(VkPhysicalDevice physicalDevice);
+
+		bool Create(VkDevice device, UINT64 initialValue = 0);
+		void Destroy();
+
+		// Last value signaled by the device or host, never blocks
+		UINT64 GetValue() const;
+
+		// Returns false on timeout
+		bool Wait(UINT64 value, UINT64 timeout = UINT64_MAX) const;
+
+		void Signal(UINT64 value);
+
+		inline VkSemaphore GetHandle() const { return _semaphore; }
+
+	public:
+		TimelineSemaphore(const TimelineSemaphore&) = delete;
+		TimelineSemaphore& operator=(const TimelineSemaphore&) = delete;
+	};
+
+	// Gathers the semaphores of one vkQueueSubmit. Binary semaphores use value 0,
+	// timeline values are chained through VkTimelineSemaphoreSubmitInfo on Fill.
+	struct SemaphoreSubmit
+	{
+		static constexpr UINT32 MAX_SEMAPHORES = 4;
+
+		std::array<VkSemaphore, MAX_SEMAPHORES> waitSemaphores{};
+		std::array<UINT64, MAX_SEMAPHORES> waitValues{};
+		std::array<VkPipelineStageFlags, MAX_SEMAPHORES> waitStages{};
+		UINT32 waitCount = 0;
+
+		std::array<VkSemaphore, MAX_SEMAPHORES> signalSemaphores{};
+		std::array<UINT64, MAX_SEMAPHORES> signalValues{};
+		UINT32 signalCount = 0;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+
+		// Null handles are skipped so optional dependencies need no branching at the call site
+		void Wait(VkSemaphore semaphore, VkPipelineStageFlags stage, UINT64 value = 0);
+		void Signal(VkSemaphore semaphore, UINT64 value = 0);
+
+		// submitInfo keeps pointers into this struct, it must outlive vkQueueSubmit
+		void Fill(VkSubmitInfo& submitInfo, bool useTimeline);
+	};
+}
@@ -10,7 +10,7 @@ namespace VulkanEngine
 
 	private:
 		GLFWwindow* _window;
-		bool _framebufferResized;
+		bool _framebufferResized = false;
 
 	public:
 		Window(int width, int height, const std::string& title, GLFWwindow* sharedWindow = nullptr, GLFWmonitor* monitor = nullptr, bool isHidden = false, bool isDecorated = true);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// 64 bit FNV-1a, stable across runs and platforms so it can key on disk caches
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+template <typename T>
+inline uint64_t HashValue(const T& value, uint64_t seed = 0xcbf29ce484222325ull)
+{
+	return HashBytes(&value, sizeof(T), seed);
+}
+
+inline uint64_t HashCombine(uint64_t hash, uint64_t value)
+{
+	return hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+}
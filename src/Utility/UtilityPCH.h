@@ -2,4 +2,5 @@
 
 #include <Type.h>
 #include <Array.h>
-#include <Path.h>
\ No newline at end of file
+#include <Path.h>
+#include <Hash.h>
\ No newline at end of file
@@ -1,19 +1,34 @@
 #include <VulkanApplication.h>
 #include <Window/Window.h>
+#include <bit>
+#include <chrono>
+#include <fstream>
 
-bool VulkanEngine::VulkanApplication::Init()
+bool VulkanEngine::VulkanApplication::Init(const RenderConfig& config)
 {
-	if (!InitGLFW())
-		return false;
+	_config = config;
+	_framesInFlight = _config.framesInFlight;
+
+	if (!_config.configPath.empty() && std::filesystem::exists(_config.configPath))
+		_configWriteTime = std::filesystem::last_write_time(_config.configPath);
+
+	if (!_config.headless)
+	{
+		if (!InitGLFW())
+			return false;
 
 #ifdef VK_USE_PLATFORM_WIN32_KHR
 #pragma push_macro("CreateWindow")
 #undef CreateWindow
 #endif // VK_USE_PLATFORM_WIN32_KHR
-	_window = VulkanEngine::WindowFactory::CreateWindow(800, 600, "Vulkan window");
+		_window = VulkanEngine::WindowFactory::CreateWindow(_config.width, _config.height, "Vulkan window");
 #ifdef VK_USE_PLATFORM_WIN32_KHR
 #pragma pop_macro("CreateWindow")
 #endif // VK_USE_PLATFORM_WIN32_KHR
+	}
+
+	if (!CreateJobSystem())
+		return false;
 
 	if (!InitVulkan())
 		return false;
@@ -23,10 +38,56 @@ bool VulkanEngine::VulkanApplication::Init()
 
 void VulkanEngine::VulkanApplication::Run()
 {
-	while (!glfwWindowShouldClose(_window->GetGLFWWindow()))
+	if (_config.cullBenchmark)
+	{
+		RunCullBenchmark();
+		return;
+	}
+
+	if (_config.instanceBenchmark)
+	{
+		RunInstanceBenchmark();
+		return;
+	}
+
+	if (_config.headless)
+	{
+		// No presentation engine in the loop, frames are submitted as fast as the
+		// device retires them which gives a reproducible throughput number per build
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (UINT64 frame = 0; frame < _config.frameCount; frame++)
+		{
+			PollConfigFile();
+			DrawFrame();
+		}
+
+		vkDeviceWaitIdle(_device);
+
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		fprintf(stdout, "Rendered %llu headless frames in %.3f s : %.2f FPS\n",
+			static_cast<unsigned long long>(_config.frameCount),
+			elapsed.count(),
+			_config.frameCount / elapsed.count());
+
+		if (!_config.capturePath.empty() && _config.frameCount > 0)
+		{
+			// DrawFrame advanced past the last rendered slot, its image is the previous one
+			UINT32 lastImage = (_currentFrame + _framesInFlight - 1) % _framesInFlight;
+			SaveCapture(lastImage, _config.capturePath);
+		}
+
+		return;
+	}
+
+	UINT64 frame = 0;
+	while (!glfwWindowShouldClose(_window->GetGLFWWindow())
+		&& (_config.frameCount == 0 || frame++ < _config.frameCount))
 	{
 		glfwPollEvents();
 
+		PollConfigFile();
+
 		DrawFrame();
 	}
 
@@ -36,57 +97,119 @@ void VulkanEngine::VulkanApplication::Run()
 
 void VulkanEngine::VulkanApplication::Shutdown()
 {
+	_profiler.PrintSummary();
+
+	if (!_config.profilePath.empty())
+	{
+		_profiler.ExportCSV(_config.profilePath + ".csv");
+		_profiler.ExportJSON(_config.profilePath + ".json");
+	}
+
 	ShutdownVulkan();
-	ShutdownGLFW();
+
+	_jobs.Shutdown();
+
+	if (!_config.headless)
+		ShutdownGLFW();
 }
 
 void VulkanEngine::VulkanApplication::DrawFrame()
 {
-	vkWaitForFences(_device, 1, &_frameFences[_currentFrame], VK_TRUE, UINT64_MAX);
+	_profiler.BeginFrame();
+
+	_profiler.BeginStage(FrameStage::FenceWait);
+	WaitForFrameSlot();
+	_profiler.EndStage(FrameStage::FenceWait);
+
+	// The wait guarantees this slot's previous queries are done, so this never blocks
+	_profiler.CollectGpuTimings(_currentFrame);
+	if (_useGpuCulling)
+		_gpuCuller.CollectStats(_currentFrame);
+
+	_deletionQueue.Flush(GetCompletedFrameValue());
+
+	if (_shaderWatcher.IsRunning())
+		ReloadShaders();
+
+	if (_config.headless)
+	{
+		// Each frame in flight owns its offscreen image, so the wait above is
+		// enough to know the image is free and no acquire or present is needed
+		ResetFrameCommandPools();
+
+		_assetLoader.ProcessUploads(_uploader);
+		if (_mesh.IsCreated() && !_mesh.IsResident())
+			_mesh.Upload(_uploader);
+		if (_useGpuCulling && !_gpuCuller.IsResident())
+			_gpuCuller.Upload(_uploader);
+		UploadSubmission upload = _uploader.Submit(_currentFrame, _frameValue + 1);
+		ComputeSubmission compute = _computeScheduler.Submit(_currentFrame, _frameValue + 1, upload);
+
+		SubmitInstances();
+
+		_profiler.BeginStage(FrameStage::Record);
+		Draw(_commandBuffers[_currentFrame], _currentFrame);
+		_profiler.EndStage(FrameStage::Record);
+
+		SubmitFrame(VK_NULL_HANDLE, upload, compute, VK_NULL_HANDLE);
+
+		_currentFrame = (_currentFrame + 1) % _framesInFlight;
+
+		_profiler.EndFrame();
+		return;
+	}
+
+	if (_window.get()->IsDirty())
+	{
+		_window.get()->Clean();
+		RequestSwapChainRecreation();
+	}
+
+	if (_swapChainDirty && std::chrono::steady_clock::now() - _swapChainDirtyTime >= SWAPCHAIN_RESIZE_DEBOUNCE)
+		ReCreateSwapChain();
 
 	UINT32 imageIndex;
+	_profiler.BeginStage(FrameStage::Acquire);
 	VkResult result = vkAcquireNextImageKHR(_device, _swapChain, UINT64_MAX, _imageAvailableSemaphores[_currentFrame], VK_NULL_HANDLE, &imageIndex);
+	_profiler.EndStage(FrameStage::Acquire);
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+	// A suboptimal image was still acquired and its semaphore signaled, so the frame goes ahead
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
 	{
 		ReCreateSwapChain();
 		return;
 	}
+	else if (result == VK_SUBOPTIMAL_KHR)
+		RequestSwapChainRecreation();
 	else if (result != VK_SUCCESS)
 		throw std::runtime_error("Failed to acquire swap chain image!");
 
-	vkResetFences(_device, 1, &_frameFences[_currentFrame]);
+	ResetFrameCommandPools();
 
-	vkResetCommandBuffer(_commandBuffers[_currentFrame], 0);
+	_assetLoader.ProcessUploads(_uploader);
+	if (_mesh.IsCreated() && !_mesh.IsResident())
+		_mesh.Upload(_uploader);
+	if (_useGpuCulling && !_gpuCuller.IsResident())
+		_gpuCuller.Upload(_uploader);
 
-	Draw(_commandBuffers[_currentFrame], imageIndex);
+	// Submitted only now that the frame is known to go ahead, so its semaphore is always waited on
+	UploadSubmission upload = _uploader.Submit(_currentFrame, _frameValue + 1);
 
-	VkSemaphore waitSemaphores[]
-	{
-		_imageAvailableSemaphores[_currentFrame]
-	};
-	VkPipelineStageFlags waitStages[]
-	{
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-	};
+	// Runs on the compute queue next to the graphics frames still in flight
+	ComputeSubmission compute = _computeScheduler.Submit(_currentFrame, _frameValue + 1, upload);
+
+	SubmitInstances();
+
+	_profiler.BeginStage(FrameStage::Record);
+	Draw(_commandBuffers[_currentFrame], imageIndex);
+	_profiler.EndStage(FrameStage::Record);
 
 	VkSemaphore signalSemaphores[]
 	{
 		_renderFinishSemaphores[_currentFrame]
 	};
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &_commandBuffers[_currentFrame];
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
-
-	if (vkQueueSubmit(_presentationQueue, 1, &submitInfo, _frameFences[_currentFrame]) != VK_SUCCESS)
-		throw std::runtime_error("Failed to submit draw command to queue");
+	SubmitFrame(_imageAvailableSemaphores[_currentFrame], upload, compute, _renderFinishSemaphores[_currentFrame]);
 
 	VkSwapchainKHR swapChains[]
 	{
@@ -102,16 +225,20 @@ void VulkanEngine::VulkanApplication::DrawFrame()
 	presentInfo.pImageIndices = &imageIndex;
 	presentInfo.pResults = nullptr;
 
+	_profiler.BeginStage(FrameStage::Present);
 	result = vkQueuePresentKHR(_presentationQueue, &presentInfo);
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || _window.get()->IsDirty())
-	{
-		_window.get()->Clean();
+	_profiler.EndStage(FrameStage::Present);
+	// Out of date chains can't be presented to anymore, suboptimal ones wait for the resize to settle
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
 		ReCreateSwapChain();
-	}
+	else if (result == VK_SUBOPTIMAL_KHR)
+		RequestSwapChainRecreation();
 	else if (result != VK_SUCCESS)
 		throw std::runtime_error("Failed to present swap chain Image");
 
-	_currentFrame = (_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	_currentFrame = (_currentFrame + 1) % _framesInFlight;
+
+	_profiler.EndFrame();
 }
 
 #pragma region GLFW
@@ -154,7 +281,7 @@ bool VulkanEngine::VulkanApplication::InitVulkan()
 		return false;
 #endif // ENABLE_VK_VAL_LAYERS
 
-	if (!CreateSurface())
+	if (!_config.headless && !CreateSurface())
 		return false;
 
 	if (!PickPhysicalDevice())
@@ -163,7 +290,47 @@ bool VulkanEngine::VulkanApplication::InitVulkan()
 	if (!CreateLogicalDevice())
 		return false;
 
-	if (!CreateSwapChain())
+	if (!_allocator.Init(_physicalDevice, _device))
+		return false;
+
+	// Created early since its vertex format shapes the pipeline, the data streams in with the first frames
+	if (!CreateMesh())
+		return false;
+
+	if (!_pipelineCache.Init(_physicalDevice, _device, _config.pipelineCachePath))
+		return false;
+
+	if (!_shaderServer.Init(_device))
+		return false;
+
+	if (!_layoutCache.Init(_device))
+		return false;
+
+	if (!_shaderCompiler.Init(_config.shaderCachePath))
+		return false;
+
+	if (!CreateAssetLoader())
+		return false;
+
+	// Half the job threads at most, the rest stay free for the frame's own work
+	if (!_pipelineCompiler.Init(_device, _pipelineCache, _jobs, std::max(1u, _jobs.GetThreadCount() / 2)))
+		return false;
+
+	if (!_pipelineLibrary.Init(_pipelineCompiler, _layoutCache))
+		return false;
+
+	RequestPipelineShaders();
+
+	// Hot reload is a development aid, running without it is fine
+	if (_config.shaderHotReload)
+		_shaderWatcher.Start("res/Shaders", _shaderCompiler);
+
+	if (_config.headless)
+	{
+		if (!CreateOffscreenImages())
+			return false;
+	}
+	else if (!CreateSwapChain())
 		return false;
 
 	if (!CreateImageViews())
@@ -184,32 +351,116 @@ bool VulkanEngine::VulkanApplication::InitVulkan()
 	if (!CreateCommandBuffers())
 		return false;
 
+	if (!CreateParallelRecorder())
+		return false;
+
+	if (!_uploader.Init(_physicalDevice, _device, _allocator, _transferQueue,
+		_queueFamilyIndices.transferFamily.value(), _queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, _useTimeline))
+		return false;
+
+	// Before the compute scheduler, which adds the compute queue's timings
+	if (!_profiler.Init(_physicalDevice, _device, _queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT))
+		return false;
+
+	if (!_computeScheduler.Init(_device, _profiler, _computeQueue, _queueFamilyIndices.computeFamily.value(),
+		_queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, _useTimeline, _config.asyncCompute))
+		return false;
+
+	if (_mesh.IsCreated())
+	{
+		if (!CreateGpuCuller())
+			return false;
+
+		// The batcher repacks every instance each frame, GPU culling keeps them resident instead
+		if (!_useGpuCulling && !_instanceBatcher.Init(_allocator, _jobs, MAX_FRAMES_IN_FLIGHT, _config.instanceCount))
+			return false;
+
+		_useCpuCulling = _config.cpuCulling && !_useGpuCulling;
+		if (_useCpuCulling && !_frustumCuller.Init(_jobs))
+			return false;
+
+		CreateInstances(_config.instanceCount);
+	}
+
 	if (!CreateSyncObjects())
 		return false;
 
+	// Compiled in the background since CreateGraphicsPipeline, waited for only now so the first frame draws
+	if (!_pipelineCompiler.Wait(_graphicsPipeline))
+		return false;
+
+	_pipelineCache.PrintStartupMetrics();
+
 	return true;
 }
 
 void VulkanEngine::VulkanApplication::ShutdownVulkan()
 {
-	CleanupSwapChain();
+	// Run left the device idle, so everything queued can be destroyed right away
+	RetireSwapChain();
+	_deletionQueue.FlushAll();
+
+	// Joined first, a decode worker may still be creating shader modules
+	_assetLoader.PrintStats();
+	_assetLoader.Shutdown();
+
+	_shaderWatcher.Stop();
+
+	_pipelineLibrary.PrintStats();
+	_pipelineLibrary.Shutdown();
 
-	vkDestroyPipeline(_device, _graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+	_pipelineCompiler.PrintStats();
+	_pipelineCompiler.Shutdown();
+	_graphicsPipeline = nullptr;
+	_reloadedPipeline = nullptr;
+
+	_layoutCache.PrintStats();
+	_layoutCache.Shutdown();
+
+	_pipelineShaders.clear();
+	_shaderServer.PrintStats();
+	_shaderServer.Shutdown();
+
+	_shaderCompiler.PrintStats();
+	_shaderCompiler.Shutdown();
+
+	_computeScheduler.PrintStats();
+	_computeScheduler.Shutdown();
+
+	if (_useGpuCulling)
+		_gpuCuller.PrintStats();
+	_gpuCuller.Shutdown();
+	if (_useCpuCulling)
+		_frustumCuller.PrintStats();
+	_instanceBatcher.Shutdown();
+	_mesh.Destroy();
 
 	vkDestroyRenderPass(_device, _renderPass, nullptr);
 
+	_pipelineCache.Shutdown();
+
 	DestroySyncObjects();
 
+	_recorder.Shutdown();
+	_uploader.Shutdown();
+
+	for (auto commandPool : _frameCommandPools)
+		vkDestroyCommandPool(_device, commandPool, nullptr);
 	vkDestroyCommandPool(_device, _commandPool, nullptr);
 
+	_profiler.Shutdown();
+
+	_allocator.PrintStats();
+	_allocator.Shutdown();
+
 	vkDestroyDevice(_device, nullptr);
 
 #ifdef ENABLE_VK_VAL_LAYERS
 	DestroyDebugUtilsMessengerEXT(_instance, _debugMessenger, nullptr);
 #endif // ENABLE_VK_VAL_LAYERS
 
-	vkDestroySurfaceKHR(_instance, _surface, nullptr);
+	if (!_config.headless)
+		vkDestroySurfaceKHR(_instance, _surface, nullptr);
 	vkDestroyInstance(_instance, nullptr);
 
 	fprintf(stdout, "Vulkan Instance destroyed\n");
@@ -223,7 +474,7 @@ bool VulkanEngine::VulkanApplication::CreateVulkanInstance()
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = VK_API_VERSION_1_2;
 
 	auto extensions = GetRequiredExtensions();
 
@@ -256,10 +507,16 @@ bool VulkanEngine::VulkanApplication::CreateVulkanInstance()
 
 std::vector<const char*> VulkanEngine::VulkanApplication::GetRequiredExtensions()
 {
-	UINT32 glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	std::vector<const char*> extensions;
+
+	// Surface extensions are only needed when presenting to a GLFW window
+	if (!_config.headless)
+	{
+		UINT32 glfwExtensionCount = 0;
+		const char** glfwExtensions;
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 #ifdef ENABLE_VK_VAL_LAYERS
 	extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif // ENABLE_VK_VAL_LAYERS
@@ -431,17 +688,20 @@ bool VulkanEngine::VulkanApplication::PickPhysicalDevice()
 	}
 	fprintf(stdout, "Queue Families :\n\t%s\n", _queueFamilyIndices.Print().c_str());
 
-	if (!CheckDeviceExtensionSupport(_physicalDevice))
+	if (!_config.headless)
 	{
-		fprintf(stderr, "No suitable device found to run application");
-		return false;
-	}
+		if (!CheckDeviceExtensionSupport(_physicalDevice))
+		{
+			fprintf(stderr, "No suitable device found to run application");
+			return false;
+		}
 
-	SwapChainSupportDetails details = QuerySwapChainSupport(_physicalDevice, _surface);
-	if (!details.IsAdequate())
-	{
-		fprintf(stderr, "No suitable device found to run application");
-		return false;
+		SwapChainSupportDetails details = QuerySwapChainSupport(_physicalDevice, _surface);
+		if (!details.IsAdequate())
+		{
+			fprintf(stderr, "No suitable device found to run application");
+			return false;
+		}
 	}
 
 	VkPhysicalDeviceProperties deviceProperties;
@@ -497,27 +757,55 @@ VulkanEngine::VulkanApplication::QueueFamilyIndices VulkanEngine::VulkanApplicat
 	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
 
-	UINT32 i = 0;
-	for (const auto& queueFamiy : queueFamilies)
+	// Transfer candidates ranked from least to most shared with rendering work
+	std::optional<UINT32> dedicatedTransferFamily;
+	std::optional<UINT32> nonGraphicsTransferFamily;
+
+	for (UINT32 i = 0; i < queueFamilyCount; i++)
 	{
-		if (queueFamiy.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		const VkQueueFlags flags = queueFamilies[i].queueFlags;
+
+		if ((flags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value())
 			indices.graphicsFamily = i;
 
-		if (queueFamiy.queueFlags & VK_QUEUE_COMPUTE_BIT)
+		// A compute family without graphics lets compute passes run next to the graphics queue
+		if ((flags & VK_QUEUE_COMPUTE_BIT) && (!indices.computeFamily.has_value()
+			|| (!(flags & VK_QUEUE_GRAPHICS_BIT) && indices.computeFamily == indices.graphicsFamily)))
 			indices.computeFamily = i;
 
+		// Graphics and compute families implicitly support transfer
+		if (!(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_COMPUTE_BIT) && !dedicatedTransferFamily.has_value())
+				dedicatedTransferFamily = i;
+			else if ((flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) && !nonGraphicsTransferFamily.has_value())
+				nonGraphicsTransferFamily = i;
+		}
+
+		// Without a surface nothing is presented, the graphics family stands in for presentation
+		if (_config.headless)
+			continue;
+
 		VkBool32 presentationSupport = VK_FALSE;
 		if (vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, _surface, &presentationSupport) != VK_SUCCESS)
 			fprintf(stderr, "Unable to check presentation support");
-		else
-			if (presentationSupport == VK_TRUE)
+		else if (presentationSupport == VK_TRUE)
+		{
+			// Presenting from the graphics family avoids sharing swap chain images across families
+			if (!indices.presentationFamily.has_value() || i == indices.graphicsFamily)
 				indices.presentationFamily = i;
+		}
+	}
 
-		if (indices.IsComplete())
-			break;
+	if (_config.headless)
+		indices.presentationFamily = indices.graphicsFamily;
 
-		i++;
-	}
+	if (dedicatedTransferFamily.has_value())
+		indices.transferFamily = dedicatedTransferFamily;
+	else if (nonGraphicsTransferFamily.has_value())
+		indices.transferFamily = nonGraphicsTransferFamily;
+	else
+		indices.transferFamily = indices.graphicsFamily;
 
 	return indices;
 }
@@ -528,7 +816,8 @@ void VulkanEngine::VulkanApplication::QueueFamilyIndices::GetCreateInfos(std::ve
 	{
 		graphicsFamily.value(),
 		computeFamily.value(),
-		presentationFamily.value()
+		presentationFamily.value(),
+		transferFamily.value()
 	};
 
 	float queuePriority = 1.f;
@@ -552,13 +841,28 @@ bool VulkanEngine::VulkanApplication::CreateLogicalDevice()
 
 	VkPhysicalDeviceFeatures deviceFeatures{};
 
+	_useTimeline = _config.syncBackend == SyncBackend::Timeline && TimelineSemaphore::IsSupported(_physicalDevice);
+	if (_config.syncBackend == SyncBackend::Timeline && !_useTimeline)
+		fprintf(stdout, "Timeline semaphores are not supported, falling back to fences\n");
+
+	// GPU culling draws through indirect buffers, whatever subset the device has is enabled
+	_indirectSupport = GpuCuller::QuerySupport(_physicalDevice);
+	deviceFeatures.drawIndirectFirstInstance = _indirectSupport.firstInstance ? VK_TRUE : VK_FALSE;
+	deviceFeatures.multiDrawIndirect = _indirectSupport.multiDraw ? VK_TRUE : VK_FALSE;
+
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features12.timelineSemaphore = _useTimeline ? VK_TRUE : VK_FALSE;
+	features12.drawIndirectCount = _indirectSupport.drawCount ? VK_TRUE : VK_FALSE;
+
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = _useTimeline || _indirectSupport.drawCount ? &features12 : nullptr;
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	createInfo.enabledExtensionCount = _config.headless ? 0 : static_cast<uint32_t>(deviceExtensions.size());
+	createInfo.ppEnabledExtensionNames = _config.headless ? nullptr : deviceExtensions.data();
 #ifdef ENABLE_VK_VAL_LAYERS
 	createInfo.enabledLayerCount = static_cast<UINT32>(_validationLayers.size());
 	createInfo.ppEnabledLayerNames = _validationLayers.data();
@@ -573,6 +877,7 @@ bool VulkanEngine::VulkanApplication::CreateLogicalDevice()
 	vkGetDeviceQueue(_device, _queueFamilyIndices.graphicsFamily.value(), 0, &_graphicsQueue);
 	vkGetDeviceQueue(_device, _queueFamilyIndices.computeFamily.value(), 0, &_computeQueue);
 	vkGetDeviceQueue(_device, _queueFamilyIndices.presentationFamily.value(), 0, &_presentationQueue);
+	vkGetDeviceQueue(_device, _queueFamilyIndices.transferFamily.value(), 0, &_transferQueue);
 
 	fprintf(stdout, "Created Logical Device\n");
 	return true;
@@ -683,10 +988,24 @@ VkExtent2D VulkanEngine::VulkanApplication::ChooseSwapExtent(const VkSurfaceCapa
 
 VkPresentModeKHR VulkanEngine::VulkanApplication::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
 {
-	for (const auto& availablePresentMode : availablePresentModes)
+	std::vector<VkPresentModeKHR> preferredModes;
+
+	switch (_config.presentPolicy)
+	{
+	case PresentPolicy::LowestLatency:
+		preferredModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+		break;
+	case PresentPolicy::HighestThroughput:
+		preferredModes = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+		break;
+	case PresentPolicy::PowerSaving:
+		break;
+	}
+
+	for (VkPresentModeKHR preferredMode : preferredModes)
 	{
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-			return availablePresentMode;
+		if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferredMode) != availablePresentModes.end())
+			return preferredMode;
 	}
 
 	// This mode is always present and guaranteed to be available
@@ -706,7 +1025,7 @@ VkSurfaceFormatKHR VulkanEngine::VulkanApplication::ChooseSwapSurfaceFormat(cons
 	return availableFormats[0];
 }
 
-bool VulkanEngine::VulkanApplication::CreateSwapChain()
+bool VulkanEngine::VulkanApplication::CreateSwapChain(VkSwapchainKHR oldSwapChain)
 {
 	SwapChainSupportDetails details = QuerySwapChainSupport(_physicalDevice, _surface);
 
@@ -719,15 +1038,23 @@ bool VulkanEngine::VulkanApplication::CreateSwapChain()
 	// this count can be increased based on the hardware capabilities
 	UINT32 imageCount = details.capabilities.minImageCount + 1;
 
+	// Deeper chains trade latency for throughput, the driver minimum is the floor
+	if (_config.swapchainImages > 0)
+		imageCount = std::max(_config.swapchainImages, details.capabilities.minImageCount);
+
 	// maxImageCount = 0 means, there is no limit
-	// If minImageCount + 1 exceeds maxImageCount we use that instead
+	// If the requested count exceeds maxImageCount we use that instead
 	if (details.capabilities.maxImageCount > 0
 		&&
 		imageCount > details.capabilities.maxImageCount)
 		imageCount = details.capabilities.maxImageCount;
 
-	std::vector<UINT32> queueIndices(_queueFamilyIndices.GetSize());
-	_queueFamilyIndices.GetIndices(queueIndices);
+	// Only the families that touch swap chain images matter, transfer never does
+	std::vector<UINT32> queueIndices
+	{
+		_queueFamilyIndices.graphicsFamily.value(),
+		_queueFamilyIndices.presentationFamily.value()
+	};
 
 	VkSwapchainCreateInfoKHR createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -739,7 +1066,7 @@ bool VulkanEngine::VulkanApplication::CreateSwapChain()
 	createInfo.imageArrayLayers = 1;
 	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-	if ((queueIndices[0] != queueIndices[1]) != queueIndices[2])
+	if (queueIndices[0] != queueIndices[1])
 	{
 		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
 		createInfo.queueFamilyIndexCount = static_cast<UINT32>(queueIndices.size());
@@ -756,7 +1083,8 @@ bool VulkanEngine::VulkanApplication::CreateSwapChain()
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	// Handing over the old chain lets the driver reuse its resources and keeps presentation going
+	createInfo.oldSwapchain = oldSwapChain;
 
 	if (vkCreateSwapchainKHR(_device, &createInfo, nullptr, &_swapChain) != VK_SUCCESS)
 	{
@@ -772,7 +1100,130 @@ bool VulkanEngine::VulkanApplication::CreateSwapChain()
 	_swapChainImageFormat = createInfo.imageFormat;
 	_swapChainExtent = createInfo.imageExtent;
 
-	fprintf(stdout, "Created Swap Chain\n");
+	fprintf(stdout, "Created Swap Chain (%d images, present mode %d, %s)\n",
+		imageCount, presentMode, RenderConfig::GetPresentPolicyName(_config.presentPolicy));
+	return true;
+}
+
+#pragma endregion
+
+#pragma region Offscreen
+
+bool VulkanEngine::VulkanApplication::CreateOffscreenImages()
+{
+	_swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	_swapChainExtent = { _config.width, _config.height };
+
+	_images.resize(_framesInFlight);
+	_offscreenAllocations.resize(_framesInFlight);
+
+	for (UINT32 i = 0; i < _images.size(); i++)
+	{
+		VkImageCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		createInfo.imageType = VK_IMAGE_TYPE_2D;
+		createInfo.format = _swapChainImageFormat;
+		createInfo.extent = { _swapChainExtent.width, _swapChainExtent.height, 1 };
+		createInfo.mipLevels = 1;
+		createInfo.arrayLayers = 1;
+		createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		createInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (!_allocator.CreateImage(createInfo, MemoryUsage::GpuOnly, _images[i], _offscreenAllocations[i]))
+		{
+			fprintf(stderr, "Failed to create Offscreen Image\n");
+			return false;
+		}
+	}
+
+	fprintf(stdout, "Created %zu Offscreen Images\n", _images.size());
+	return true;
+}
+
+bool VulkanEngine::VulkanApplication::SaveCapture(UINT32 imageIndex, const std::string& path)
+{
+	VkDeviceSize size = static_cast<VkDeviceSize>(_swapChainExtent.width) * _swapChainExtent.height * 4;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkBuffer readbackBuffer;
+	Allocation readbackAllocation;
+	if (!_allocator.CreateBuffer(bufferInfo, MemoryUsage::GpuToCpu, readbackBuffer, readbackAllocation))
+	{
+		fprintf(stderr, "Failed to create Readback Buffer\n");
+		return false;
+	}
+
+	VkCommandBufferAllocateInfo commandBufferInfo{};
+	commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferInfo.commandPool = _commandPool;
+	commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	vkAllocateCommandBuffers(_device, &commandBufferInfo, &commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	// Render pass already left the image in transfer source layout,
+	// this only makes its color writes visible to the copy
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = _images[imageIndex];
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region{};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { _swapChainExtent.width, _swapChainExtent.height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, _images[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(_graphicsQueue);
+
+	vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
+
+	_allocator.Invalidate(readbackAllocation);
+
+	// Binary PPM keeps the capture dependency free, alpha is dropped
+	std::ofstream file(path, std::ios::binary);
+	file << "P6\n" << _swapChainExtent.width << " " << _swapChainExtent.height << "\n255\n";
+
+	const UINT8* pixels = static_cast<const UINT8*>(readbackAllocation.mapped);
+	for (VkDeviceSize i = 0; i < size; i += 4)
+		file.write(reinterpret_cast<const char*>(pixels + i), 3);
+
+	_allocator.DestroyBuffer(readbackBuffer, readbackAllocation);
+
+	if (!file)
+	{
+		fprintf(stderr, "Failed to write capture to %s\n", path.c_str());
+		return false;
+	}
+
+	fprintf(stdout, "Saved capture to %s\n", path.c_str());
 	return true;
 }
 
@@ -815,13 +1266,18 @@ bool VulkanEngine::VulkanApplication::CreateImageViews()
 
 bool VulkanEngine::VulkanApplication::ReCreateSwapChain()
 {
-	_window.get()->WaitForMaximization();
+	_swapChainDirty = false;
 
-	vkDeviceWaitIdle(_device);
+	if (!_config.headless)
+		_window.get()->WaitForMaximization();
 
-	CleanupSwapChain();
+	// Still alive until the deletion queue runs, so the driver can hand its resources over
+	VkSwapchainKHR oldSwapChain = _swapChain;
 
-	if (!CreateSwapChain() || !CreateImageViews() || !CreateFrameBuffers())
+	RetireSwapChain();
+
+	bool imagesCreated = _config.headless ? CreateOffscreenImages() : CreateSwapChain(oldSwapChain);
+	if (!imagesCreated || !CreateImageViews() || !CreateFrameBuffers())
 	{
 		fprintf(stderr, "Swap chain recreation failed\n");
 		return false;
@@ -830,15 +1286,86 @@ bool VulkanEngine::VulkanApplication::ReCreateSwapChain()
 	return true;
 }
 
-void VulkanEngine::VulkanApplication::CleanupSwapChain()
+bool VulkanEngine::VulkanApplication::ApplyRenderSettings(const RenderConfig& settings)
+{
+	_config.framesInFlight = std::clamp(settings.framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+	_config.swapchainImages = settings.swapchainImages;
+	_config.presentPolicy = settings.presentPolicy;
+
+	if (settings.shaderFeatures != _config.shaderFeatures)
+	{
+		_config.shaderFeatures = settings.shaderFeatures;
+		SelectShaderVariant();
+	}
+
+	fprintf(stdout, "Applying render settings : %d frames in flight, %d swap chain images, %s\n",
+		_config.framesInFlight, _config.swapchainImages, RenderConfig::GetPresentPolicyName(_config.presentPolicy));
+
+	// Every slot has to be free before the ring of frames can restart at 0 with a new length
+	WaitForFrameValue(_frameValue);
+
+	_framesInFlight = _config.framesInFlight;
+	_currentFrame = 0;
+
+	return ReCreateSwapChain();
+}
+
+void VulkanEngine::VulkanApplication::PollConfigFile()
+{
+	if (_config.configPath.empty())
+		return;
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - _lastConfigPoll < std::chrono::seconds(1))
+		return;
+	_lastConfigPoll = now;
+
+	std::error_code error;
+	auto writeTime = std::filesystem::last_write_time(_config.configPath, error);
+	if (error || writeTime == _configWriteTime)
+		return;
+	_configWriteTime = writeTime;
+
+	RenderConfig settings = _config;
+	if (RenderConfig::LoadFile(_config.configPath, settings))
+		ApplyRenderSettings(settings);
+}
+
+void VulkanEngine::VulkanApplication::RequestSwapChainRecreation()
 {
-	for (auto frameBuffer : _frameBuffers)
-		vkDestroyFramebuffer(_device, frameBuffer, nullptr);
+	_swapChainDirty = true;
+	_swapChainDirtyTime = std::chrono::steady_clock::now();
+}
+
+void VulkanEngine::VulkanApplication::RetireSwapChain()
+{
+	// Offscreen images are owned by the allocator, swap chain images by the swap chain
+	_deletionQueue.Push(_frameValue,
+		[this,
+		swapChain = _swapChain,
+		imageViews = std::move(_imageViews),
+		frameBuffers = std::move(_frameBuffers),
+		offscreenImages = _config.headless ? std::move(_images) : std::vector<VkImage>(),
+		offscreenAllocations = std::move(_offscreenAllocations)]() mutable
+		{
+			for (auto frameBuffer : frameBuffers)
+				vkDestroyFramebuffer(_device, frameBuffer, nullptr);
 
-	for (auto imageView : _imageViews)
-		vkDestroyImageView(_device, imageView, nullptr);
+			for (auto imageView : imageViews)
+				vkDestroyImageView(_device, imageView, nullptr);
 
-	vkDestroySwapchainKHR(_device, _swapChain, nullptr);
+			for (size_t i = 0; i < offscreenAllocations.size(); i++)
+				_allocator.DestroyImage(offscreenImages[i], offscreenAllocations[i]);
+
+			if (swapChain != VK_NULL_HANDLE)
+				vkDestroySwapchainKHR(_device, swapChain, nullptr);
+		});
+
+	_swapChain = VK_NULL_HANDLE;
+	_images.clear();
+	_imageViews.clear();
+	_frameBuffers.clear();
+	_offscreenAllocations.clear();
 }
 
 #pragma endregion
@@ -855,7 +1382,8 @@ bool VulkanEngine::VulkanApplication::CreateRenderPass()
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// Offscreen images are only ever read back, swap chain images are handed to the presentation engine
+	colorAttachment.finalLayout = _config.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkAttachmentReference colorAttachmentRef{};
 	colorAttachmentRef.attachment = 0; // index of attachment
@@ -897,192 +1425,226 @@ bool VulkanEngine::VulkanApplication::CreateRenderPass()
 
 #pragma region Graphics Pipeline
 
-bool VulkanEngine::VulkanApplication::CreateGraphicsPipeline()
+void VulkanEngine::VulkanApplication::RequestPipelineShaders()
 {
-	// Shader
-	std::vector<char> vertCode = ReadFile("res/Shaders/Triangle.vert.spv");
+	const char* trianglePaths[] =
+	{
+		"res/Shaders/Triangle.vert",
+		"res/Shaders/Triangle.frag"
+	};
 
-	VkShaderModuleCreateInfo vertShaderCreateInfo{};
-	vertShaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	vertShaderCreateInfo.codeSize = vertCode.size();
-	vertShaderCreateInfo.pCode = reinterpret_cast<const UINT32*>(vertCode.data());
+	const char* meshPaths[] =
+	{
+		"res/Shaders/Mesh.vert",
+		"res/Shaders/Mesh.frag"
+	};
 
-	if (vkCreateShaderModule(_device, &vertShaderCreateInfo, nullptr, &_vertShaderModule) != VK_SUCCESS)
-		throw std::runtime_error("failed to create shader module!");
+	const char** paths = _mesh.IsCreated() ? meshPaths : trianglePaths;
 
-	std::vector<char> fragCode = ReadFile("res/Shaders/Triangle.frag.spv");
+	// Held for as long as the pipeline exists so a rebuild finds the modules cached
+	_pipelineShaders.assign(ARRAYSIZE(trianglePaths), nullptr);
+	_pendingShaderLoads.clear();
 
-	VkShaderModuleCreateInfo fragShaderCreateInfo{};
-	fragShaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	fragShaderCreateInfo.codeSize = fragCode.size();
-	fragShaderCreateInfo.pCode = reinterpret_cast<const UINT32*>(fragCode.data());
+	for (size_t i = 0; i < _pipelineShaders.size(); i++)
+	{
+		AssetRequest request;
+		request.path = paths[i];
+		request.access = FileAccess::WillNeed;
 
-	if (vkCreateShaderModule(_device, &fragShaderCreateInfo, nullptr, &_fragShaderModule) != VK_SUCCESS)
-		throw std::runtime_error("failed to create shader module!");
+		// Each request writes only its own slot, waiting on the future publishes it to the main thread
+		request.decode = [this, i](AssetData& data)
+		{
+			// A warm start finds the optimized SPIR-V in the shader cache and skips the compiler
+			std::vector<UINT32> spirv;
+			if (!_shaderCompiler.Compile(data.path, data.file.GetData(), data.file.GetSize(), {}, spirv))
+				return false;
 
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = _vertShaderModule;
-	vertShaderStageInfo.pName = "main";
+			_pipelineShaders[i] = _shaderServer.Load(data.path, spirv.data(), spirv.size() * sizeof(UINT32));
+			return _pipelineShaders[i] != nullptr;
+		};
 
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module = _fragShaderModule;
-	fragShaderStageInfo.pName = "main";
+		_pendingShaderLoads.push_back(_assetLoader.Load(std::move(request)));
+	}
+}
 
-	VkPipelineShaderStageCreateInfo shaderStages[] =
+bool VulkanEngine::VulkanApplication::CreateGraphicsPipeline()
+{
+	// Shader, decoded on the job system, which has no workers of its own with --job-threads 0
+	for (std::future<AssetResult>& load : _pendingShaderLoads)
 	{
-		vertShaderStageInfo,
-		fragShaderStageInfo
-	};
+		while (load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			if (!_jobs.RunOne())
+				std::this_thread::yield();
+	}
+	_pendingShaderLoads.clear();
 
-	// Vertex Input
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
-
-	// Input Assembly - structure of input
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-	// Dynamic Render states
-	std::vector<VkDynamicState> dynamicStates =
-	{
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR
-	};
+	SPTR<Shader> vertShader = _pipelineShaders[0];
+	SPTR<Shader> fragShader = _pipelineShaders[1];
 
-	VkPipelineDynamicStateCreateInfo dynamicState{};
-	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicState.dynamicStateCount = static_cast<UINT32>(dynamicStates.size());
-	dynamicState.pDynamicStates = dynamicStates.data();
+	if (vertShader == nullptr || fragShader == nullptr)
+	{
+		fprintf(stderr, "Failed to load Graphics Pipeline shaders\n");
+		return false;
+	}
 
-	// Viewport And Scissors
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)_swapChainExtent.width;
-	viewport.height = (float)_swapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = _swapChainExtent;
-
-	VkPipelineViewportStateCreateInfo viewportState{};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	viewportState.scissorCount = 1;
-
-	// Rasterizer
-	VkPipelineRasterizationStateCreateInfo rasterizer{};
-	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer.depthClampEnable = VK_FALSE;
-	rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rasterizer.depthBiasEnable = VK_FALSE;
-	rasterizer.depthBiasClamp = 0;
-	rasterizer.depthBiasConstantFactor = 0;
-	rasterizer.depthBiasSlopeFactor = 0;
-	rasterizer.lineWidth = 1.f;
-
-	// Multisampling
-	VkPipelineMultisampleStateCreateInfo multisampling{};
-	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	multisampling.minSampleShading = 1.0f; // Optional
-	multisampling.pSampleMask = nullptr; // Optional
-	multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
-	multisampling.alphaToOneEnable = VK_FALSE; // Optional
-
-	// Color Blending
-	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_TRUE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA; // Optional
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA; // Optional
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
-
-	// Blending working
-	//	if (blendEnable)
-	//	{
-	//		finalColor.rgb = (srcColorBlendFactor * newColor.rgb) <colorBlendOp> (dstColorBlendFactor * oldColor.rgb);
-	//		finalColor.a = (srcAlphaBlendFactor * newColor.a) <alphaBlendOp> (dstAlphaBlendFactor * oldColor.a);
-	//	}
-	//	else
-	//		finalColor = newColor;
-	//	finalColor = finalColor & colorWriteMask;
-
-	VkPipelineColorBlendStateCreateInfo colorBlending{};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-	colorBlending.attachmentCount = 1;
-	colorBlending.pAttachments = &colorBlendAttachment;
-	colorBlending.blendConstants[0] = 0.0f; // Optional
-	colorBlending.blendConstants[1] = 0.0f; // Optional
-	colorBlending.blendConstants[2] = 0.0f; // Optional
-	colorBlending.blendConstants[3] = 0.0f; // Optional
-
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 0; // Optional
-	pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
-	pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-	pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-	if (vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS)
+	// Materials declaring the same interface share one layout, so switching between them keeps bound sets valid
+	_pipelineLayout = _layoutCache.GetPipelineLayout(_pipelineShaders);
+	if (_pipelineLayout == VK_NULL_HANDLE)
 	{
 		fprintf(stderr, "Failed to create Graphic Pipeline Layout\n");
 		return false;
 	}
 
-	VkGraphicsPipelineCreateInfo pipelineInfo{};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &inputAssembly;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pRasterizationState = &rasterizer;
-	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pDepthStencilState = nullptr;
-	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pTessellationState = nullptr;
-	pipelineInfo.pDynamicState = &dynamicState;
-	pipelineInfo.layout = _pipelineLayout;
-	pipelineInfo.renderPass = _renderPass;
-	pipelineInfo.subpass = 0; // index of subpass
-	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-	pipelineInfo.basePipelineIndex = -1;
-
-	if (vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_graphicsPipeline) != VK_SUCCESS)
-	{
-		fprintf(stderr, "Failed to create Graphic Pipeline");
-		return false;
-	}
+	_graphicsPipeline = CompileGraphicsPipeline(_pipelineShaders, nullptr);
+
+	// Variants the config expects to switch to compile alongside, off the critical path
+	std::vector<SpecializationConstants> variants;
+	for (UINT32 bits : _config.prewarmVariants)
+		variants.push_back(GetShaderSpecialization(bits));
 
-	vkDestroyShaderModule(_device, _vertShaderModule, nullptr);
-	vkDestroyShaderModule(_device, _fragShaderModule, nullptr);
+	UINT32 prewarmed = _pipelineLibrary.Prewarm(GetGraphicsPipelineDesc(_pipelineShaders), variants, GetGraphicsPipelineName());
 
-	fprintf(stdout, "Created Graphics Pipeline\n");
+	fprintf(stdout, "Requested Graphics Pipeline, %u of %llu variants prewarmed\n",
+		prewarmed, static_cast<unsigned long long>(TriangleFeatures::VARIANT_COUNT));
 	return true;
 }
 
+void VulkanEngine::VulkanApplication::ReloadShaders()
+{
+	// Swapped before anything of this frame is recorded, frames still in flight keep the old pipeline alive
+	if (_reloadedPipeline != nullptr && _reloadedPipeline->GetStatus() != PipelineStatus::Pending)
+	{
+		if (_reloadedPipeline->IsReady())
+		{
+			fprintf(stdout, "Reloaded Graphics Pipeline in %.3f ms\n", _reloadedPipeline->GetCompileTime());
+			_pipelineLayout = _reloadedPipeline->GetLayout();
+			_pipelineLibrary.Evict(_graphicsPipeline);
+			_pipelineCompiler.Replace(_graphicsPipeline, _reloadedPipeline, _deletionQueue, _frameValue);
+		}
+		else
+		{
+			_pipelineLibrary.Evict(_reloadedPipeline);
+			_pipelineCompiler.Retire(_reloadedPipeline, _deletionQueue, _frameValue);
+		}
+
+		_reloadedPipeline = nullptr;
+	}
+
+	std::vector<CompiledShader> changed = _shaderWatcher.PollChanges();
+	if (changed.empty())
+		return;
+
+	// Only a pipeline built from one of the recompiled sources is rebuilt, from the SPIR-V the
+	// watcher thread produced. Unchanged stages keep their module, nothing compiles on this thread
+	bool affected = false;
+	std::vector<SPTR<Shader>> shaders;
+	for (const SPTR<Shader>& shader : _pipelineShaders)
+	{
+		std::error_code error;
+		std::string path = std::filesystem::weakly_canonical(shader->GetPath(), error).string();
+
+		auto compiled = std::find_if(changed.begin(), changed.end(), [&path](const CompiledShader& source) { return source.path == path; });
+		if (compiled == changed.end())
+		{
+			shaders.push_back(shader);
+			continue;
+		}
+
+		SPTR<Shader> reloaded = _shaderServer.Load(shader->GetPath(), compiled->spirv.data(), compiled->spirv.size() * sizeof(UINT32));
+		if (reloaded == nullptr)
+			return;
+
+		shaders.push_back(reloaded);
+		affected = true;
+	}
+
+	if (!affected)
+		return;
+
+	// A rebuild still compiling is outdated now
+	if (_reloadedPipeline != nullptr)
+	{
+		_pipelineLibrary.Evict(_reloadedPipeline);
+		_pipelineCompiler.Retire(_reloadedPipeline, _deletionQueue, _frameValue);
+	}
+
+	_pipelineShaders = shaders;
+	_reloadedPipeline = CompileGraphicsPipeline(_pipelineShaders, _graphicsPipeline);
+
+	// Saved without a change that reaches the SPIR-V, the library hands back the current pipeline
+	if (_reloadedPipeline == _graphicsPipeline)
+		_reloadedPipeline = nullptr;
+}
+
+VulkanEngine::PipelineHandle VulkanEngine::VulkanApplication::CompileGraphicsPipeline(const std::vector<SPTR<Shader>>& shaders, PipelineHandle fallback)
+{
+	// A desc seen before returns its pipeline without a compile, new ones draw with the fallback until ready
+	return _pipelineLibrary.GetGraphics(GetGraphicsPipelineDesc(shaders), GetGraphicsPipelineName(), fallback);
+}
+
+VulkanEngine::PipelineDesc VulkanEngine::VulkanApplication::GetGraphicsPipelineDesc(const std::vector<SPTR<Shader>>& shaders) const
+{
+	PipelineDesc desc;
+	desc.shaders = shaders;
+	desc.specialization = GetShaderSpecialization(_config.shaderFeatures);
+	desc.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	desc.cullMode = VK_CULL_MODE_BACK_BIT;
+	desc.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	desc.blend = { BlendState::AlphaBlend() };
+	desc.renderPass = _renderPass;
+	desc.subpass = 0;
+
+	if (_mesh.IsCreated())
+	{
+		desc.vertexLayout = _mesh.GetFormat().GetLayout();
+		InstanceBatcher::AddInstanceLayout(desc.vertexLayout);
+		desc.blend = { BlendState::Opaque() };
+	}
+
+	return desc;
+}
+
+VulkanEngine::SpecializationConstants VulkanEngine::VulkanApplication::GetShaderSpecialization(UINT32 featureBits) const
+{
+	SpecializationConstants specialization = TriangleFeatures(featureBits).ToSpecialization();
+
+	// Mesh.vert decodes bounds relative positions and octahedral normals only when told to, each on its own
+	if (_mesh.IsCreated())
+	{
+		const VertexFormat& format = _mesh.GetFormat();
+		specialization.SetBool(MESH_SNORM_POSITION_CONSTANT_ID, format.GetEncoding(VertexSemantic::Position) == VertexEncoding::Snorm16);
+		specialization.SetBool(MESH_OCTAHEDRAL_NORMAL_CONSTANT_ID, format.GetEncoding(VertexSemantic::Normal) == VertexEncoding::Octahedral16);
+	}
+
+	return specialization;
+}
+
+const char* VulkanEngine::VulkanApplication::GetGraphicsPipelineName() const
+{
+	return _mesh.IsCreated() ? "Mesh" : "Triangle";
+}
+
+void VulkanEngine::VulkanApplication::SelectShaderVariant()
+{
+	// Variants stay cached in the library, the one switched away from is kept for switching back.
+	// A variant that wasn't prewarmed, or fails to compile, draws with the current pipeline meanwhile
+	if (_reloadedPipeline != nullptr)
+	{
+		// Built for the previous features, the variant below already uses the reloaded shaders
+		_pipelineLibrary.Evict(_reloadedPipeline);
+		_pipelineCompiler.Retire(_reloadedPipeline, _deletionQueue, _frameValue);
+		_reloadedPipeline = nullptr;
+	}
+
+	PipelineHandle variant = CompileGraphicsPipeline(_pipelineShaders, _graphicsPipeline);
+	if (variant == nullptr || variant == _graphicsPipeline)
+		return;
+
+	fprintf(stdout, "Switched to shader variant %u (%s)\n", _config.shaderFeatures, variant->IsReady() ? "ready" : "compiling");
+	_graphicsPipeline = variant;
+	_pipelineLayout = variant->GetLayout();
+}
+
 bool VulkanEngine::VulkanApplication::CreateFrameBuffers()
 {
 	_frameBuffers.resize(_imageViews.size());
@@ -1119,9 +1681,10 @@ bool VulkanEngine::VulkanApplication::CreateCommandPool()
 {
 	QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(_physicalDevice);
 
+	// Shared pool only serves one time command buffers outside the frame loop
 	VkCommandPoolCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 	createInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
 
 
@@ -1131,6 +1694,17 @@ bool VulkanEngine::VulkanApplication::CreateCommandPool()
 		return false;
 	}
 
+	// Every frame in flight gets its own pool so all of its buffers can be
+	// reset with a single vkResetCommandPool once the frame fence is signaled
+	for (UINT8 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (vkCreateCommandPool(_device, &createInfo, nullptr, &_frameCommandPools[i]) != VK_SUCCESS)
+		{
+			fprintf(stderr, "Failed to create Frame Command Pool");
+			return false;
+		}
+	}
+
 	fprintf(stdout, "Created Command Pool\n");
 
 	return true;
@@ -1138,22 +1712,60 @@ bool VulkanEngine::VulkanApplication::CreateCommandPool()
 
 bool VulkanEngine::VulkanApplication::CreateCommandBuffers()
 {
-	VkCommandBufferAllocateInfo allocateInfo{};
-	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocateInfo.commandPool = _commandPool;
-	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocateInfo.commandBufferCount = static_cast<UINT32>(_commandBuffers.size());
-
-	if (vkAllocateCommandBuffers(_device, &allocateInfo, _commandBuffers.data()) != VK_SUCCESS)
+	for (UINT8 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		fprintf(stderr, "Failed to create Command Buffer");
-		return false;
+		VkCommandBufferAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = _frameCommandPools[i];
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(_device, &allocateInfo, &_commandBuffers[i]) != VK_SUCCESS)
+		{
+			fprintf(stderr, "Failed to create Command Buffer");
+			return false;
+		}
 	}
 
 	fprintf(stdout, "Created Command Buffer\n");
 	return true;
 }
 
+bool VulkanEngine::VulkanApplication::CreateJobSystem()
+{
+	UINT32 workerThreads = _config.jobThreads >= 0
+		? static_cast<UINT32>(_config.jobThreads)
+		: std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	return _jobs.Init(workerThreads);
+}
+
+bool VulkanEngine::VulkanApplication::CreateAssetLoader()
+{
+	return _assetLoader.Init(_jobs, _config.ioThreads);
+}
+
+bool VulkanEngine::VulkanApplication::CreateParallelRecorder()
+{
+	UINT32 sliceCount = _config.recordThreads >= 0
+		? static_cast<UINT32>(_config.recordThreads)
+		: _jobs.GetThreadCount();
+
+	// Stand in draw list until scenes exist, --draws repeats the triangle to stress recording
+	_drawList.assign(_config.drawCount, DrawCommand{ 3, 1, 0, 0 });
+
+	if (sliceCount == 0)
+		return true;
+
+	return _recorder.Init(_device, _queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, _jobs, sliceCount);
+}
+
+void VulkanEngine::VulkanApplication::ResetFrameCommandPools()
+{
+	vkResetCommandPool(_device, _frameCommandPools[_currentFrame], 0);
+	_recorder.BeginFrame(_currentFrame);
+}
+
 bool VulkanEngine::VulkanApplication::RecordCommandBuffer(VkCommandBuffer commandBuffer)
 {
 	VkCommandBufferBeginInfo cbBeginInfo{};
@@ -1168,7 +1780,7 @@ bool VulkanEngine::VulkanApplication::EndRecordCommandBuffer(VkCommandBuffer com
 	return vkEndCommandBuffer(commandBuffer) != VK_SUCCESS;
 }
 
-void VulkanEngine::VulkanApplication::BeginRenderPass(VkCommandBuffer commandBuffer, UINT32 imageIndex)
+void VulkanEngine::VulkanApplication::BeginRenderPass(VkCommandBuffer commandBuffer, UINT32 imageIndex, VkSubpassContents contents)
 {
 	VkRenderPassBeginInfo rpBeginInfo{};
 	rpBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -1178,7 +1790,7 @@ void VulkanEngine::VulkanApplication::BeginRenderPass(VkCommandBuffer commandBuf
 	rpBeginInfo.renderArea.extent = _swapChainExtent;
 	rpBeginInfo.clearValueCount = 1;
 	rpBeginInfo.pClearValues = &clearColor;
-	vkCmdBeginRenderPass(commandBuffer, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(commandBuffer, &rpBeginInfo, contents);
 }
 
 void VulkanEngine::VulkanApplication::EndRenderPass(VkCommandBuffer commandBuffer)
@@ -1186,9 +1798,14 @@ void VulkanEngine::VulkanApplication::EndRenderPass(VkCommandBuffer commandBuffe
 	vkCmdEndRenderPass(commandBuffer);
 }
 
-void VulkanEngine::VulkanApplication::BindPipeline(VkCommandBuffer commandBuffer)
+bool VulkanEngine::VulkanApplication::BindPipeline(VkCommandBuffer commandBuffer)
 {
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+	VkPipeline pipeline = _graphicsPipeline != nullptr ? _graphicsPipeline->Resolve() : VK_NULL_HANDLE;
+	if (pipeline == VK_NULL_HANDLE)
+		return false;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	return true;
 }
 
 void VulkanEngine::VulkanApplication::SetupViewport(VkCommandBuffer commandBuffer)
@@ -1215,18 +1832,489 @@ void VulkanEngine::VulkanApplication::Draw(VkCommandBuffer commandBuffer, UINT32
 {
 	if (RecordCommandBuffer(commandBuffer))
 		throw std::runtime_error("Failed to begin recording Command Buffer");
-	BeginRenderPass(commandBuffer, imageIndex);
-	BindPipeline(commandBuffer);
-	SetupViewport(commandBuffer);
-	SetupScissor(commandBuffer);
+	_profiler.WriteBeginTimestamp(commandBuffer, _currentFrame);
+
+	_uploader.RecordAcquireBarriers(commandBuffer, _currentFrame);
+
+	// Mesh mode draws one instanced batch per mesh and material instead of the draw list,
+	// with GPU culling the cull pass writes the draws and a single indirect call issues them
+	size_t drawCount = _mesh.IsCreated() ? _instanceBatcher.GetBatches().size() : _drawList.size();
+	if (_useGpuCulling)
+		drawCount = 1;
+
+	// Compute passes the scheduler didn't send to the compute queue run ahead of the render pass
+	_computeScheduler.RecordInline(commandBuffer, _currentFrame);
+
+	// Handing out slices only pays off once the draw list outweighs the thread wake up cost
+	bool recordParallel = _recorder.GetSliceCount() > 0 && drawCount >= PARALLEL_RECORD_THRESHOLD;
 
-	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	if (recordParallel)
+	{
+		BeginRenderPass(commandBuffer, imageIndex, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = _renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = _frameBuffers[imageIndex];
+
+		bool recorded = _recorder.Record(
+			_currentFrame,
+			inheritanceInfo,
+			drawCount,
+			[this](VkCommandBuffer secondaryBuffer, size_t begin, size_t end)
+			{
+				RecordDraws(secondaryBuffer, begin, end);
+			});
+
+		// Same as the inline path, a frame missing slices of its draws is never presented
+		if (!recorded)
+			throw std::runtime_error("Failed to record Secondary Command Buffers");
+
+		const std::vector<VkCommandBuffer>& secondaryBuffers = _recorder.GetCommandBuffers();
+		if (!secondaryBuffers.empty())
+			vkCmdExecuteCommands(commandBuffer, static_cast<UINT32>(secondaryBuffers.size()), secondaryBuffers.data());
+	}
+	else
+	{
+		BeginRenderPass(commandBuffer, imageIndex, VK_SUBPASS_CONTENTS_INLINE);
+		RecordDraws(commandBuffer, 0, drawCount);
+	}
 
 	EndRenderPass(commandBuffer);
+	_profiler.WriteEndTimestamp(commandBuffer, _currentFrame);
 	if (EndRecordCommandBuffer(commandBuffer))
 		throw std::runtime_error("Failed to record Command Buffer");
 }
 
+void VulkanEngine::VulkanApplication::RecordDraws(VkCommandBuffer commandBuffer, size_t begin, size_t end)
+{
+	// Secondary buffers inherit no state, so every slice sets up its own
+	SetupViewport(commandBuffer);
+	SetupScissor(commandBuffer);
+
+	if (_useGpuCulling)
+	{
+		RecordCulledDraws(commandBuffer);
+		return;
+	}
+
+	if (_mesh.IsCreated())
+	{
+		RecordInstanceBatches(commandBuffer, begin, end);
+		return;
+	}
+
+	// Nothing is drawn while the pipeline and its fallbacks are still compiling
+	if (!BindPipeline(commandBuffer))
+		return;
+
+	for (size_t i = begin; i < end; i++)
+	{
+		const DrawCommand& draw = _drawList[i];
+		vkCmdDraw(commandBuffer, draw.vertexCount, draw.instanceCount, draw.firstVertex, draw.firstInstance);
+	}
+}
+
+void VulkanEngine::VulkanApplication::RecordInstanceBatches(VkCommandBuffer commandBuffer, size_t begin, size_t end)
+{
+	// Still streaming in, the first frames only clear
+	if (!_mesh.IsResident())
+		return;
+
+	_instanceBatcher.Bind(commandBuffer);
+
+	const std::vector<InstanceBatch>& batches = _instanceBatcher.GetBatches();
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	const Mesh* boundMesh = nullptr;
+
+	for (size_t i = begin; i < end; i++)
+	{
+		const InstanceBatch& batch = batches[i];
+
+		// Batches of a material still compiling are skipped, the others draw
+		VkPipeline pipeline = batch.material != nullptr ? batch.material->Resolve() : VK_NULL_HANDLE;
+		if (pipeline == VK_NULL_HANDLE)
+			continue;
+
+		if (pipeline != boundPipeline)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundPipeline = pipeline;
+			boundMesh = nullptr;
+		}
+
+		if (batch.mesh != boundMesh)
+		{
+			MeshConstants constants = GetMeshConstants(*batch.mesh);
+			vkCmdPushConstants(commandBuffer, batch.material->GetLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				0, sizeof(constants), &constants);
+			batch.mesh->Bind(commandBuffer);
+			boundMesh = batch.mesh;
+		}
+
+		batch.mesh->Draw(commandBuffer, batch.instanceCount, batch.firstInstance);
+	}
+}
+
+void VulkanEngine::VulkanApplication::RecordCulledDraws(VkCommandBuffer commandBuffer)
+{
+	// The culler skips frames until the scene and its pipeline are ready, its draw is empty then
+	VkPipeline pipeline = _graphicsPipeline != nullptr ? _graphicsPipeline->Resolve() : VK_NULL_HANDLE;
+	if (pipeline == VK_NULL_HANDLE)
+		return;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+	MeshConstants constants = GetMeshConstants(_mesh);
+	vkCmdPushConstants(commandBuffer, _graphicsPipeline->GetLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		0, sizeof(constants), &constants);
+	_gpuCuller.Draw(commandBuffer, _currentFrame);
+}
+
+float VulkanEngine::VulkanApplication::GetInstanceViewScale() const
+{
+	return INSTANCE_VIEW_SCALE * _config.viewZoom;
+}
+
+glm::mat4 VulkanEngine::VulkanApplication::GetViewFromWorld() const
+{
+	const float tiltCos = std::cos(glm::radians(VIEW_TILT_DEGREES));
+	const float tiltSin = std::sin(glm::radians(VIEW_TILT_DEGREES));
+
+	// Rotation about x, indexed [column][row]
+	glm::mat4 viewFromWorld(1.0f);
+	viewFromWorld[1][1] = tiltCos;
+	viewFromWorld[1][2] = tiltSin;
+	viewFromWorld[2][1] = -tiltSin;
+	viewFromWorld[2][2] = tiltCos;
+	return viewFromWorld;
+}
+
+glm::mat4 VulkanEngine::VulkanApplication::GetClipFromWorld() const
+{
+	float aspect = static_cast<float>(_swapChainExtent.width) / _swapChainExtent.height;
+	float scale = GetInstanceViewScale();
+
+	// Orthographic, y flipped into Vulkan clip space. Depth ignores the scale so zooming never clips the [-2, 2] range
+	glm::mat4 clipFromView(0.0f);
+	clipFromView[0][0] = scale / aspect;
+	clipFromView[1][1] = -scale;
+	clipFromView[2][2] = -0.25f;
+	clipFromView[3][2] = 0.5f;
+	clipFromView[3][3] = 1.0f;
+
+	return clipFromView * GetViewFromWorld();
+}
+
+VulkanEngine::VulkanApplication::MeshConstants VulkanEngine::VulkanApplication::GetMeshConstants(const Mesh& mesh) const
+{
+	const MeshBounds& bounds = mesh.GetBounds();
+
+	// Lit from the upper right front of the view whatever the tilt, rotated back into world space
+	const glm::vec4 viewLight(0.4472f, 0.4472f, 0.7746f, 0.0f);
+
+	MeshConstants constants{};
+	constants.clipFromWorld = GetClipFromWorld();
+	constants.boundsCenter = glm::vec4(bounds.center, 0.0f);
+	constants.boundsExtent = glm::vec4(bounds.extent, 0.0f);
+	constants.lightDirection = glm::transpose(GetViewFromWorld()) * viewLight;
+	return constants;
+}
+
+VulkanEngine::CullView VulkanEngine::VulkanApplication::GetCullView() const
+{
+	CullView view;
+	view.clipFromWorld = GetClipFromWorld();
+	view.viewportHeight = static_cast<float>(_swapChainExtent.height);
+	return view;
+}
+
+VulkanEngine::Frustum VulkanEngine::VulkanApplication::GetViewFrustum() const
+{
+	return Frustum::FromMatrix(GetClipFromWorld());
+}
+
+bool VulkanEngine::VulkanApplication::CreateMesh()
+{
+	if (_config.meshDetail == 0)
+		return true;
+
+	VertexFormat format = _config.quantizeVertices ? VertexFormat::Quantized() : VertexFormat::Standard();
+
+	// Only the cull pass picks lods, the batcher always draws the finest
+	std::vector<MeshData> lods;
+	for (UINT32 segments = _config.meshDetail; lods.empty() || (_config.gpuCulling
+		&& segments >= MIN_LOD_SEGMENTS && lods.size() < GpuCuller::MAX_LODS); segments /= 2)
+	{
+		lods.push_back(MeshData::CreateSphere(std::max(segments / 2, 2u), segments));
+	}
+
+	return _mesh.Create(_allocator, lods, format);
+}
+
+bool VulkanEngine::VulkanApplication::CreateGpuCuller()
+{
+	_useGpuCulling = _config.gpuCulling && _indirectSupport.firstInstance;
+	if (_config.gpuCulling && !_useGpuCulling)
+		fprintf(stdout, "Indirect draws can't select instances on this device, falling back to the instance batcher\n");
+
+	if (!_useGpuCulling)
+		return true;
+
+	// Compiled right away, the cull pass is small and the first frame needs its layout
+	const std::string path = "res/Shaders/Cull.comp";
+	SPTR<Shader> cullShader;
+
+	std::vector<UINT32> spirv;
+	if (_shaderCompiler.CompileFile(path, {}, spirv))
+		cullShader = _shaderServer.Load(path, spirv.data(), spirv.size() * sizeof(UINT32));
+
+	if (cullShader == nullptr)
+	{
+		fprintf(stderr, "Failed to load Cull shader\n");
+		return false;
+	}
+
+	// On the async compute queue the scene and the draws are shared with the transfer and graphics queues
+	std::vector<UINT32> queueFamilies = { _queueFamilyIndices.graphicsFamily.value() };
+	if (_computeScheduler.IsAsync())
+	{
+		queueFamilies.push_back(_computeScheduler.GetComputeFamily());
+		queueFamilies.push_back(_queueFamilyIndices.transferFamily.value());
+	}
+
+	if (!_gpuCuller.Init(_device, _allocator, _layoutCache, _pipelineCompiler, cullShader, _indirectSupport, queueFamilies,
+		!_computeScheduler.IsAsync(), MAX_FRAMES_IN_FLIGHT))
+		return false;
+
+	// The indirect draws are the first to read what the cull pass writes, their instances are fetched after them
+	_computeScheduler.AddPass("Cull", VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		[this](VkCommandBuffer commandBuffer, UINT32 frame)
+		{
+			return _gpuCuller.Record(commandBuffer, frame, GetCullView());
+		});
+
+	return true;
+}
+
+void VulkanEngine::VulkanApplication::CreateInstances(UINT32 count)
+{
+	_instances.clear();
+	_instances.reserve(count);
+
+	UINT32 side = 1;
+	while (static_cast<UINT64>(side) * side * side < count)
+		side++;
+
+	// Every instance fills most of its grid cell, whatever the size of the mesh
+	const MeshBounds& bounds = _mesh.GetBounds();
+	float spacing = 2.0f / side;
+	float scale = spacing * 0.45f / std::max({ bounds.extent.x, bounds.extent.y, bounds.extent.z });
+
+	for (UINT32 i = 0; i < count; i++)
+	{
+		glm::vec3 cell(static_cast<float>(i % side), static_cast<float>(i / side % side), static_cast<float>(i / (side * side)));
+		glm::vec3 position = (cell + 0.5f) * spacing - 1.0f;
+
+		// Spun about y by a per instance angle so neighbours don't look identical
+		float angle = static_cast<float>(HashValue(i) % 6283) * 0.001f;
+
+		InstanceData instance{};
+		instance.positionScale = glm::vec4(position, scale);
+		instance.rotation = glm::vec4(0.0f, std::sin(angle * 0.5f), 0.0f, std::cos(angle * 0.5f));
+		instance.color = glm::vec4(position * 0.4f + 0.6f, 1.0f);
+		_instances.push_back(instance);
+	}
+
+	// Drawn back to front as the render pass has no depth buffer, farthest clip depth first
+	const glm::mat4 clipFromWorld = GetClipFromWorld();
+	auto depth = [&clipFromWorld](const InstanceData& instance) { return (clipFromWorld * glm::vec4(glm::vec3(instance.positionScale), 1.0f)).z; };
+	std::sort(_instances.begin(), _instances.end(), [&depth](const InstanceData& a, const InstanceData& b) { return depth(a) > depth(b); });
+
+	// The mesh is centered on each instance, so its bounding sphere only scales with it
+	if (_useCpuCulling)
+	{
+		_frustumCuller.Clear();
+		_frustumCuller.Reserve(_instances.size(), 0);
+		for (const InstanceData& instance : _instances)
+			_frustumCuller.AddSphere(glm::vec3(instance.positionScale), glm::length(bounds.extent) * instance.positionScale.w);
+	}
+
+	// Compacted draws land in whatever order the cull pass finished them, so overlaps may draw out of order
+	if (_useGpuCulling && !_gpuCuller.SetScene(_mesh, _instances, LOD_PIXEL_SIZES, _deletionQueue, GetRecordingFrameValue()))
+		throw std::runtime_error("Failed to create GPU culling scene");
+}
+
+void VulkanEngine::VulkanApplication::SubmitInstances()
+{
+	if (!_mesh.IsCreated() || _useGpuCulling)
+		return;
+
+	std::span<const InstanceData> instances = _instances;
+	if (_useCpuCulling)
+	{
+		_frustumCuller.Cull(GetViewFrustum());
+
+		// Gathered in the visibility mask's order, which keeps the back to front sort
+		_visibleInstances.clear();
+		const std::vector<UINT64>& visibility = _frustumCuller.GetSphereVisibility();
+		for (size_t block = 0; block < visibility.size(); block++)
+		{
+			for (UINT64 word = visibility[block]; word != 0; word &= word - 1)
+				_visibleInstances.push_back(_instances[block * FrustumCuller::BLOCK_SIZE + std::countr_zero(word)]);
+		}
+
+		instances = _visibleInstances;
+	}
+
+	_instanceBatcher.Submit(_mesh, _graphicsPipeline, instances);
+	if (!_instanceBatcher.Flush(_currentFrame))
+		throw std::runtime_error("Failed to pack instance data");
+}
+
+void VulkanEngine::VulkanApplication::RunInstanceBenchmark()
+{
+	struct Result
+	{
+		UINT32 instances;
+		UINT64 frames;
+		double frameTime;
+		double packTime;
+		double gpuTime;
+	};
+
+	const UINT32 counts[] = { 1000, 10000, 100000, 1000000 };
+	UINT64 frameCount = _config.frameCount > 0 ? _config.frameCount : INSTANCE_BENCHMARK_FRAMES;
+
+	// False once the window was closed, the device is left idle for ShutdownVulkan like the other Run paths
+	auto step = [this]()
+		{
+			if (!_config.headless)
+			{
+				glfwPollEvents();
+				if (glfwWindowShouldClose(_window->GetGLFWWindow()))
+				{
+					vkDeviceWaitIdle(_device);
+					return false;
+				}
+			}
+
+			DrawFrame();
+			return true;
+		};
+
+	std::vector<Result> results;
+	for (UINT32 count : counts)
+	{
+		CreateInstances(count);
+
+		// Lets the mesh finish uploading and every frame slot grow its instance buffer
+		for (UINT32 i = 0; i < _framesInFlight * 2; i++)
+		{
+			if (!step())
+				return;
+		}
+
+		UINT64 firstFrame = _profiler.GetFrameCount();
+		double packTime = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (UINT64 frame = 0; frame < frameCount; frame++)
+		{
+			if (!step())
+				return;
+
+			packTime += _instanceBatcher.GetStats().packTime;
+		}
+
+		vkDeviceWaitIdle(_device);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		results.push_back(Result{ count, frameCount, elapsed.count() / frameCount, packTime / frameCount,
+			_profiler.GetStats(FrameStage::Gpu, firstFrame).average });
+	}
+
+	fprintf(stdout, "Instance benchmark, %u indices per instance, %u byte vertices\n", _mesh.GetLods()[0].indexCount, _mesh.GetFormat().GetStride());
+	fprintf(stdout, "%12s %8s %12s %12s %12s %12s\n", "instances", "frames", "frame ms", "pack ms", "gpu ms", "MB/frame");
+	for (const Result& result : results)
+	{
+		fprintf(stdout, "%12u %8llu %12.3f %12.3f %12.3f %12.2f\n",
+			result.instances, static_cast<unsigned long long>(result.frames), result.frameTime, result.packTime, result.gpuTime,
+			result.instances * sizeof(InstanceData) / (1024.0 * 1024.0));
+	}
+}
+
+void VulkanEngine::VulkanApplication::RunCullBenchmark()
+{
+	struct Result
+	{
+		CullKernel kernel;
+		bool parallel;
+		double cullTime;
+		UINT32 visible;
+		bool matches;
+	};
+
+	FrustumCuller culler;
+	if (!culler.Init(_jobs))
+		return;
+
+	// Hashed positions over [-2, 2], twice the grid CreateInstances fills, so part of every set leaves the view
+	auto random = [](UINT32 object, UINT32 component) { return static_cast<float>(HashValue(object * 16 + component) % 65536) / 65536.0f; };
+
+	culler.Reserve(CULL_BENCHMARK_OBJECTS, CULL_BENCHMARK_OBJECTS);
+	for (UINT32 i = 0; i < CULL_BENCHMARK_OBJECTS; i++)
+	{
+		glm::vec3 sphere(random(i, 0), random(i, 1), random(i, 2));
+		culler.AddSphere(sphere * 4.0f - 2.0f, 0.002f + random(i, 3) * 0.02f);
+
+		glm::vec3 box(random(i, 4), random(i, 5), random(i, 6));
+		glm::vec3 extent(random(i, 7), random(i, 8), random(i, 9));
+		culler.AddBox(box * 4.0f - 2.0f, extent * 0.02f + 0.002f);
+	}
+
+	Frustum frustum = GetViewFrustum();
+
+	// Every kernel has to reproduce the scalar reference exactly
+	culler.Cull(frustum, CullKernel::Scalar, false);
+	std::vector<UINT64> referenceSpheres = culler.GetSphereVisibility();
+	std::vector<UINT64> referenceBoxes = culler.GetBoxVisibility();
+
+	std::vector<Result> results;
+	for (UINT32 kernel = 0; kernel < static_cast<UINT32>(CullKernel::Count); kernel++)
+	{
+		if (!FrustumCuller::IsKernelSupported(static_cast<CullKernel>(kernel)))
+			continue;
+
+		for (bool parallel : { false, true })
+		{
+			Result result{ static_cast<CullKernel>(kernel), parallel, 0.0, 0, true };
+
+			// First pass warms the caches and the workers
+			culler.Cull(frustum, result.kernel, parallel);
+			for (UINT32 iteration = 0; iteration < CULL_BENCHMARK_ITERATIONS; iteration++)
+			{
+				result.visible = culler.Cull(frustum, result.kernel, parallel);
+				result.cullTime += culler.GetStats().cullTime;
+			}
+
+			result.cullTime /= CULL_BENCHMARK_ITERATIONS;
+			result.matches = culler.GetSphereVisibility() == referenceSpheres && culler.GetBoxVisibility() == referenceBoxes;
+			results.push_back(result);
+		}
+	}
+
+	fprintf(stdout, "Cull benchmark, %u spheres and %u boxes, %u job threads\n", CULL_BENCHMARK_OBJECTS, CULL_BENCHMARK_OBJECTS, _jobs.GetThreadCount());
+	fprintf(stdout, "%8s %10s %12s %14s %12s %8s\n", "kernel", "threads", "cull ms", "Mobjects/s", "visible", "matches");
+	for (const Result& result : results)
+	{
+		fprintf(stdout, "%8s %10s %12.3f %14.1f %12u %8s\n",
+			FrustumCuller::GetKernelName(result.kernel), result.parallel ? "all" : "one", result.cullTime,
+			CULL_BENCHMARK_OBJECTS * 2 / (result.cullTime * 1000.0), result.visible, result.matches ? "yes" : "NO");
+	}
+}
+
 bool VulkanEngine::VulkanApplication::CreateSyncObjects()
 {
 	VkSemaphoreCreateInfo semaphoreCreateInfo{};
@@ -1239,18 +2327,21 @@ bool VulkanEngine::VulkanApplication::CreateSyncObjects()
 	// this will help avoid design issue where the first frame will wait indefinitely (or UINT64)
 	// as the fence default state after creation will be unsignaled otherwise
 
+	if (_useTimeline && !_frameTimeline.Create(_device))
+		return false;
+
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		if (vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_imageAvailableSemaphores[i]) != VK_SUCCESS
 			|| vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_renderFinishSemaphores[i]) != VK_SUCCESS
-			|| vkCreateFence(_device, &fenceCreateInfo, nullptr, &_frameFences[i]) != VK_SUCCESS)
+			|| (!_useTimeline && vkCreateFence(_device, &fenceCreateInfo, nullptr, &_frameFences[i]) != VK_SUCCESS))
 		{
 			fprintf(stderr, "Failed to create Sync Objects\n");
 			return false;
 		}
 	}
 
-	fprintf(stdout, "Created Sync Objects\n");
+	fprintf(stdout, "Created Sync Objects (%s)\n", _useTimeline ? "timeline" : "fences");
 	return true;
 }
 
@@ -1260,8 +2351,89 @@ void VulkanEngine::VulkanApplication::DestroySyncObjects()
 	{
 		vkDestroySemaphore(_device, _imageAvailableSemaphores[i], nullptr);
 		vkDestroySemaphore(_device, _renderFinishSemaphores[i], nullptr);
-		vkDestroyFence(_device, _frameFences[i], nullptr);
+		if (!_useTimeline)
+			vkDestroyFence(_device, _frameFences[i], nullptr);
 	}
+
+	_frameTimeline.Destroy();
+}
+
+void VulkanEngine::VulkanApplication::WaitForFrameSlot()
+{
+	if (!_useTimeline)
+	{
+		vkWaitForFences(_device, 1, &_frameFences[_currentFrame], VK_TRUE, UINT64_MAX);
+		return;
+	}
+
+	// The next frame reuses the slot of the frame _framesInFlight values back
+	UINT64 nextValue = _frameValue + 1;
+	if (nextValue > _framesInFlight)
+		_frameTimeline.Wait(nextValue - _framesInFlight);
+}
+
+void VulkanEngine::VulkanApplication::WaitForFrameValue(UINT64 value)
+{
+	if (_useTimeline)
+	{
+		_frameTimeline.Wait(value);
+		return;
+	}
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (_slotFrameValues[i] != 0 && _slotFrameValues[i] <= value)
+			vkWaitForFences(_device, 1, &_frameFences[i], VK_TRUE, UINT64_MAX);
+	}
+}
+
+UINT64 VulkanEngine::VulkanApplication::GetCompletedFrameValue() const
+{
+	if (_useTimeline)
+		return _frameTimeline.GetValue();
+
+	// Frames retire in submission order, so the oldest unsignaled slot bounds the completed value
+	UINT64 completedValue = _frameValue;
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (_slotFrameValues[i] != 0 && _slotFrameValues[i] <= completedValue
+			&& vkGetFenceStatus(_device, _frameFences[i]) != VK_SUCCESS)
+			completedValue = _slotFrameValues[i] - 1;
+	}
+
+	return completedValue;
+}
+
+void VulkanEngine::VulkanApplication::SubmitFrame(VkSemaphore imageAvailable, const UploadSubmission& upload, const ComputeSubmission& compute, VkSemaphore renderFinish)
+{
+	SemaphoreSubmit semaphores;
+	semaphores.Wait(imageAvailable, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	semaphores.Wait(upload.semaphore, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, upload.value);
+	semaphores.Wait(compute.semaphore, compute.waitStage, compute.value);
+	semaphores.Signal(renderFinish);
+
+	VkFence fence = VK_NULL_HANDLE;
+	if (_useTimeline)
+		semaphores.Signal(_frameTimeline.GetHandle(), _frameValue + 1);
+	else
+	{
+		fence = _frameFences[_currentFrame];
+		vkResetFences(_device, 1, &fence);
+		_slotFrameValues[_currentFrame] = _frameValue + 1;
+	}
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &_commandBuffers[_currentFrame];
+	semaphores.Fill(submitInfo, _useTimeline);
+
+	_profiler.BeginStage(FrameStage::Submit);
+	if (vkQueueSubmit(_graphicsQueue, 1, &submitInfo, fence) != VK_SUCCESS)
+		throw std::runtime_error("Failed to submit draw command to queue");
+	_profiler.EndStage(FrameStage::Submit);
+
+	_frameValue++;
 }
 
 #pragma endregion
\ No newline at end of file
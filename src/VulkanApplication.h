@@ -1,22 +1,67 @@
 #pragma once
 
 #include <Common.h>
+#include <chrono>
+#include <filesystem>
 #include <Window/Window.h>
+#include <Config/RenderConfig.h>
+#include <Profiler/FrameProfiler.h>
+#include <Pipeline/PipelineCache.h>
+#include <Shader/ShaderServer.h>
+#include <Commands/ParallelRecorder.h>
+#include <Commands/ComputeScheduler.h>
+#include <Memory/MemoryAllocator.h>
+#include <Memory/UploadManager.h>
+#include <Memory/DeletionQueue.h>
+#include <Sync/TimelineSemaphore.h>
+#include <Mesh/Mesh.h>
+#include <Mesh/InstanceBatcher.h>
+#include <Culling/GpuCuller.h>
+#include <Culling/FrustumCuller.h>
 
 namespace VulkanEngine
 {
+	// Specialization constants of Triangle.frag, the constant id is the feature index
+	enum class TriangleFeature
+	{
+		Grayscale,
+		Count
+	};
+
+	using TriangleFeatures = FeatureSet<TriangleFeature>;
+
 	class VulkanApplication
 	{
 	public:
-		bool Init();
+		bool Init(const RenderConfig& config = {});
 		void Run();
 		void Shutdown();
 		void DrawFrame();
 
 		VkDevice GetDevice() const { return _device; }
+		const FrameProfiler& GetProfiler() const { return _profiler; }
+		MemoryAllocator& GetAllocator() { return _allocator; }
+		UploadManager& GetUploader() { return _uploader; }
+		AssetLoader& GetAssetLoader() { return _assetLoader; }
+		JobSystem& GetJobSystem() { return _jobs; }
+		DeletionQueue& GetDeletionQueue() { return _deletionQueue; }
+
+		// Tag for resources used by the frame currently being recorded
+		UINT64 GetRecordingFrameValue() const { return _frameValue + 1; }
+
+		// Applies frames in flight, swap chain image count, present policy and shader features while running
+		bool ApplyRenderSettings(const RenderConfig& settings);
 
 	private:
 
+		RenderConfig _config;
+
+		// Polled from Run, a changed config file is reloaded and applied
+		std::filesystem::file_time_type _configWriteTime;
+		std::chrono::steady_clock::time_point _lastConfigPoll;
+
+		void PollConfigFile();
+
 #pragma region GLFW
 
 		UPTR<Window> _window = nullptr;
@@ -81,16 +126,18 @@ namespace VulkanEngine
 			std::optional<UINT32> graphicsFamily;
 			std::optional<UINT32> computeFamily;
 			std::optional<UINT32> presentationFamily;
+			std::optional<UINT32> transferFamily;
 
-			inline UINT32 GetSize() const { return 3; }
+			inline UINT32 GetSize() const { return 4; }
 
 			inline std::string Print() const
 			{
 				return std::format(
-					"gr {} | cmp {} | prsn {}",
+					"gr {} | cmp {} | prsn {} | trn {}",
 					graphicsFamily.value_or(-1),
 					computeFamily.value_or(-1),
-					presentationFamily.value_or(-1)
+					presentationFamily.value_or(-1),
+					transferFamily.value_or(-1)
 				);
 			}
 
@@ -98,7 +145,8 @@ namespace VulkanEngine
 			{
 				return graphicsFamily.has_value()
 					&& computeFamily.has_value()
-					&& presentationFamily.has_value();
+					&& presentationFamily.has_value()
+					&& transferFamily.has_value();
 			}
 
 			inline void GetIndices(std::vector<UINT32>& indices) const
@@ -106,6 +154,7 @@ namespace VulkanEngine
 				indices[0] = graphicsFamily.value();
 				indices[1] = computeFamily.value();
 				indices[2] = presentationFamily.value();
+				indices[3] = transferFamily.value();
 			}
 
 			void GetCreateInfos(std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos) const;
@@ -119,9 +168,15 @@ namespace VulkanEngine
 
 		bool CreateLogicalDevice();
 
+		MemoryAllocator _allocator;
+
+		// Drained every frame with the completed frame value, flushed entirely on shutdown
+		DeletionQueue _deletionQueue;
+
 		VkQueue _graphicsQueue = VK_NULL_HANDLE;
 		VkQueue _computeQueue = VK_NULL_HANDLE;
 		VkQueue _presentationQueue = VK_NULL_HANDLE;
+		VkQueue _transferQueue = VK_NULL_HANDLE;
 
 		const std::vector<const char*> deviceExtensions =
 		{
@@ -157,7 +212,7 @@ namespace VulkanEngine
 
 #pragma region Swap Chain
 
-		VkSwapchainKHR _swapChain;
+		VkSwapchainKHR _swapChain = VK_NULL_HANDLE;
 		std::vector<VkImage> _images;
 		VkFormat _swapChainImageFormat;
 		VkExtent2D _swapChainExtent;
@@ -166,7 +221,18 @@ namespace VulkanEngine
 		VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
 		VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
 
-		bool CreateSwapChain();
+		bool CreateSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+
+#pragma endregion
+
+#pragma region Offscreen
+
+		// Headless mode renders into these in place of swap chain images, one per frame in flight
+		std::vector<Allocation> _offscreenAllocations;
+
+		bool CreateOffscreenImages();
+
+		bool SaveCapture(UINT32 imageIndex, const std::string& path);
 
 #pragma endregion
 
@@ -178,7 +244,17 @@ namespace VulkanEngine
 
 		bool ReCreateSwapChain();
 
-		void CleanupSwapChain();
+		// Hands the current images, views and framebuffers to the deletion queue,
+		// they are destroyed once every frame submitted so far has retired
+		void RetireSwapChain();
+
+		// Resize events restart the timer, the swap chain is rebuilt once the size settled
+		static constexpr std::chrono::milliseconds SWAPCHAIN_RESIZE_DEBOUNCE{ 100 };
+
+		bool _swapChainDirty = false;
+		std::chrono::steady_clock::time_point _swapChainDirtyTime;
+
+		void RequestSwapChainRecreation();
 
 #pragma endregion
 
@@ -192,13 +268,39 @@ namespace VulkanEngine
 
 #pragma region Graphics Pipeline
 
-		VkShaderModule _vertShaderModule;
-		VkShaderModule _fragShaderModule;
+		ShaderCompiler _shaderCompiler;
+		ShaderServer _shaderServer;
+		std::vector<SPTR<Shader>> _pipelineShaders;
+
+		// Requested right after device creation so the reads overlap swap chain and render pass setup
+		std::vector<std::future<AssetResult>> _pendingShaderLoads;
 
+		void RequestPipelineShaders();
 		bool CreateGraphicsPipeline();
+		PipelineHandle CompileGraphicsPipeline(const std::vector<SPTR<Shader>>& shaders, PipelineHandle fallback);
+		PipelineDesc GetGraphicsPipelineDesc(const std::vector<SPTR<Shader>>& shaders) const;
+
+		// Feature constants plus the ones the active shaders need for the mesh vertex format
+		SpecializationConstants GetShaderSpecialization(UINT32 featureBits) const;
+		const char* GetGraphicsPipelineName() const;
+
+		// Switches to the variant for the configured shader features, a prewarmed one is ready right away
+		void SelectShaderVariant();
 
+		// Rebuild compiling in the background, swapped in at the start of the first frame it is ready for
+		ShaderWatcher _shaderWatcher;
+		PipelineHandle _reloadedPipeline;
+
+		void ReloadShaders();
+
+		PipelineCache _pipelineCache;
+		PipelineCompiler _pipelineCompiler;
+		PipelineLibrary _pipelineLibrary;
+
+		// Owns the layout, _pipelineLayout follows whichever pipeline is current
+		LayoutCache _layoutCache;
 		VkPipelineLayout _pipelineLayout;
-		VkPipeline _graphicsPipeline;
+		PipelineHandle _graphicsPipeline;
 
 #pragma endregion
 
@@ -210,15 +312,46 @@ namespace VulkanEngine
 
 #pragma endregion
 
+#pragma region Jobs
+
+		// Shared by command recording and asset decoding, the main thread helps while it waits
+		JobSystem _jobs;
+
+		bool CreateJobSystem();
+
+#pragma endregion
+
 #pragma region Commands
 
-		const UINT8 MAX_FRAMES_IN_FLIGHT = 2;
+		// Per frame objects are created for the limit, _framesInFlight selects how many are cycled
+		static constexpr UINT32 MAX_FRAMES_IN_FLIGHT = RenderConfig::MAX_FRAMES_IN_FLIGHT;
+		UINT32 _framesInFlight = 2;
 
 		VkCommandPool _commandPool;
+		std::vector<VkCommandPool> _frameCommandPools{ MAX_FRAMES_IN_FLIGHT };
 		std::vector<VkCommandBuffer> _commandBuffers{ MAX_FRAMES_IN_FLIGHT };
 
 		bool CreateCommandPool();
 		bool CreateCommandBuffers();
+		void ResetFrameCommandPools();
+
+		// Secondary buffers are only used once a draw list has at least this many draws
+		const size_t PARALLEL_RECORD_THRESHOLD = 1024;
+
+		ParallelRecorder _recorder;
+
+		bool CreateParallelRecorder();
+
+		// Owns the compute queue when the device has a separate compute family
+		ComputeScheduler _computeScheduler;
+
+		// Owns the transfer queue, uploads land before the frame that queued them renders
+		UploadManager _uploader;
+
+		// Reads and decodes assets in the background, finished uploads are drained once per frame
+		AssetLoader _assetLoader;
+
+		bool CreateAssetLoader();
 
 		VkClearValue clearColor =
 		{
@@ -228,10 +361,10 @@ namespace VulkanEngine
 		bool RecordCommandBuffer(VkCommandBuffer commandBuffer);
 		bool EndRecordCommandBuffer(VkCommandBuffer commandBuffer);
 
-		void BeginRenderPass(VkCommandBuffer commandBuffer, UINT32 imageIndex);
+		void BeginRenderPass(VkCommandBuffer commandBuffer, UINT32 imageIndex, VkSubpassContents contents);
 		void EndRenderPass(VkCommandBuffer commandBuffer);
 
-		void BindPipeline(VkCommandBuffer commandBuffer);
+		bool BindPipeline(VkCommandBuffer commandBuffer);
 
 		void SetupViewport(VkCommandBuffer commandBuffer);
 		void SetupScissor(VkCommandBuffer commandBuffer);
@@ -243,7 +376,96 @@ namespace VulkanEngine
 
 		UINT8 _currentFrame = 0;
 
+		struct DrawCommand
+		{
+			UINT32 vertexCount;
+			UINT32 instanceCount;
+			UINT32 firstVertex;
+			UINT32 firstInstance;
+		};
+
+		std::vector<DrawCommand> _drawList;
+
+		// Drawn by every draw command instead of the triangle when meshDetail is set
+		Mesh _mesh;
+
+		// constant_ids of Mesh.vert's decode flags, after the feature constants
+		static constexpr UINT32 MESH_SNORM_POSITION_CONSTANT_ID = static_cast<UINT32>(TriangleFeature::Count);
+		static constexpr UINT32 MESH_OCTAHEDRAL_NORMAL_CONSTANT_ID = MESH_SNORM_POSITION_CONSTANT_ID + 1;
+
+		// Layout of Mesh.vert's push constant block followed by Mesh.frag's
+		struct MeshConstants
+		{
+			glm::mat4 clipFromWorld;
+			glm::vec4 boundsCenter;
+			glm::vec4 boundsExtent;
+			glm::vec4 lightDirection;	// World space
+		};
+
+		bool CreateMesh();
+
+		// Instances of _mesh resubmitted every frame, packed into the frame's instance buffer
+		InstanceBatcher _instanceBatcher;
+		std::vector<InstanceData> _instances;
+
+		// Lays count instances out on a grid filling the view
+		void CreateInstances(UINT32 count);
+		void SubmitInstances();
+
+		// The view maps the [-1, 1] instance grid into clip space with this, leaves room for the tilt
+		static constexpr float INSTANCE_VIEW_SCALE = 0.6f;
+
+		// Tilt of the view about x so the poles and the shading are both visible
+		static constexpr float VIEW_TILT_DEGREES = 20.0f;
+
+		// Frames measured per instance count when frameCount leaves it open
+		static constexpr UINT64 INSTANCE_BENCHMARK_FRAMES = 300;
+
+		void RunInstanceBenchmark();
+
+		// Takes over from the instance batcher when gpuCulling is set and the device can draw it
+		bool _useGpuCulling = false;
+		IndirectDrawSupport _indirectSupport;
+		GpuCuller _gpuCuller;
+
+		// Sphere lods halve the segments down to this, at most GpuCuller::MAX_LODS of them
+		static constexpr UINT32 MIN_LOD_SEGMENTS = 4;
+
+		// Smallest on screen diameter in pixels each lod but the coarsest is drawn at
+		static constexpr float LOD_PIXEL_SIZES[GpuCuller::MAX_LODS - 1] = { 96.0f, 32.0f, 12.0f };
+
+		bool CreateGpuCuller();
+		float GetInstanceViewScale() const;
+
+		// The tilted orthographic view of the instance grid. Drawing, GPU and CPU culling and
+		// the draw order all derive from this one matrix.
+		glm::mat4 GetViewFromWorld() const;
+		glm::mat4 GetClipFromWorld() const;
+		MeshConstants GetMeshConstants(const Mesh& mesh) const;
+		CullView GetCullView() const;
+		void RecordCulledDraws(VkCommandBuffer commandBuffer);
+
+		// Bounding spheres of _instances, culled before each frame's submission when cpuCulling is set
+		bool _useCpuCulling = false;
+		FrustumCuller _frustumCuller;
+		std::vector<InstanceData> _visibleInstances;
+
+		// Spheres and boxes each, spread over twice the instance grid so part of them gets culled
+		static constexpr UINT32 CULL_BENCHMARK_OBJECTS = 500000;
+		static constexpr UINT32 CULL_BENCHMARK_ITERATIONS = 100;
+
+		Frustum GetViewFrustum() const;
+		void RunCullBenchmark();
+
 		void Draw(VkCommandBuffer commandBuffer, UINT32 imageIndex);
+		void RecordDraws(VkCommandBuffer commandBuffer, size_t begin, size_t end);
+		void RecordInstanceBatches(VkCommandBuffer commandBuffer, size_t begin, size_t end);
+
+#pragma endregion
+
+#pragma region Profiling
+
+		FrameProfiler _profiler;
 
 #pragma endregion
 
@@ -253,19 +475,33 @@ namespace VulkanEngine
 		std::vector<VkSemaphore> _renderFinishSemaphores{ MAX_FRAMES_IN_FLIGHT };
 		std::vector<VkFence> _frameFences{ MAX_FRAMES_IN_FLIGHT };
 
+		// Timeline backend replaces the fences, the graphics queue signals the frame value on completion
+		bool _useTimeline = false;
+		TimelineSemaphore _frameTimeline;
+		UINT64 _frameValue = 0;		// Value of the last submitted frame, frames are numbered from 1
+
+		// Fence backend only, value of the frame each slot last submitted
+		std::vector<UINT64> _slotFrameValues = std::vector<UINT64>(MAX_FRAMES_IN_FLIGHT, 0);
+
 		bool CreateSyncObjects();
 		void DestroySyncObjects();
 
+		void WaitForFrameSlot();
+
+		// Every frame up to and including this value has finished on the GPU, never blocks
+		UINT64 GetCompletedFrameValue() const;
+		void WaitForFrameValue(UINT64 value);
+		void SubmitFrame(VkSemaphore imageAvailable, const UploadSubmission& upload, const ComputeSubmission& compute, VkSemaphore renderFinish);
+
 #pragma endregion
 
 	public:
 		VulkanApplication(const VulkanApplication&) = delete;
 		VulkanApplication& operator=(const VulkanApplication&) = delete;
 
-		inline static UPTR<VulkanApplication> Get()
+		inline static UPTR<VulkanApplication> Create()
 		{
-			UPTR<VulkanApplication> s_instance = UPTR<VulkanApplication>{ new VulkanApplication() };
-			return s_instance;
+			return UPTR<VulkanApplication>{ new VulkanApplication() };
 		}
 
 	private:
@@ -3,12 +3,14 @@
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
-int main()
+int main(int argc, char** argv)
 {
 	{
-		UPTR<VulkanEngine::VulkanApplication> va = VulkanEngine::VulkanApplication::Get();
+		UPTR<VulkanEngine::VulkanApplication> va = VulkanEngine::VulkanApplication::Create();
 
-		if (!va->Init())
+		VulkanEngine::RenderConfig config = VulkanEngine::RenderConfig::ParseCommandLine(argc, argv);
+
+		if (!va->Init(config))
 			return 1;
 
 		va->Run();